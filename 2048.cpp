@@ -1,35 +1,80 @@
 #include "modele.hpp"
 #include "menu.hpp"  // Include the menu header
 #include "ai.hpp"
+#include "renderer.hpp"  // Incremental board drawing
+#include "ponder.hpp"    // Hint search running while the player thinks
+#include "history.hpp"   // Undo/redo of the last moves
+#include "checkpoint.hpp" // Saved game to resume
+#include "resultstore.hpp" // Finished games and best scores
 #include <chrono>    // For timed mode support
+#include <algorithm> // For std::max
 #include <curses.h>
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
+#include <fstream>   // To look for the hint cache file
 #include <vector>
+#include <thread>    // For the hint search thread count
 
 // Main function to run the game
-int main() {
+// Option: --resume (continue the game saved in data/game.ckpt instead of showing the menu)
+int main(int argc, char* argv[]) {
     int gridSize = 4;     // Default grid size
     int score = 0; // Initialize the game score
-    int bestScore = loadBestScore(); // Load the best score from the file
+    int bestScore = 0; // Best score of the grid size and mode, read once they are chosen
     int input; // Use int instead of char for user input
-    bool undoAvailable = false; // Track if undo is available
-    int prevScore = 0;      // Store the previous score
     std::string currentHint = "";
 
     // Before initializing the grid
     bool timedMode = false;
     int timeLimit = 120;  // Default time limit for timed mode
 
-     // Call the menu to set gridSize, timedMode, and timeLimit
-    showMenu(timedMode, timeLimit, gridSize);
+    // The game is saved after every move, so it can go on after the terminal was closed
+    const std::string checkpointPath = "data/game.ckpt";
+    bool resume = (argc > 1 && std::string(argv[1]) == "--resume");
+    GameCheckpoint checkpoint;
+    if (resume) {
+        if (!loadCheckpoint(checkpointPath, checkpoint)) {
+            std::cout << "No saved game in " << checkpointPath << "\n";
+            return 1;
+        }
+        gridSize = checkpoint.grid.size;
+        timedMode = checkpoint.timedMode;
+        timeLimit = checkpoint.timeLimit;
+        score = checkpoint.score;
+    } else {
+        // Call the menu to set gridSize, timedMode, and timeLimit
+        showMenu(timedMode, timeLimit, gridSize);
+    }
+    ResultStore results; // Shared with the other games and AI players
+    const ResultMode resultMode = timedMode ? RESULT_TIMED : RESULT_CLASSIC;
+    bestScore = results.bestScore(gridSize, resultMode, false);
 
     // Initialize the grid dynamically based on gridSize
     std::vector<std::vector<int>> grid(gridSize, std::vector<int>(gridSize, 0)); // Current grid
-    std::vector<std::vector<int>> prevGrid(gridSize, std::vector<int>(gridSize, 0)); // Previous grid
 
-    std::srand(std::time(0)); // Seed random number generator for random tile placement
+    // Every game has its own tile generator, seeded from the clock
+    uint64_t seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+                    static_cast<uint64_t>(std::time(0));
+    if (resume) seed = checkpoint.seed;
+    GameRng rng(seed);
+
+    // Hints come from an expectimax search spread over every core, which runs in
+    // the background from the moment a board appears until the next move
+    SearchOptions hintOptions;
+    hintOptions.mode = SEARCH_EXPECTIMAX;
+    hintOptions.depth = 8;        // Deepest iteration, if the player thinks long enough
+    const int hintWaitMs = 250;   // Longest wait for a first result when H is pressed right after a move
+    hintOptions.threads = std::max(1u, std::thread::hardware_concurrency());
+    // Tuned weights (see tune), loaded before the hint cache that is versioned with them
+    EvalWeights weights;
+    if (readEvalWeights(DEFAULT_WEIGHTS_FILE, weights)) setEvalWeights(weights);
+    // Hints reuse the results of earlier sessions when the cache file exists
+    // (create it with "./simulate --expectimax --cache data/eval_cache.bin")
+    const char* hintCacheFile = "data/eval_cache.bin";
+    if (!std::ifstream(hintCacheFile).good() || !openEvaluationCache(hintCacheFile, 64)) {
+        configureTranspositionTable(64);
+    }
     
     // Initialize ncurses screen
     initscr();
@@ -38,14 +83,37 @@ int main() {
     keypad(stdscr, TRUE); // Enable arrow key input
 
     initializeColors(); // Initialize color pairs for the game
-    initializeGrid(grid); // Add two random tiles to start the game
-
-    auto startTime = std::chrono::steady_clock::now();
+    if (resume) {
+        rng.restoreState(checkpoint.rngState); // The same tiles come as in the saved game
+        unflattenGrid(checkpoint.grid, grid);
+    } else {
+        initializeGrid(grid, rng); // Add two random tiles to start the game
+    }
+    GameHistory history;  // Positions for undo and redo, allocated once
+    history.reset(grid, score);
+    HintPonderer ponderer(hintOptions);
+    ponderer.ponder(grid); // Start thinking about the first board
+
+    auto startTime = std::chrono::steady_clock::now() - std::chrono::seconds(resume ? checkpoint.elapsedSeconds : 0);
+    int movesMade = resume ? checkpoint.moveCount : 0;
+    checkpoint.seed = seed;
+    checkpoint.timedMode = timedMode;
+    checkpoint.timeLimit = timeLimit;
+    CheckpointWriter checkpointWriter(checkpointPath);  // Writes in the background
+    auto saveGame = [&]() {
+        checkpoint.grid = flattenGrid(grid);
+        checkpoint.score = score;
+        checkpoint.moveCount = movesMade;
+        checkpoint.elapsedSeconds = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime).count());
+        rng.saveState(checkpoint.rngState);
+        checkpointWriter.save(checkpoint);
+    };
+    GridRenderer renderer; // Draws the board once, then only the cells that change
 
     // Main game loop
     while (true) {
-        clear(); // Clear the screen to prepare for drawing the grid
-        displayGrid(grid, score, bestScore); // Display the grid, score, and best score
+        renderer.render(grid, score, bestScore); // Display the grid, score, and best score
 
         // Check timer only if timed mode is enabled
         if (timedMode) {
@@ -53,8 +121,11 @@ int main() {
             int elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - startTime).count();
 
              mvprintw(gridSize * 2 + 6, 0, "Time left: %d seconds", timeLimit - elapsed);
+             clrtoeol(); // The number of digits goes down
 
             if (elapsed >= timeLimit) {
+                ponderer.stop();
+                checkpointWriter.discard(); // Nothing left to resume
                 mvprintw(gridSize * 2 + 6, 0, "Time's up! Game over.");
                 refresh();
                 getch();
@@ -64,6 +135,8 @@ int main() {
 
         // Check if the game is over
         if (isGameOver(grid)) {
+            ponderer.stop();
+            checkpointWriter.discard(); // Nothing left to resume
             mvprintw(gridSize * 2 + 5, 0, "Game Over! No more valid moves!"); // Game over message
             mvprintw(gridSize * 2 + 6, 0, "Press any key to exit...");
             refresh(); // Refresh the screen to show game-over messages
@@ -71,29 +144,23 @@ int main() {
             break; // Exit the main game loop
         }
 
-        // Show hint if available
+        // Show hint if available (the line is erased once the hint is used)
+        move(gridSize * 2 + 9, 0);
+        clrtoeol();
         if (!currentHint.empty()) {
             mvprintw(gridSize * 2 + 9, 0, "Hint: %s", currentHint.c_str());
         }
 
         // Show instructions for player input
-        mvprintw(gridSize * 2 + 2, 0, "Press U to Undo, H for Hint, Arrow Keys/WASD to move, Q to Quit.");
+        mvprintw(gridSize * 2 + 2, 0, "Press U/R to Undo/Redo, H for Hint, Arrow Keys/WASD to move, Q to Quit.");
         refresh();
         input = getch(); // Get user input
+        move(gridSize * 2 + 7, 0); // Erase the previous invalid input message
+        clrtoeol();
 
         bool validMove = false; // Flag to check if the input was valid
         bool moved = false; // Flag to check if the grid changed
 
-        // Save the current state BEFORE making any move
-        if (input == 'W' || input == 'w' || input == KEY_UP ||
-            input == 'A' || input == 'a' || input == KEY_LEFT ||
-            input == 'S' || input == 's' || input == KEY_DOWN ||
-            input == 'D' || input == 'd' || input == KEY_RIGHT) {
-            prevGrid = grid; // Save the current grid state
-            prevScore = score; // Save the current score
-            undoAvailable = true; // Undo becomes available after saving
-        }
-
         // Handle user input and perform corresponding moves
         switch (input) {
             case 'W': case 'w': case KEY_UP:
@@ -104,21 +171,37 @@ int main() {
                 validMove = moveDown(grid, moved, score); break; // Move down
             case 'D': case 'd': case KEY_RIGHT:
                 validMove = moveRight(grid, moved, score); break; // Move right
-            case 'U': case 'u': // Handle Undo
-                if (undoAvailable) {
-                    grid = prevGrid; // Revert grid to previous state
-                    score = prevScore; // Revert score to previous state
-                    undoAvailable = false; // Undo is now unavailable
-                } 
+            case 'U': case 'u': // Handle Undo (back one move per press)
+            case 'R': case 'r': { // Handle Redo (forward again after undoing)
+                bool changed = (input == 'U' || input == 'u') ? history.undo(grid, score)
+                                                              : history.redo(grid, score);
+                if (changed) {
+                    currentHint = "";
+                    ponderer.ponder(grid); // Cancels the search of the board we left
+                    movesMade += (input == 'U' || input == 'u') ? -1 : 1;
+                    saveGame();
+                }
                 refresh();
                 continue; // Skip the rest of the loop after undo
-            case 'H': case 'h': // Handle Hint
-                currentHint = getBestMove(grid, score);
+            }
+            case 'H': case 'h': { // Handle Hint
+                // The background search has usually finished a few iterations already.
+                // In timed mode the wait never takes more than a tenth of the remaining time.
+                long long remainingMs = timeLimit * 1000LL -
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime)
+                        .count();
+                int hintDepth = 0;
+                currentHint = ponderer.bestMove(hintWaitBudget(hintWaitMs, timedMode, remainingMs), hintDepth);
                 if (currentHint == "None") {
                     currentHint = "No valid move found.";
+                } else {
+                    currentHint += " (depth " + std::to_string(hintDepth) + ")";
                 }
                 continue; // Skip the rest of the loop after showing the hint
+            }
             case 'Q': case 'q':
+                ponderer.stop();
+                saveGame(); // Continue later with --resume
                 endwin(); // End ncurses mode
                 return 0;
             default:
@@ -129,16 +212,27 @@ int main() {
 
         // If the move was valid and the grid changed, add a new random tile
         if (validMove && moved) {
-            addRandomTile(grid); // Add a new random tile after saving the state
+            addRandomTile(grid, rng); // Add a new random tile
+            history.push(grid, score); // Record the position reached (a few bytes, no allocation)
+            ++movesMade;
+            saveGame();
             currentHint = "";  // Clear hint after a valid move
+            ponderer.ponder(grid); // Cancels the search of the previous board
         }
     }
 
-     // Update the best score if the current score is higher
-    if (score > bestScore) {
-        bestScore = score;
-        saveBestScore(bestScore); // Save the new best score to the file
+    // Record the finished game (a game left with Q is resumed instead)
+    StoredResult result;
+    result.gridSize = gridSize;
+    result.mode = resultMode;
+    result.score = score;
+    for (const auto& row : grid) {
+        for (int value : row) result.maxTile = std::max(result.maxTile, value);
     }
+    result.moves = movesMade;
+    result.timestamp = static_cast<uint64_t>(std::time(0));
+    results.add(result);
+    results.flush();
 
     endwin(); // End ncurses mode and restore the terminal
     return 0;
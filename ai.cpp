@@ -1,8 +1,24 @@
 #include "ai.hpp"
 #include "modele.hpp"  // Include game logic functions
+#include "bitboard.hpp" // Packed 4x4 board used by the fast search path
+#include "transposition.hpp" // Cache of expectimax results
+#include "threadpool.hpp"    // Workers for the parallel search
+#include "simdeval.hpp"      // Vectorized evaluation kernels
+#include "ntuple.hpp"        // Learned evaluation
+#include "sizedboard.hpp"    // Packed 5x5 and 6x6 boards
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
-#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 
 /////////////////////////////////////////////////////////////////////////////////
 // Function: evaluateGrid
@@ -10,9 +26,10 @@
 //              considers score, empty tiles, monotonicity, and merge potential.
 // Parameters:
 //   - grid: The current state of the game grid as a 2D vector of integers.
-// Returns: An integer representing the evaluation score of the grid.
+// Returns: An integer representing the evaluation score of the grid (64-bit:
+//          a large tile sum times a large weight does not fit in an int).
 /////////////////////////////////////////////////////////////////////////////////
-int evaluateGrid(const std::vector<std::vector<int>>& grid) {
+int64_t evaluateGrid(const std::vector<std::vector<int>>& grid) {
     int emptyTiles = 0;      // Count of empty tiles in the grid
     int score = 0;           // Total sum of all tile values (game score)
     int monotonicity = 0;    // Tracks the smoothness/order of tiles
@@ -49,13 +66,452 @@ int evaluateGrid(const std::vector<std::vector<int>>& grid) {
     }
 
     // Return the weighted evaluation score
-    // Weights:
+    // Default weights (see setEvalWeights):
     // - Empty tiles (200): Keeps more available moves
     // - Monotonicity (50): Keeps tiles ordered
     // - Merge Potential (100): Encourages merges
-    return score + emptyTiles * 200 + monotonicity * 50 + mergePotential * 100;
+    const EvalWeights& weights = evalWeights();
+    return static_cast<int64_t>(score) * weights.tileSum + static_cast<int64_t>(emptyTiles) * weights.empty +
+           static_cast<int64_t>(monotonicity) * weights.monotonicity +
+           static_cast<int64_t>(mergePotential) * weights.mergePotential;
 }
 
+namespace {
+
+EvalWeights currentWeights;                     // Weights of every evaluation
+EvalBackend currentBackend = EVAL_BACKEND_TABLE;  // Implementation of evaluateBoard
+uint64_t networkChecksum = 0;                   // Network evaluated by EVAL_BACKEND_NTUPLE
+
+} // namespace
+
+void setEvalBackend(EvalBackend backend) {
+    bool wasNetwork = (currentBackend == EVAL_BACKEND_NTUPLE);
+    currentBackend = backend;
+    if (backend == EVAL_BACKEND_NTUPLE) networkChecksum = sharedNTupleNetwork().checksum();
+    if (wasNetwork || backend == EVAL_BACKEND_NTUPLE) {
+        sharedTranspositionTable().setVersion(evalWeightsVersion());  // The heuristic and the network disagree
+    }
+}
+
+EvalBackend evalBackend() {
+    return currentBackend;
+}
+
+void setEvalWeights(const EvalWeights& weights) {
+    currentWeights = weights;
+    buildEvalTables(weights);
+    sharedTranspositionTable().setVersion(evalWeightsVersion());  // Cached values were computed with the old weights
+}
+
+const EvalWeights& evalWeights() {
+    return currentWeights;
+}
+
+uint64_t evalWeightsVersion() {
+    const int fields[4] = {currentWeights.tileSum, currentWeights.empty, currentWeights.monotonicity,
+                           currentWeights.mergePotential};
+    // FNV-1a, seeded with the cache format version (bump it whenever the keys change;
+    // 2: SizedBoard keys of 5x5 and 6x6 boards, cutoff mixed into the keys)
+    uint64_t hash = 0xCBF29CE484222325ULL ^ 2;
+    for (int field : fields) {
+        hash = (hash ^ static_cast<uint32_t>(field)) * 0x100000001B3ULL;
+    }
+    if (currentBackend == EVAL_BACKEND_NTUPLE) {
+        hash = (hash ^ networkChecksum) * 0x100000001B3ULL;  // 4x4 values come from the network
+    }
+    return hash;
+}
+
+bool loadNTupleEvaluator(const std::string& path) {
+    if (!sharedNTupleNetwork().load(path)) return false;
+    setEvalBackend(EVAL_BACKEND_NTUPLE);
+    return true;
+}
+
+// Named fields of a weights file
+static int* weightField(EvalWeights& weights, const std::string& name) {
+    if (name == "tileSum") return &weights.tileSum;
+    if (name == "empty") return &weights.empty;
+    if (name == "monotonicity") return &weights.monotonicity;
+    if (name == "mergePotential") return &weights.mergePotential;
+    return nullptr;
+}
+
+bool readEvalWeights(const std::string& path, EvalWeights& weights) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) return false;
+    EvalWeights result = weights;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));  // Strip comments
+        std::istringstream fields(line);
+        std::string name;
+        if (!(fields >> name)) continue;        // Blank line
+        long value = -1;
+        std::string extra;
+        int* field = weightField(result, name);
+        if (!field || !(fields >> value) || (fields >> extra) || value < 0 || value > 1000000) return false;
+        *field = static_cast<int>(value);
+    }
+    weights = result;
+    return true;
+}
+
+bool writeEvalWeights(const std::string& path, const EvalWeights& weights) {
+    std::ofstream file(path.c_str());
+    if (!file.is_open()) return false;
+    file << "# Weights of the evaluateGrid heuristic\n"
+         << "tileSum " << weights.tileSum << "\n"
+         << "empty " << weights.empty << "\n"
+         << "monotonicity " << weights.monotonicity << "\n"
+         << "mergePotential " << weights.mergePotential << "\n";
+    return static_cast<bool>(file);
+}
+
+// Weights of the heuristic terms, as in evaluateGrid
+static int64_t weightedEvaluation(const EvalTerms& terms) {
+    return static_cast<int64_t>(terms.sum) * currentWeights.tileSum +
+           static_cast<int64_t>(terms.empty) * currentWeights.empty +
+           static_cast<int64_t>(terms.monotonicity) * currentWeights.monotonicity +
+           static_cast<int64_t>(terms.mergePotential) * currentWeights.mergePotential;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: evaluateBoard
+// Description: Same heuristic as evaluateGrid, computed on a packed 4x4 board
+//              without any heap allocation. By default the score is read from
+//              the precomputed row tables (eight lookups); the SIMD backend
+//              computes the terms with the fastest kernel the CPU supports.
+//              The n-tuple backend returns the value of the loaded network
+//              instead, rounded and clamped at 0.
+// Parameters:
+//   - board: The packed 4x4 board.
+// Returns: The same evaluation score evaluateGrid gives for the unpacked grid.
+/////////////////////////////////////////////////////////////////////////////////
+int64_t evaluateBoard(Board board) {
+    if (currentBackend == EVAL_BACKEND_TABLE) {
+        return tableEvaluateBoard(board);
+    }
+    if (currentBackend == EVAL_BACKEND_NTUPLE) {
+        const NTupleNetwork& network = sharedNTupleNetwork();
+        if (network.empty()) return tableEvaluateBoard(board);  // No network loaded
+        float value = network.value(board);
+        return (value > 0.0f) ? static_cast<int>(value + 0.5f) : 0;  // The searches expect values >= 0
+    }
+    uint8_t cells[EVAL_PADDED_CELLS] = {0};  // The kernels read past the 16 cells
+    unpackBoardCells(board, cells);
+    return weightedEvaluation(computeEvalTerms(cells, 4));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: evaluateGrid (flat grid)
+// Description: Same heuristic as evaluateGrid on a flat grid, computed by the
+//              fastest SIMD kernel the CPU supports. Exponents are compared
+//              directly: they are ordered like the tile values.
+// Parameters:
+//   - grid: The flat grid.
+// Returns: The same evaluation score evaluateGrid gives for the 2D grid.
+/////////////////////////////////////////////////////////////////////////////////
+int64_t evaluateGrid(const FlatGrid& grid) {
+    uint8_t cells[EVAL_PADDED_CELLS] = {0};
+    for (int i = 0; i < grid.size * grid.size; ++i) {
+        cells[i] = grid.cells[i];
+    }
+    return weightedEvaluation(computeEvalTerms(cells, grid.size));
+}
+
+// Name of a move index as returned by getBestMove (-1 means no move is possible)
+static std::string moveName(int move) {
+    static const char* moveNames[] = {"Up", "Down", "Left", "Right"};
+    return (move < 0) ? "None" : moveNames[move];
+}
+
+// Apply one of the four moves to a packed board (0 = Up, 1 = Down, 2 = Left, 3 = Right)
+static Board applyBoardMove(Board board, int move, int& scoreDelta) {
+    switch (move) {
+        case 0: return boardMoveUp(board, scoreDelta);
+        case 1: return boardMoveDown(board, scoreDelta);
+        case 2: return boardMoveLeft(board, scoreDelta);
+        default: return boardMoveRight(board, scoreDelta);
+    }
+}
+
+namespace {
+
+// Position helpers: the searches below are templates that run on packed 4x4
+// boards, packed 5x5 and 6x6 boards and flat grids through this small overload set.
+
+// Packed boards
+bool applyMove(Board& board, int move, int& reward) {
+    reward = 0;
+    Board moved = applyBoardMove(board, move, reward);
+    if (moved == board) return false;
+    board = moved;
+    return true;
+}
+bool applyMove(Board& board, int move) {
+    int reward;
+    return applyMove(board, move, reward);
+}
+uint64_t emptyCells(const Board& board) { return boardEmptyCellMask(board); }
+Board withTile(const Board& board, int cell, int exponent) { return setBoardCell(board, cell / 4, cell % 4, exponent); }
+int64_t evaluatePosition(const Board& board) { return evaluateBoard(board); }
+uint64_t positionKey(const Board& board) { return board; }  // The packed board is its own key
+
+// Flat grids
+bool applyMove(FlatGrid& grid, int move, int& reward) {
+    bool moved = false;
+    reward = 0;
+    switch (move) {
+        case 0: moveUp(grid, moved, reward); break;
+        case 1: moveDown(grid, moved, reward); break;
+        case 2: moveLeft(grid, moved, reward); break;
+        case 3: moveRight(grid, moved, reward); break;
+    }
+    return moved;
+}
+bool applyMove(FlatGrid& grid, int move) {
+    int reward;
+    return applyMove(grid, move, reward);
+}
+uint64_t emptyCells(const FlatGrid& grid) { return emptyCellMask(grid); }
+FlatGrid withTile(const FlatGrid& grid, int cell, int exponent) {
+    FlatGrid result = grid;
+    result.cells[cell] = static_cast<uint8_t>(exponent);
+    return result;
+}
+int64_t evaluatePosition(const FlatGrid& grid) { return evaluateGrid(grid); }
+uint64_t positionKey(const FlatGrid& grid) {
+    uint64_t key = 0xCBF29CE484222325ULL ^ grid.size;  // FNV-1a over the exponents
+    int cells = grid.size * grid.size;
+    for (int i = 0; i < cells; ++i) {
+        key = (key ^ grid.cells[i]) * 0x100000001B3ULL;
+    }
+    return key;
+}
+
+// Packed 5x5 and 6x6 boards (sizedboard.hpp)
+template <int N>
+bool applyMove(SizedBoard<N>& board, int move, int& reward) {
+    reward = 0;
+    SizedBoard<N> moved = sizedBoardMove(board, move, reward);
+    if (moved == board) return false;
+    board = moved;
+    return true;
+}
+template <int N>
+bool applyMove(SizedBoard<N>& board, int move) {
+    int reward;
+    return applyMove(board, move, reward);
+}
+template <int N>
+uint64_t emptyCells(const SizedBoard<N>& board) { return sizedEmptyCellMask(board); }
+template <int N>
+SizedBoard<N> withTile(const SizedBoard<N>& board, int cell, int exponent) {
+    SizedBoard<N> result = board;
+    result.setCell(cell, exponent);
+    return result;
+}
+template <int N>
+int64_t evaluatePosition(const SizedBoard<N>& board) {
+    uint8_t cells[EVAL_PADDED_CELLS] = {0};
+    unpackSizedBoard(board, cells);
+    return weightedEvaluation(computeEvalTerms(cells, N));  // Same value as evaluateGrid on the flat grid
+}
+template <int N>
+uint64_t positionKey(const SizedBoard<N>& board) {
+    uint64_t key = 0xCBF29CE484222325ULL ^ N;
+    for (int w = 0; w < SizedBoard<N>::WORDS; ++w) {
+        key = (key ^ board.words[w]) * 0x9E3779B97F4A7C15ULL;
+        key ^= key >> 32;
+    }
+    return key;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: searchPacked
+// Description: The one place where the grid size chosen in the menu becomes a
+//              compile-time size: runs `search` on the packed board of that
+//              size (Board for 4x4, SizedBoard<5> or SizedBoard<6>), or on the
+//              flat grid when a tile is too large for the packed cells.
+// Parameters:
+//   - grid: The flat grid.
+//   - search: A function object with an operator() template taking any position.
+// Returns: What search returns (a move index).
+/////////////////////////////////////////////////////////////////////////////////
+template <typename Search>
+int searchPacked(const FlatGrid& grid, const Search& search) {
+    switch (grid.size) {
+        case 4:
+            if (canPackGrid(grid)) return search(packGrid(grid));
+            break;
+        case 5:
+            if (canPackSizedBoard<5>(grid)) return search(packSizedBoard<5>(grid));
+            break;
+        case 6:
+            if (canPackSizedBoard<6>(grid)) return search(packSizedBoard<6>(grid));
+            break;
+    }
+    return search(grid);
+}
+
+// Search counters of one thread. Each pool worker bumps its own counters, so a
+// relaxed load and store is enough (no locked instruction), and the padding
+// keeps the counters of two threads off the same cache line. The threads
+// outside the pool share one slot: the caller, and the callers of other
+// searches, which run this search's tasks while they wait for their own.
+struct SearchCounters {
+    std::atomic<uint64_t> nodes[SEARCH_STATS_MAX_PLY];
+    std::atomic<uint64_t> evaluations;
+    std::atomic<uint64_t> noopMoves;
+    std::atomic<uint64_t> cacheProbes;
+    std::atomic<uint64_t> cacheHits;
+    std::atomic<uint64_t> cutoffs;
+    bool shared;  // Bumped by several threads at once (the slot of the threads outside the pool)
+    char padding[64];
+
+    SearchCounters() : evaluations(0), noopMoves(0), cacheProbes(0), cacheHits(0), cutoffs(0), shared(false) {
+        for (int ply = 0; ply < SEARCH_STATS_MAX_PLY; ++ply) nodes[ply] = 0;
+    }
+
+    void addTo(SearchStats& stats) const {
+        for (int ply = 0; ply < SEARCH_STATS_MAX_PLY; ++ply) stats.nodes[ply] += nodes[ply].load();
+        stats.evaluations += evaluations.load();
+        stats.noopMoves += noopMoves.load();
+        stats.cacheProbes += cacheProbes.load();
+        stats.cacheHits += cacheHits.load();
+        stats.cutoffs += cutoffs.load();
+    }
+};
+
+// A counter of one thread only needs a plain load and store; a shared one needs fetch_add
+inline void bump(const SearchCounters& counters, std::atomic<uint64_t>& counter) {
+    if (counters.shared) {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+inline void countNode(SearchCounters& counters, int ply) {
+    bump(counters, counters.nodes[std::min(ply, SEARCH_STATS_MAX_PLY - 1)]);
+}
+
+thread_local SearchStats lastStats;  // Stats of the last getBestMove call of this thread
+
+// Times one getBestMove call and starts its stats from zero
+class DecisionTimer {
+public:
+    DecisionTimer() : start(std::chrono::steady_clock::now()) { lastStats.clear(); }
+    ~DecisionTimer() {
+        lastStats.milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: lookaheadSearch
+// Description: Three-step lookahead of getBestMove on a packed board or a flat
+//              grid. Explores moves in the same order and breaks ties the same
+//              way as the original grid version, so it returns the same move.
+// Parameters:
+//   - position: The packed board or flat grid.
+// Returns: A move index (0 = Up, 1 = Down, 2 = Left, 3 = Right) or -1 if no move is possible.
+/////////////////////////////////////////////////////////////////////////////////
+template <typename Position>
+int lookaheadSearch(const Position& position, SearchCounters& counters) {
+    int64_t maxEvaluation = INT64_MIN;
+    int bestMove = -1;
+    countNode(counters, 0);
+
+    for (int move = 0; move < 4; ++move) {
+        Position tempPosition = position;
+        if (!applyMove(tempPosition, move)) {  // Skip move if no tiles were moved
+            bump(counters, counters.noopMoves);
+            continue;
+        }
+        countNode(counters, 1);
+
+        for (int nextMove = 0; nextMove < 4; ++nextMove) {
+            Position futurePosition = tempPosition;
+            if (!applyMove(futurePosition, nextMove)) {
+                bump(counters, counters.noopMoves);
+                continue;
+            }
+            countNode(counters, 2);
+
+            for (int lastMove = 0; lastMove < 4; ++lastMove) {
+                Position thirdPosition = futurePosition;
+                if (!applyMove(thirdPosition, lastMove)) {
+                    bump(counters, counters.noopMoves);
+                    continue;
+                }
+                countNode(counters, 3);
+
+                int64_t evaluation = evaluatePosition(thirdPosition);
+                bump(counters, counters.evaluations);
+                if (evaluation > maxEvaluation) {
+                    maxEvaluation = evaluation;
+                    bestMove = move;
+                }
+            }
+        }
+    }
+    return bestMove;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: greedySearch
+// Description: One-ply search: picks the move maximizing the points it scores
+//              plus the evaluation of the board it leaves (before the tile
+//              spawns). This is how the n-tuple network is trained to play,
+//              and with it one decision costs four evaluations.
+// Parameters:
+//   - position: The packed board or flat grid.
+// Returns: A move index (0 = Up, 1 = Down, 2 = Left, 3 = Right) or -1 if no move is possible.
+/////////////////////////////////////////////////////////////////////////////////
+template <typename Position>
+int greedySearch(const Position& position, SearchCounters& counters) {
+    long long bestValue = -1;
+    int bestMove = -1;
+    countNode(counters, 0);
+
+    for (int move = 0; move < 4; ++move) {
+        Position afterstate = position;
+        int reward = 0;
+        if (!applyMove(afterstate, move, reward)) {
+            bump(counters, counters.noopMoves);
+            continue;
+        }
+        countNode(counters, 1);
+        long long value = static_cast<long long>(reward) + evaluatePosition(afterstate);
+        bump(counters, counters.evaluations);
+        if (value > bestValue) {
+            bestValue = value;
+            bestMove = move;
+        }
+    }
+    return bestMove;
+}
+
+// Search functors for searchPacked (C++11 lambdas cannot be templates)
+struct LookaheadSearch {
+    SearchCounters& counters;
+    template <typename Position>
+    int operator()(const Position& position) const { return lookaheadSearch(position, counters); }
+};
+
+struct GreedySearch {
+    SearchCounters& counters;
+    template <typename Position>
+    int operator()(const Position& position) const { return greedySearch(position, counters); }
+};
+
+} // namespace
+
 /////////////////////////////////////////////////////////////////////////////////
 // Function: getBestMove
 // Description: Determines the best move using a three-step lookahead by 
@@ -66,7 +522,14 @@ int evaluateGrid(const std::vector<std::vector<int>>& grid) {
 // Returns: A string representing the best move ("Up", "Down", "Left", "Right").
 /////////////////////////////////////////////////////////////////////////////////
 std::string getBestMove(const std::vector<std::vector<int>>& grid, int currentScore) {
-    int maxEvaluation = INT_MIN;  // Store the best evaluation score found
+    // Menu sizes are searched on a flat grid (or on the packed board for 4x4)
+    if (canFlattenGrid(grid)) {
+        return getBestMove(flattenGrid(grid), currentScore);
+    }
+    DecisionTimer timer;  // Only the time is measured on this path
+    lastStats.depth = 3;
+
+    int64_t maxEvaluation = INT64_MIN;  // Store the best evaluation score found
     std::string bestMove = "None";  // Track the best move based on evaluation
 
     // Temporary grids for simulating moves at different depths
@@ -123,7 +586,7 @@ std::string getBestMove(const std::vector<std::vector<int>>& grid, int currentSc
                 if (!thirdMoved) continue;  // Skip if no tiles moved in third move
 
                 // Evaluate the grid after three moves
-                int evaluation = evaluateGrid(thirdGrid);
+                int64_t evaluation = evaluateGrid(thirdGrid);
 
                 // Update the best move if this path is better
                 if (evaluation > maxEvaluation) {
@@ -142,3 +605,578 @@ std::string getBestMove(const std::vector<std::vector<int>>& grid, int currentSc
     // Return the best evaluated move
     return bestMove;
 }
+
+// Flat grid version of the three-step lookahead (4x4 grids use the packed board)
+std::string getBestMove(const FlatGrid& grid, int currentScore) {
+    (void)currentScore;  // The evaluation only looks at the board
+    DecisionTimer timer;
+    SearchCounters counters;
+    LookaheadSearch search = {counters};
+    int move = searchPacked(grid, search);
+    counters.addTo(lastStats);
+    lastStats.depth = 3;
+    return moveName(move);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Expectimax search
+// The player's moves are max nodes. After each move, a chance node averages over
+// every empty cell receiving a 2 (p = 0.9) or a 4 (p = 0.1), as addRandomTile does.
+// The same templates run on packed 4x4 boards and on flat grids.
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// End of a time-limited search, shared by all of its threads
+struct SearchDeadline {
+    std::chrono::steady_clock::time_point time;
+    std::atomic<bool> expired;
+    const std::atomic<bool>* cancel;  // Ends the search early when it becomes true, or nullptr
+    const std::function<void(int, int)>* onIteration;  // Gets the depth and move of finished iterations, or nullptr
+};
+
+// Settings shared by every node of one search
+struct ExpectimaxContext {
+    double probCutoff;
+    uint64_t cutoffKey;         // Mixed into the cache keys (see cutoffCacheKey)
+    TranspositionTable* table;  // nullptr when caching is off
+    ThreadPool* pool;           // nullptr for a single-threaded search
+    int splitDepth;             // Chance nodes with at least this depth left expand their children in parallel
+    SearchDeadline* deadline;   // nullptr for a search without time limit
+    int rootDepth;              // Depth of the current iteration, to count nodes per ply
+    SearchCounters* counters;   // One per pool worker, plus one shared by the threads outside the pool
+};
+
+// A cached value depends on the cutoff, which decides where leaves are
+// evaluated, so searches with other cutoffs must not share entries
+uint64_t cutoffCacheKey(double probCutoff) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &probCutoff, sizeof(bits));
+    bits *= 0x9E3779B97F4A7C15ULL;
+    return bits ^ (bits >> 29);
+}
+
+// Counters of the thread running a node
+SearchCounters& threadCounters(const ExpectimaxContext& context) {
+    return context.counters[context.pool ? context.pool->workerIndex() : 0];
+}
+
+// True once the deadline of the search has passed (only reads the flag)
+bool deadlineExpired(const ExpectimaxContext& context) {
+    return context.deadline && context.deadline->expired.load(std::memory_order_relaxed);
+}
+
+// Compare the clock with the deadline and raise the flag once it has passed
+bool checkDeadline(const ExpectimaxContext& context) {
+    if (!context.deadline) return false;
+    if (context.deadline->expired.load(std::memory_order_relaxed)) return true;
+    const std::atomic<bool>* cancel = context.deadline->cancel;
+    bool cancelled = cancel && cancel->load(std::memory_order_relaxed);
+    if (!cancelled && std::chrono::steady_clock::now() < context.deadline->time) return false;
+    context.deadline->expired.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+// Pools shared by the parallel searches, one per requested thread count. A
+// pool is built on first use and kept until the program ends, so callers that
+// alternate thread counts (the hint ponderer next to another search) never
+// rebuild one, and no search loses its pool while it runs.
+ThreadPool* searchThreadPool(int threads) {
+    static std::mutex poolMutex;
+    static std::map<int, std::unique_ptr<ThreadPool>> pools;
+    std::lock_guard<std::mutex> lock(poolMutex);
+    std::unique_ptr<ThreadPool>& pool = pools[threads];
+    // The calling thread helps while it waits, so the pool needs one thread less
+    if (!pool) pool.reset(new ThreadPool(threads - 1));
+    return pool.get();
+}
+
+template <typename Position>
+double chanceNode(const Position& position, int depth, double prob, const ExpectimaxContext& context);
+
+// Max node: the best value over the player's possible moves. A position without
+// any possible move is lost and is worth nothing.
+// The probability is rounded down to a power of two so the value only depends on
+// (position, depth, bucket), which is what the transposition table stores.
+template <typename Position>
+double maxNode(const Position& position, int depth, double prob, const ExpectimaxContext& context) {
+    int bucket = 0;
+    prob = quantizeProbability(prob, bucket);
+    if (depth >= 2 && checkDeadline(context)) return 0.0;  // Out of time: the caller discards this value
+
+    SearchCounters& counters = threadCounters(context);
+    uint64_t key = 0;
+    if (context.table) {
+        key = positionKey(position) ^ context.cutoffKey;
+        float cached = 0.0f;
+        int cachedMove = -1;
+        bump(counters, counters.cacheProbes);
+        if (context.table->probe(key, depth, bucket, cached, cachedMove)) {
+            bump(counters, counters.cacheHits);
+            return cached;
+        }
+    }
+    countNode(counters, context.rootDepth - depth);
+
+    double best = 0.0;
+    int bestMove = -1;
+    for (int move = 0; move < 4; ++move) {
+        Position next = position;
+        if (!applyMove(next, move)) {  // Skip moves that change nothing
+            bump(counters, counters.noopMoves);
+            continue;
+        }
+        double value = chanceNode(next, depth - 1, prob, context);
+        if (value > best) {
+            best = value;
+            bestMove = move;
+        }
+    }
+
+    if (deadlineExpired(context)) return 0.0;  // Never cache a value computed after the deadline
+
+    if (context.table) {
+        best = static_cast<float>(best);  // Same rounding whether the value comes from the table or not
+        context.table->store(key, depth, bucket, static_cast<float>(best), bestMove);
+    }
+    return best;
+}
+
+// Chance node: the expected value over every possible spawn. Branches are not
+// expanded once the search depth is used up or once the probability of reaching
+// them falls below the cutoff; the heuristic is used instead.
+template <typename Position>
+double chanceNode(const Position& position, int depth, double prob, const ExpectimaxContext& context) {
+    if (depth <= 0 || prob < context.probCutoff) {
+        SearchCounters& counters = threadCounters(context);
+        bump(counters, counters.evaluations);
+        if (depth > 0) bump(counters, counters.cutoffs);
+        return evaluatePosition(position);
+    }
+
+    uint64_t empty = emptyCells(position);  // Bit k is set when cell k is empty
+    int emptyCount = __builtin_popcountll(empty);
+    if (emptyCount == 0) {  // No tile can spawn
+        SearchCounters& counters = threadCounters(context);
+        bump(counters, counters.evaluations);
+        return evaluatePosition(position);
+    }
+
+    double total = 0.0;
+    double cellProb = prob / emptyCount;
+
+    // Deep subtrees: expand every spawn as its own task, then add the values
+    // in cell order so the result does not depend on the thread schedule
+    if (context.pool && depth >= context.splitDepth) {
+        std::vector<double> values(2 * emptyCount, 0.0);
+        TaskGroup group(*context.pool);
+        int index = 0;
+        for (uint64_t cells = empty; cells != 0; cells &= cells - 1, ++index) {
+            int cell = __builtin_ctzll(cells);
+            for (int spawn = 0; spawn < 2; ++spawn) {
+                group.run([&position, &values, &context, cell, index, spawn, depth, cellProb]() {
+                    double spawnProb = (spawn == 0) ? 0.9 : 0.1;
+                    values[2 * index + spawn] = maxNode(withTile(position, cell, spawn + 1), depth,
+                                                        cellProb * spawnProb, context);
+                });
+            }
+        }
+        group.wait();
+        for (int i = 0; i < emptyCount; ++i) {
+            total += 0.9 * values[2 * i];
+            total += 0.1 * values[2 * i + 1];
+        }
+        return total / emptyCount;
+    }
+
+    for (uint64_t cells = empty; cells != 0; cells &= cells - 1) {
+        int cell = __builtin_ctzll(cells);
+        total += 0.9 * maxNode(withTile(position, cell, 1), depth, cellProb * 0.9, context);
+        total += 0.1 * maxNode(withTile(position, cell, 2), depth, cellProb * 0.1, context);
+    }
+    return total / emptyCount;
+}
+
+// Pick the best of the searched root moves; ties go to the first move in
+// Up, Down, Left, Right order, whatever the thread count
+int pickBestMove(const bool searched[4], const double values[4]) {
+    int bestMove = -1;
+    double bestValue = -1.0;
+    for (int move = 0; move < 4; ++move) {
+        if (searched[move] && values[move] > bestValue) {
+            bestValue = values[move];
+            bestMove = move;
+        }
+    }
+    return bestMove;
+}
+
+// Search the legal root moves to the given depth, in parallel when a pool is
+// available and otherwise in the given order. completed[move] is false for a
+// move whose search was cut short by the deadline.
+template <typename Position>
+void searchRootMoves(const Position children[4], const bool legal[4], const int order[4], int depth,
+                     const ExpectimaxContext& context, double values[4], bool completed[4]) {
+    for (int move = 0; move < 4; ++move) {
+        values[move] = 0.0;
+        completed[move] = false;
+    }
+    if (context.pool) {
+        TaskGroup group(*context.pool);
+        for (int move = 0; move < 4; ++move) {
+            if (!legal[move]) continue;
+            group.run([children, values, completed, &context, move, depth]() {
+                values[move] = chanceNode(children[move], depth - 1, 1.0, context);
+                completed[move] = !deadlineExpired(context);
+            });
+        }
+        group.wait();
+        return;
+    }
+    for (int i = 0; i < 4; ++i) {
+        int move = order[i];
+        if (!legal[move]) continue;
+        values[move] = chanceNode(children[move], depth - 1, 1.0, context);
+        completed[move] = !deadlineExpired(context);
+        if (!completed[move]) return;
+    }
+}
+
+// Root of the expectimax search. Without a deadline, searches options.depth plies.
+// With a deadline, deepens one ply at a time, searching the previous best move
+// first, and keeps the result of the deepest iteration that finished in time.
+template <typename Position>
+int expectimaxRoot(const Position& position, const SearchOptions& options, SearchDeadline* deadline) {
+    ExpectimaxContext context;
+    context.probCutoff = options.probCutoff;
+    context.cutoffKey = cutoffCacheKey(options.probCutoff);
+    context.table = nullptr;
+    if (options.useTranspositionTable && sharedTranspositionTable().enabled()) {
+        context.table = &sharedTranspositionTable();
+        context.table->newSearch();
+    }
+    context.pool = (options.threads > 1) ? searchThreadPool(options.threads) : nullptr;
+    context.splitDepth = 2;
+    context.deadline = deadline;
+    std::vector<SearchCounters> counters(context.pool ? context.pool->threadCount() + 1 : 1);
+    counters.back().shared = (context.pool != nullptr);
+    context.counters = &counters[0];
+    SearchCounters& rootCounters = threadCounters(context);  // The caller's slot, as in the nodes it runs
+
+    Position children[4];
+    bool legal[4];
+    for (int move = 0; move < 4; ++move) {
+        children[move] = position;
+        legal[move] = applyMove(children[move], move);
+        if (!legal[move]) bump(rootCounters, rootCounters.noopMoves);
+    }
+
+    double values[4];
+    bool completed[4];
+    int order[4] = {0, 1, 2, 3};
+    if (!deadline) {
+        context.rootDepth = options.depth;
+        countNode(rootCounters, 0);
+        searchRootMoves(children, legal, order, options.depth, context, values, completed);
+        for (const SearchCounters& workerCounters : counters) workerCounters.addTo(lastStats);
+        lastStats.depth = options.depth;
+        return pickBestMove(legal, values);
+    }
+
+    int bestMove = -1;
+    for (int depth = 1; depth <= options.depth; ++depth) {
+        context.rootDepth = depth;
+        countNode(rootCounters, 0);
+        searchRootMoves(children, legal, order, depth, context, values, completed);
+        if (!deadlineExpired(context)) {
+            bestMove = pickBestMove(legal, values);  // Depth 1 never reaches a max node, so it always completes
+            lastStats.depth = depth;
+            if (deadline->onIteration && bestMove >= 0) (*deadline->onIteration)(depth, bestMove);
+        } else {
+            // Unfinished iteration: a move that was fully searched only replaces the
+            // previous best if the previous best was fully searched too
+            if (bestMove >= 0 && completed[bestMove]) bestMove = pickBestMove(completed, values);
+            break;
+        }
+
+        // Search the current best move first in the next iteration
+        order[0] = bestMove;
+        for (int move = 0, i = 1; move < 4; ++move) {
+            if (move != bestMove) order[i++] = move;
+        }
+        if (bestMove < 0 || checkDeadline(context)) break;
+    }
+    for (const SearchCounters& workerCounters : counters) workerCounters.addTo(lastStats);
+    return bestMove;
+}
+
+struct ExpectimaxSearch {
+    const SearchOptions& options;
+    SearchDeadline* deadline;
+    template <typename Position>
+    int operator()(const Position& position) const { return expectimaxRoot(position, options, deadline); }
+};
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+// Monte Carlo rollouts
+// Every legal first move is followed by many games of random moves played to
+// the end, and the move whose games score the most on average is chosen.
+// Rollouts run in chunks, each with its own generator seeded from the position,
+// the move and the chunk number, so without a time limit the chosen move does
+// not depend on the thread count or on which thread ran a chunk.
+/////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const int ROLLOUT_CHUNK = 32;  // Rollouts per task
+
+// Tile spawns of the rollouts, as addRandomTile
+void spawnTile(Board& board, GameRng& rng) { spawnBoardTile(board, rng); }
+void spawnTile(FlatGrid& grid, GameRng& rng) { addRandomTile(grid, rng); }
+template <int N>
+void spawnTile(SizedBoard<N>& board, GameRng& rng) { spawnSizedBoardTile(board, rng); }
+
+// Points scored from an afterstate by random moves until the game is over.
+// Each move is drawn uniformly among the moves that change the position.
+template <typename Position>
+long long randomRollout(Position position, GameRng& rng) {
+    long long score = 0;
+    while (true) {
+        spawnTile(position, rng);  // There is an empty cell after every move
+        int order[4] = {0, 1, 2, 3};
+        int untried = 4;
+        bool moved = false;
+        while (untried > 0 && !moved) {
+            int pick = static_cast<int>(rng.below(untried));
+            int move = order[pick];
+            order[pick] = order[--untried];
+            int reward = 0;
+            moved = applyMove(position, move, reward);
+            score += reward;
+        }
+        if (!moved) return score;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: rolloutRoot
+// Description: Plays options.rollouts random games after every legal move (or,
+//              with a deadline, as many as fit before it) and picks the move
+//              with the best points scored plus mean rollout score. Each round
+//              gives every legal move one chunk per thread.
+// Parameters:
+//   - position: The packed board or flat grid.
+//   - options: Rollouts per move and threads.
+//   - deadline: End of the search, or nullptr.
+// Returns: A move index (0 = Up, 1 = Down, 2 = Left, 3 = Right) or -1 if no move is possible.
+/////////////////////////////////////////////////////////////////////////////////
+template <typename Position>
+int rolloutRoot(const Position& position, const SearchOptions& options, const SearchDeadline* deadline) {
+    SearchCounters counters;
+    countNode(counters, 0);
+    Position children[4];
+    int rewards[4];
+    bool legal[4];
+    for (int move = 0; move < 4; ++move) {
+        children[move] = position;
+        legal[move] = applyMove(children[move], move, rewards[move]);
+        if (legal[move]) countNode(counters, 1);
+        else bump(counters, counters.noopMoves);
+    }
+
+    ThreadPool* pool = (options.threads > 1) ? searchThreadPool(options.threads) : nullptr;
+    const int chunksPerRound = std::max(1, options.threads);
+    const long long target = std::max(1, options.rollouts);
+    const uint64_t baseSeed = positionKey(position);
+    long long totals[4] = {0, 0, 0, 0};
+    long long counts[4] = {0, 0, 0, 0};  // Rollouts played after each move
+    long long planned = 0;               // Rollouts per legal move of the rounds so far
+    for (uint64_t round = 0;; ++round) {
+        // Without a deadline the last round only plays what is missing
+        std::vector<int> sizes;
+        for (long long left = deadline ? chunksPerRound * ROLLOUT_CHUNK : target - planned;
+             left > 0 && static_cast<int>(sizes.size()) < chunksPerRound; left -= ROLLOUT_CHUNK) {
+            sizes.push_back(static_cast<int>(std::min<long long>(left, ROLLOUT_CHUNK)));
+        }
+        const int chunks = static_cast<int>(sizes.size());
+        std::vector<long long> scores(4 * chunks, 0);
+        std::vector<int> played(4 * chunks, 0);
+        auto runChunk = [&](int move, int chunk) {
+            GameRng rng(gameSeed(baseSeed, (round * chunksPerRound + chunk) * 4 + move));
+            long long sum = 0;
+            int r = 0;
+            // Long games (6x6) take milliseconds: the deadline is checked after every rollout
+            for (; r < sizes[chunk]; ++r) {
+                if (r > 0 && deadline && std::chrono::steady_clock::now() >= deadline->time) break;
+                sum += randomRollout(children[move], rng);
+            }
+            scores[4 * chunk + move] = sum;
+            played[4 * chunk + move] = r;
+        };
+        if (pool) {
+            TaskGroup group(*pool);
+            for (int chunk = 0; chunk < chunks; ++chunk) {
+                for (int move = 0; move < 4; ++move) {
+                    if (legal[move]) group.run([&runChunk, move, chunk]() { runChunk(move, chunk); });
+                }
+            }
+            group.wait();
+        } else {
+            for (int chunk = 0; chunk < chunks; ++chunk) {
+                for (int move = 0; move < 4; ++move) {
+                    if (legal[move]) runChunk(move, chunk);
+                }
+            }
+        }
+        for (int chunk = 0; chunk < chunks; ++chunk) {
+            planned += sizes[chunk];
+            for (int move = 0; move < 4; ++move) {
+                totals[move] += scores[4 * chunk + move];
+                counts[move] += played[4 * chunk + move];
+            }
+        }
+        if (deadline ? std::chrono::steady_clock::now() >= deadline->time : planned >= target) break;
+    }
+
+    double values[4];
+    uint64_t rollouts = 0;
+    for (int move = 0; move < 4; ++move) {
+        values[move] = legal[move] ? rewards[move] + static_cast<double>(totals[move]) / counts[move] : 0.0;
+        rollouts += counts[move];
+    }
+    counters.evaluations += rollouts;  // One per rollout
+    counters.addTo(lastStats);
+    lastStats.depth = 1;
+    return pickBestMove(legal, values);
+}
+
+struct RolloutSearch {
+    const SearchOptions& options;
+    const SearchDeadline* deadline;
+    template <typename Position>
+    int operator()(const Position& position) const { return rolloutRoot(position, options, deadline); }
+};
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: getBestMove (with options)
+// Description: Chooses the search algorithm from the options. SEARCH_LOOKAHEAD is
+//              the classic three-step lookahead; SEARCH_EXPECTIMAX searches
+//              options.depth player moves and models the random tile spawns;
+//              SEARCH_GREEDY looks one move ahead, adding the points scored;
+//              SEARCH_ROLLOUT plays options.rollouts random games per move.
+// Parameters:
+//   - grid: The current game grid as a 2D vector of integers.
+//   - currentScore: The current game score.
+//   - options: Search algorithm, depth and probability cutoff.
+// Returns: A string representing the best move ("Up", "Down", "Left", "Right") or "None".
+/////////////////////////////////////////////////////////////////////////////////
+std::string getBestMove(const std::vector<std::vector<int>>& grid, int currentScore, const SearchOptions& options) {
+    if (!canFlattenGrid(grid)) return getBestMove(grid, currentScore);
+    return getBestMove(flattenGrid(grid), currentScore, options);
+}
+
+std::string getBestMove(const FlatGrid& grid, int currentScore, const SearchOptions& options) {
+    if (options.mode == SEARCH_LOOKAHEAD) {
+        return getBestMove(grid, currentScore);
+    }
+    DecisionTimer timer;
+    if (options.mode == SEARCH_ROLLOUT) {
+        RolloutSearch search = {options, nullptr};
+        return moveName(searchPacked(grid, search));
+    }
+    if (options.mode == SEARCH_GREEDY) {
+        SearchCounters counters;
+        GreedySearch search = {counters};
+        int move = searchPacked(grid, search);
+        counters.addTo(lastStats);
+        lastStats.depth = 1;
+        return moveName(move);
+    }
+    ExpectimaxSearch search = {options, nullptr};
+    return moveName(searchPacked(grid, search));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: getBestMove (with a time limit)
+// Description: Iterative deepening expectimax: searches 1, 2, 3... plies up to
+//              options.depth, each iteration starting with the previous best
+//              move, and stops when the time limit is reached. The move of the
+//              deepest finished iteration is returned, so the call takes about
+//              timeLimitMs whatever the board size. With SEARCH_ROLLOUT, random
+//              games are played until the time is up instead; other modes
+//              use expectimax.
+// Parameters:
+//   - grid: The current game grid as a 2D vector of integers.
+//   - currentScore: The current game score.
+//   - options: Maximum depth, probability cutoff, threads.
+//   - timeLimitMs: Time budget of the search in milliseconds.
+// Returns: A string representing the best move ("Up", "Down", "Left", "Right") or "None".
+/////////////////////////////////////////////////////////////////////////////////
+std::string getBestMove(const std::vector<std::vector<int>>& grid, int currentScore, const SearchOptions& options,
+                        int timeLimitMs) {
+    if (!canFlattenGrid(grid)) return getBestMove(grid, currentScore);
+    return getBestMove(flattenGrid(grid), currentScore, options, timeLimitMs);
+}
+
+std::string getBestMove(const FlatGrid& grid, int currentScore, const SearchOptions& options, int timeLimitMs) {
+    (void)currentScore;  // The evaluation only looks at the board
+    DecisionTimer timer;
+    SearchDeadline deadline;
+    deadline.time = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeLimitMs);
+    deadline.expired = false;
+    deadline.cancel = nullptr;
+    deadline.onIteration = nullptr;
+    if (options.mode == SEARCH_ROLLOUT) {
+        RolloutSearch search = {options, &deadline};
+        return moveName(searchPacked(grid, search));
+    }
+    ExpectimaxSearch search = {options, &deadline};
+    return moveName(searchPacked(grid, search));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: ponderBestMove
+// Description: Iterative deepening expectimax without a time limit, for a
+//              search running in the background: deepens up to options.depth
+//              and reports the move of every finished iteration, until the
+//              caller cancels it. Other modes use expectimax.
+// Parameters:
+//   - grid: The current game grid.
+//   - options: Maximum depth, probability cutoff, threads.
+//   - cancel: Ends the search (as soon as its running nodes see it) once true.
+//   - onIteration: Called on the searching thread with the depth and the move
+//                  of every iteration that finished before the cancellation.
+// Returns: The move of the deepest finished iteration, or "None".
+/////////////////////////////////////////////////////////////////////////////////
+std::string ponderBestMove(const FlatGrid& grid, const SearchOptions& options, const std::atomic<bool>& cancel,
+                           const std::function<void(int depth, const std::string& move)>& onIteration) {
+    DecisionTimer timer;
+    std::function<void(int, int)> reportIteration = [&onIteration](int depth, int move) {
+        onIteration(depth, moveName(move));
+    };
+    SearchDeadline deadline;
+    deadline.time = std::chrono::steady_clock::time_point::max();
+    deadline.expired = false;
+    deadline.cancel = &cancel;
+    deadline.onIteration = &reportIteration;
+    ExpectimaxSearch search = {options, &deadline};
+    return moveName(searchPacked(grid, search));
+}
+
+// Stats of the last getBestMove call made by the calling thread
+const SearchStats& lastSearchStats() {
+    return lastStats;
+}
+
+// Allocate the shared transposition table (0 frees it)
+void configureTranspositionTable(size_t megabytes) {
+    sharedTranspositionTable().resize(megabytes);
+}
+
+bool openEvaluationCache(const std::string& path, size_t megabytes) {
+    return sharedTranspositionTable().mapFile(path, megabytes, evalWeightsVersion());
+}
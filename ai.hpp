@@ -1,12 +1,103 @@
 #ifndef AI_HPP
 #define AI_HPP
 
+#include <atomic>
+#include <functional>
 #include <vector>
 #include <string>
+#include <cstddef>
+#include "bitboard.hpp"
+#include "grid.hpp"
+#include "evaltable.hpp"
+#include "searchstats.hpp"
+
+// Search algorithms available to getBestMove
+enum SearchMode {
+    SEARCH_LOOKAHEAD,   // Three-step lookahead over the player's own moves
+    SEARCH_EXPECTIMAX,  // Expectimax with chance nodes for the random tile spawns
+    SEARCH_GREEDY,      // One move: points scored plus the evaluation of the board left (for the n-tuple network)
+    SEARCH_ROLLOUT      // Monte Carlo: random games played to the end after each move, best mean score wins
+};
+
+// Settings for getBestMove
+struct SearchOptions {
+    SearchMode mode;
+    int depth;          // Player moves searched by expectimax
+    double probCutoff;  // Branches less likely than this are evaluated instead of expanded
+    bool useTranspositionTable;  // Cache expectimax results in the shared table
+    int threads;        // Threads used by expectimax (the root moves and deep subtrees run in parallel) and rollouts
+    int rollouts;       // Random games per legal move of SEARCH_ROLLOUT (a time limit replaces it)
+
+    SearchOptions()
+        : mode(SEARCH_LOOKAHEAD), depth(3), probCutoff(0.0001), useTranspositionTable(true), threads(1),
+          rollouts(200) {}
+};
+
+// Implementations of evaluateBoard. The first two give the same values; the
+// n-tuple network is a learned evaluation of 4x4 boards (other sizes keep the
+// heuristic).
+enum EvalBackend {
+    EVAL_BACKEND_SIMD,   // Vector kernels over the unpacked cells (simdeval.hpp)
+    EVAL_BACKEND_TABLE,  // Precomputed row and column scores (evaltable.hpp), the default
+    EVAL_BACKEND_NTUPLE  // sharedNTupleNetwork() (ntuple.hpp), the expected score still to come
+};
+
+void setEvalBackend(EvalBackend backend);
+EvalBackend evalBackend();
+// Load a network written by the trainer and switch to EVAL_BACKEND_NTUPLE.
+// Returns false (backend unchanged) if the file is missing or invalid; 4x4
+// boards then fall back to the table heuristic until a network is loaded.
+bool loadNTupleEvaluator(const std::string& path);
+
+// Change the weights of the heuristic (200/50/100 by default) for every grid
+// type. Clears the shared transposition table (a cache file is reset when it
+// holds values of other weights). Not thread-safe: call it before searching.
+void setEvalWeights(const EvalWeights& weights);
+const EvalWeights& evalWeights();
+uint64_t evalWeightsVersion();  // Hash of the weights (and network), stored with cached values
+
+// Weights files hold one "name value" line per weight (tileSum, empty,
+// monotonicity, mergePotential); '#' starts a comment. Names left out keep the
+// value already in `weights`. Reading fails on a missing file, an unknown name
+// or a value that is not a non-negative integer.
+const char* const DEFAULT_WEIGHTS_FILE = "data/weights.txt";  // Loaded at startup when it exists
+bool readEvalWeights(const std::string& path, EvalWeights& weights);
+bool writeEvalWeights(const std::string& path, const EvalWeights& weights);
+
+// What the last getBestMove call of the calling thread did: nodes per ply,
+// evaluations, no-op moves, cache hits, cutoffs, depth and wall time
+const SearchStats& lastSearchStats();
+
+// Set the memory budget of the transposition table shared by all searches.
+// Call it before searching; the table is off (0 MB) until then.
+void configureTranspositionTable(size_t megabytes);
+// Keep the shared table in a cache file (created with `megabytes` if missing)
+// that every process opening it reads and fills, so searches reuse the results
+// of earlier runs (never those of other weights or another probCutoff).
+// Returns false if the file cannot be used (the table is then off).
+bool openEvaluationCache(const std::string& path, size_t megabytes);
 
 // Function to get the best move based on the current grid and score
 std::string getBestMove(const std::vector<std::vector<int>>& grid, int currentScore);
+std::string getBestMove(const std::vector<std::vector<int>>& grid, int currentScore, const SearchOptions& options);
+// Iterative deepening expectimax up to options.depth that returns within timeLimitMs
+std::string getBestMove(const std::vector<std::vector<int>>& grid, int currentScore, const SearchOptions& options,
+                        int timeLimitMs);
+
+// Evaluations are 64-bit: a large tile sum times a large weight overflows an int
+int64_t evaluateGrid(const std::vector<std::vector<int>>& grid);
+int64_t evaluateBoard(Board board); // Same heuristic on a packed 4x4 board
 
-int evaluateGrid(const std::vector<std::vector<int>>& grid);
+// Flat grid overloads: no heap allocation during the search
+int64_t evaluateGrid(const FlatGrid& grid);
+std::string getBestMove(const FlatGrid& grid, int currentScore);
+std::string getBestMove(const FlatGrid& grid, int currentScore, const SearchOptions& options);
+std::string getBestMove(const FlatGrid& grid, int currentScore, const SearchOptions& options, int timeLimitMs);
+// Iterative deepening expectimax up to options.depth without a time limit.
+// onIteration(depth, move) runs after every finished iteration; the search
+// stops early once `cancel` is true. For searches in a background thread
+// (see ponder.hpp).
+std::string ponderBestMove(const FlatGrid& grid, const SearchOptions& options, const std::atomic<bool>& cancel,
+                           const std::function<void(int depth, const std::string& move)>& onIteration);
 
 #endif // AI_HPP
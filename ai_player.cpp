@@ -1,23 +1,198 @@
 #include "modele.hpp"   // Game logic functions
 #include "ai.hpp"       // AI decision-making
+#include "transposition.hpp" // Transposition table statistics
+#include "renderer.hpp"  // Incremental board drawing
+#include "gamelog.hpp"  // Binary game records
+#include "checkpoint.hpp" // Saved games to resume
+#include "resultstore.hpp" // Finished games and best scores
 #include <vector>       // For dynamic 2D grid representation
+#include <string>       // For command-line options
 #include <iostream>     // For debugging and output (if needed)
 #include <cstdlib>      // For random number generation
+#include <algorithm>    // For std::max
+#include <thread>       // For the search thread
+#include <atomic>       // To stop the search thread
+#include <chrono>       // For the moves per second
+#include <mutex>        // For the frame handed to the screen
 #include <ctime>        // For seeding the random generator
 #include <curses.h>     // For graphical display using ncurses
 
+// Position after a move, handed from the search thread to the screen
+struct PlayerFrame {
+    std::vector<std::vector<int>> grid;
+    int score;
+    long long moves;        // Moves played so far
+    std::string bestMove;
+    std::string statsLine;  // Search stats and decision times
+    std::string tableLine;  // Transposition table stats
+    bool finished;          // Last frame of the game
+    bool gameOver;          // The game ended with no valid move (not with Q)
+
+    PlayerFrame() : score(0), moves(0), finished(false), gameOver(false) {}
+};
+
+// Holds the newest frame only: publishing replaces a frame the screen did not
+// take yet, so the search never waits for the screen
+class FrameMailbox {
+public:
+    FrameMailbox() : fresh(false) {}
+
+    void publish(const PlayerFrame& frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        latest = frame;
+        fresh = true;
+    }
+
+    // Take the newest frame if there is one the screen has not shown yet
+    bool take(PlayerFrame& frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!fresh) return false;
+        std::swap(frame, latest);
+        fresh = false;
+        return true;
+    }
+
+    // The last frame is still waiting for the screen
+    bool pending() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return fresh;
+    }
+
+private:
+    std::mutex mutex;
+    PlayerFrame latest;
+    bool fresh;
+};
+
 // Main function to run the AI-powered game
-int main() {
+// Options: --expectimax (search the random tile spawns), --depth N, --cutoff P,
+//          --tt MB (transposition table budget, 0 disables it), --threads N,
+//          --time MS (iterative deepening within MS milliseconds per move, up to --depth plies),
+//          --fps N (draw at most N frames per second, 30 by default, 0 for no cap; the search runs in its
+//          own thread and never waits for the screen), --turbo K (show only every Kth move, 0: only the final board),
+//          --seed S (tile generator seed: with a fixed-depth search the same seed replays the same game),
+//          --record FILE (append the game to a binary game log, see replay),
+//          --cache FILE (keep the transposition table in a file shared with other runs, --tt MB sizes a new file),
+//          --weights FILE (heuristic weights, data/weights.txt by default when it exists),
+//          --ntuple FILE (evaluate with a network written by train), --greedy (one-move search),
+//          --rollouts N (Monte Carlo: N random games per move on --threads threads, or as many as --time allows),
+//          --checkpoint FILE (where the game is saved, data/ai_player.ckpt by default),
+//          --checkpoint-every MS (save at most every MS milliseconds, 1000 by default, 0 after every move),
+//          --resume (continue the game saved in the checkpoint with its search settings; pass --weights,
+//          --ntuple and --cache again)
+int main(int argc, char* argv[]) {
     int gridSize = 4;         // Define the game grid size
     int score = 0;            // Initialize current game score
-    int bestScore = loadBestScore(); // Load the best score from a saved file
+    int bestScore = 0;        // Best AI score of the grid size, read once the size is known
     bool moved;               // Track whether a move was successful
 
+    // Read the search settings from the command line
+    SearchOptions searchOptions;
+    searchOptions.threads = std::max(1u, std::thread::hardware_concurrency());
+    int ttMegabytes = 64;
+    int moveTimeMs = 0;       // 0: fixed-depth search
+    bool depthGiven = false;
+    int maxFps = 30;          // 0: no cap, draw every frame the search thread hands over
+    int renderEvery = 1;      // Turbo mode: moves between frames (0: final board only)
+    uint64_t seed = static_cast<uint64_t>(std::time(0));  // Tile generator seed
+    std::string recordPath;   // Empty: the game is not recorded
+    std::string cachePath;    // Empty: in-memory transposition table
+    std::string weightsPath;  // Empty: data/weights.txt if it exists
+    std::string ntuplePath;   // Empty: heuristic evaluation
+    std::string checkpointPath = "data/ai_player.ckpt";
+    int checkpointEveryMs = 1000;
+    bool resume = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--expectimax") searchOptions.mode = SEARCH_EXPECTIMAX;
+        else if (arg == "--depth" && i + 1 < argc) {
+            searchOptions.depth = std::max(1, std::atoi(argv[++i]));
+            depthGiven = true;
+        }
+        else if (arg == "--cutoff" && i + 1 < argc) searchOptions.probCutoff = std::atof(argv[++i]);
+        else if (arg == "--tt" && i + 1 < argc) ttMegabytes = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc) searchOptions.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--time" && i + 1 < argc) moveTimeMs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--fps" && i + 1 < argc) maxFps = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--turbo" && i + 1 < argc) renderEvery = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+        else if (arg == "--cache" && i + 1 < argc) cachePath = argv[++i];
+        else if (arg == "--weights" && i + 1 < argc) weightsPath = argv[++i];
+        else if (arg == "--ntuple" && i + 1 < argc) ntuplePath = argv[++i];
+        else if (arg == "--greedy") searchOptions.mode = SEARCH_GREEDY;
+        else if (arg == "--rollouts" && i + 1 < argc) {
+            searchOptions.mode = SEARCH_ROLLOUT;
+            searchOptions.rollouts = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--checkpoint" && i + 1 < argc) checkpointPath = argv[++i];
+        else if (arg == "--checkpoint-every" && i + 1 < argc) checkpointEveryMs = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--resume") resume = true;
+    }
+    if (moveTimeMs > 0 && !depthGiven) searchOptions.depth = 10;  // Let the time limit decide
+    GameCheckpoint saved;
+    if (resume) {
+        if (!loadCheckpoint(checkpointPath, saved)) {
+            std::cout << "Could not read checkpoint " << checkpointPath << "\n";
+            return 1;
+        }
+        if (!recordPath.empty()) {
+            std::cout << "A resumed game cannot be recorded (the record needs the moves from the start)\n";
+            return 1;
+        }
+        int threads = searchOptions.threads;  // The machine may have changed
+        searchOptions = saved.search;
+        searchOptions.threads = threads;
+        moveTimeMs = saved.moveTimeMs;
+        gridSize = saved.grid.size;
+        seed = saved.seed;
+    }
+    EvalWeights weights;      // Tuned weights, loaded before the cache that is versioned with them
+    if (!weightsPath.empty()) {
+        if (!readEvalWeights(weightsPath, weights)) {
+            std::cout << "Could not read weights file " << weightsPath << "\n";
+            return 1;
+        }
+        setEvalWeights(weights);
+    } else if (readEvalWeights(DEFAULT_WEIGHTS_FILE, weights)) {
+        setEvalWeights(weights);
+    }
+    if (!ntuplePath.empty() && !loadNTupleEvaluator(ntuplePath)) {
+        std::cout << "Could not read network " << ntuplePath << "\n";
+        return 1;
+    }
+    if (cachePath.empty()) {
+        configureTranspositionTable(ttMegabytes);
+    } else if (!openEvaluationCache(cachePath, std::max(1, ttMegabytes))) {
+        std::cout << "Could not open search cache " << cachePath << "\n";
+        return 1;
+    }
+
+    ResultStore results;      // Shared with the games and the other AI players
+    bestScore = results.bestScore(gridSize, RESULT_CLASSIC, true);
+
     // Initialize the game grid as a 2D vector filled with zeros
     std::vector<std::vector<int>> grid(gridSize, std::vector<int>(gridSize, 0));
 
-    // Seed the random number generator based on current time
-    std::srand(std::time(0));
+    // The game's own tile generator
+    GameRng rng(seed);
+    if (resume) {
+        rng.restoreState(saved.rngState);
+        unflattenGrid(saved.grid, grid);
+        score = saved.score;
+    }
+
+    // Every move and spawn goes into the record, written to the log at the end
+    GameLogWriter log;
+    if (!recordPath.empty() && !log.open(recordPath)) {
+        std::cout << "Could not open " << recordPath << " for recording\n";
+        return 1;
+    }
+    GameRecord record(seed, gridSize);
+    auto spawnTile = [&]() {
+        int cell = addRandomTile(grid, rng);
+        record.addSpawn(cell, cell < 0 ? 0 : __builtin_ctz(grid[cell / gridSize][cell % gridSize]));
+    };
 
     // Initialize ncurses screen for graphical display
     initscr();              // Start ncurses mode
@@ -27,49 +202,137 @@ int main() {
     initializeColors();     // Initialize game tile colors
 
     // Add two random tiles to start the game
-    initializeGrid(grid);
+    if (!resume) {
+        spawnTile();
+        spawnTile();
+    }
 
-    // Main AI game loop
-    while (true) {
-        clear();                        // Clear screen for next display
-        displayGrid(grid, score, bestScore);  // Display the current game state
+    LatencyHistogram latency;       // Time of every decision
+    FrameMailbox mailbox;           // Newest position for the screen
+    std::atomic<bool> stopRequested(false);
+    long long movesPlayed = resume ? saved.moveCount : 0;
+    const long long firstMove = movesPlayed;
+
+    // The whole game state goes into the checkpoint, written by another thread
+    CheckpointWriter checkpointWriter(checkpointPath);
+    GameCheckpoint checkpoint;
+    checkpoint.seed = seed;
+    checkpoint.search = searchOptions;
+    checkpoint.moveTimeMs = moveTimeMs;
+    auto saveGame = [&]() {
+        checkpoint.grid = flattenGrid(grid);
+        checkpoint.score = score;
+        checkpoint.moveCount = static_cast<int>(movesPlayed);
+        rng.saveState(checkpoint.rngState);
+        checkpointWriter.save(checkpoint);  // A failed save only costs the crash safety
+    };
+    auto lastSave = std::chrono::steady_clock::now();
+    auto startTime = std::chrono::steady_clock::now();
+    bool showTable = (searchOptions.mode == SEARCH_EXPECTIMAX || moveTimeMs > 0) && ttMegabytes > 0;
+
+    // Search thread: plays the whole game and never waits for the screen. Only
+    // this thread touches the grid, the score and the record until it ends.
+    std::thread player([&]() {
+        PlayerFrame frame;
+        while (true) {
+            std::string bestMove = "None";
+            bool over = isGameOver(grid);
+            if (!over && !stopRequested) {
+                // Get the best move from the AI decision-making algorithm
+                bestMove = (moveTimeMs > 0) ? getBestMove(grid, score, searchOptions, moveTimeMs)
+                                            : getBestMove(grid, score, searchOptions);
+                latency.record(lastSearchStats().milliseconds);
+            }
 
-        // Show game info and instructions
-        mvprintw(gridSize * 2 + 3, 0, "Press Q to quit");
-        mvprintw(gridSize * 2 + 4, 0, "Score: %d", score);
-        mvprintw(gridSize * 2 + 5, 0, "Best Score: %d", bestScore);
+            // Perform the AI's suggested move
+            int move = -1;
+            if (bestMove == "Up") move = 0, moveUp(grid, moved, score);
+            else if (bestMove == "Down") move = 1, moveDown(grid, moved, score);
+            else if (bestMove == "Left") move = 2, moveLeft(grid, moved, score);
+            else if (bestMove == "Right") move = 3, moveRight(grid, moved, score);
+            bool finished = (move < 0);
+            if (!finished) ++movesPlayed;
+            if (!finished && moved) {  // Add a random tile if the move was successful
+                record.addMove(move);
+                spawnTile();
+            }
+            if (!finished) {
+                auto now = std::chrono::steady_clock::now();
+                if (now - lastSave >= std::chrono::milliseconds(checkpointEveryMs)) {
+                    saveGame();
+                    lastSave = now;
+                }
+            } else if (over) {
+                checkpointWriter.discard();  // Nothing left to resume
+            } else {
+                saveGame();  // Stopped with Q (or no move found): resume from here
+            }
 
-        timeout(0);         // Non-blocking input check
+            // A frame is built only when the screen took the previous one, and
+            // in turbo mode only every renderEvery moves; the last one always is
+            bool turboSkip = (renderEvery == 0) || (movesPlayed % renderEvery != 0);
+            if (!finished && (turboSkip || mailbox.pending())) continue;
+            frame.grid = grid;
+            frame.score = score;
+            frame.moves = movesPlayed;
+            frame.bestMove = bestMove;
+            frame.statsLine = lastSearchStats().summaryLine() + " | " + latency.summaryLine();
+            frame.tableLine = showTable ? sharedTranspositionTable().statsLine() : "";
+            frame.finished = finished;
+            frame.gameOver = over;
+            mailbox.publish(frame);
+            if (finished) break;
+        }
+    });
+
+    // Screen: shows the newest frame at most maxFps times per second (intermediate
+    // positions are dropped) and checks the keyboard in between
+    GridRenderer renderer;  // Draws the board once, then only the cells that change (paced by getch below)
+    mvprintw(gridSize * 2 + 3, 0, "Press Q to quit (seed %llu)", static_cast<unsigned long long>(seed));
+    timeout(maxFps > 0 ? std::max(1, 1000 / maxFps) : 1);  // getch waits for the next frame
+    PlayerFrame frame;
+    while (true) {
         int ch = getch();   // Get player input
         if (ch == 'q' || ch == 'Q') {  // Check for quit command
-            break;          // Exit the game loop
+            stopRequested = true;  // The search thread ends after its current move
         }
+        if (!mailbox.take(frame)) continue;
 
-        if (isGameOver(grid)) {  // Check if the game is over
-            mvprintw(gridSize * 2 + 6, 0, "Game Over! No more valid moves.");
-            refresh();      // Update the display
-            break;          // Exit the game loop
+        // The final position is always drawn
+        if (renderer.render(frame.grid, frame.score, bestScore, frame.finished)) {
+            mvprintw(gridSize * 2 + 7, 0, "AI's Best Move: %s (move %lld)", frame.bestMove.c_str(), frame.moves);
+            clrtoeol();     // Move names have different lengths
+            mvprintw(gridSize * 2 + 10, 0, "%s", frame.statsLine.c_str());
+            clrtoeol();
+            if (showTable) {
+                mvprintw(gridSize * 2 + 9, 0, "%s", frame.tableLine.c_str());
+                clrtoeol();
+            }
+            refresh();      // Update the screen with AI's decision
         }
-
-        // Get the best move from the AI decision-making algorithm
-        std::string bestMove = getBestMove(grid, score);
-        mvprintw(gridSize * 2 + 7, 0, "AI's Best Move: %s", bestMove.c_str());
-        refresh();          // Update the screen with AI's decision
-
-        // Perform the AI's suggested move
-        if (bestMove == "Up") moveUp(grid, moved, score);
-        else if (bestMove == "Down") moveDown(grid, moved, score);
-        else if (bestMove == "Left") moveLeft(grid, moved, score);
-        else if (bestMove == "Right") moveRight(grid, moved, score);
-        else {  // No valid moves left
-            mvprintw(gridSize * 2 + 8, 0, "No valid moves! Ending game.");
-            refresh();      // Update the display
-            break;          // Exit the game loop
+        if (frame.finished) break;
+    }
+    player.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if (!stopRequested) {
+        if (frame.gameOver) mvprintw(gridSize * 2 + 6, 0, "Game Over! No more valid moves.");
+        else mvprintw(gridSize * 2 + 8, 0, "No valid moves! Ending game.");
+        refresh();          // Update the display
+    }
+    timeout(-1);            // The summary waits for a key
+    if (!stopRequested) {   // A game stopped with Q is resumed rather than recorded
+        StoredResult result;
+        result.gridSize = gridSize;
+        result.ai = true;
+        result.score = score;
+        for (const auto& row : grid) {
+            for (int value : row) result.maxTile = std::max(result.maxTile, value);
         }
-
-        if (moved) addRandomTile(grid); // Add a random tile if the move was successful
-
-        napms(30);          // Delay for smoother animation (300 ms)
+        result.moves = static_cast<int>(movesPlayed);
+        result.timestamp = static_cast<uint64_t>(std::time(0));
+        results.add(result);
+        results.flush();
+        bestScore = std::max(bestScore, score);
     }
 
     // Final Summary Display
@@ -78,7 +341,11 @@ int main() {
     displayGrid(grid, score, bestScore);  // Show the final game state
     mvprintw(gridSize * 2 + 3, 0, "Final Score: %d", score);  // Display final score
     mvprintw(gridSize * 2 + 4, 0, "Best Score Achieved: %d", bestScore);  // Show best score
-    mvprintw(gridSize * 2 + 5, 0, "Press Q to exit...");  // Prompt to quit the game
+    mvprintw(gridSize * 2 + 5, 0, "Decision time: %s over %llu moves", latency.summaryLine().c_str(),
+             static_cast<unsigned long long>(latency.count()));
+    mvprintw(gridSize * 2 + 6, 0, "%.0f moves per second, %lld frames drawn", (movesPlayed - firstMove) / std::max(seconds, 1e-9),
+             renderer.framesDrawn());
+    mvprintw(gridSize * 2 + 7, 0, "Press Q to exit...");  // Prompt to quit the game
 
     // Wait for user confirmation to exit the game
     while (true) {
@@ -87,5 +354,9 @@ int main() {
     }
 
     endwin();  // Close ncurses screen and restore the terminal
+    if (!recordPath.empty()) {
+        log.write(record);
+        log.close();
+    }
     return 0;  // End the program
 }
@@ -0,0 +1,185 @@
+#include "batchmove.hpp"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCHMOVE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Result of sliding every 16-bit row to the left (first half) and to the right
+// (second half): the slid row in the low 16 bits, the merge score / 4 in the
+// high 16 bits (merged tiles are at least 4, and two merges score at most 65536).
+// Built from boardMoveLeft/boardMoveRight on one-row boards on first use, so it
+// does not depend on the order in which the tables of other files are built.
+struct BatchRowTable {
+    uint32_t entries[2 * 65536];
+
+    BatchRowTable() {
+        for (int row = 0; row < 65536; ++row) {
+            int leftScore = 0;
+            int rightScore = 0;
+            Board left = boardMoveLeft(static_cast<Board>(row), leftScore);
+            Board right = boardMoveRight(static_cast<Board>(row), rightScore);
+            entries[row] = static_cast<uint32_t>(left) | (static_cast<uint32_t>(leftScore / 4) << 16);
+            entries[65536 + row] = static_cast<uint32_t>(right) | (static_cast<uint32_t>(rightScore / 4) << 16);
+        }
+    }
+};
+
+const BatchRowTable& batchRowTable() {
+    static const BatchRowTable table;
+    return table;
+}
+
+Board scalarMove(Board board, int move, int& scoreDelta) {
+    switch (move) {
+        case 0: return boardMoveUp(board, scoreDelta);
+        case 1: return boardMoveDown(board, scoreDelta);
+        case 2: return boardMoveLeft(board, scoreDelta);
+        default: return boardMoveRight(board, scoreDelta);
+    }
+}
+
+// moves == nullptr: every board takes uniformMove
+void scalarBatch(Board* boards, const uint8_t* moves, int uniformMove, int start, int count, int* scoreDeltas,
+                 uint8_t* moved) {
+    for (int i = start; i < count; ++i) {
+        int scoreDelta = 0;
+        Board result = scalarMove(boards[i], moves ? moves[i] : uniformMove, scoreDelta);
+        moved[i] = (result != boards[i]) ? 1 : 0;
+        scoreDeltas[i] = scoreDelta;
+        boards[i] = result;
+    }
+}
+
+#ifdef BATCHMOVE_X86
+
+// transposeBoard on each 64-bit lane
+__attribute__((target("avx2")))
+inline __m256i transposeLanes(__m256i board) {
+    __m256i a1 = _mm256_and_si256(board, _mm256_set1_epi64x(static_cast<long long>(0xF0F00F0FF0F00F0FULL)));
+    __m256i a2 = _mm256_and_si256(board, _mm256_set1_epi64x(0x0000F0F00000F0F0LL));
+    __m256i a3 = _mm256_and_si256(board, _mm256_set1_epi64x(0x0F0F00000F0F0000LL));
+    __m256i a = _mm256_or_si256(a1, _mm256_or_si256(_mm256_slli_epi64(a2, 12), _mm256_srli_epi64(a3, 12)));
+    __m256i b1 = _mm256_and_si256(a, _mm256_set1_epi64x(static_cast<long long>(0xFF00FF0000FF00FFULL)));
+    __m256i b2 = _mm256_and_si256(a, _mm256_set1_epi64x(0x00FF00FF00000000LL));
+    __m256i b3 = _mm256_and_si256(a, _mm256_set1_epi64x(0x00000000FF00FF00LL));
+    return _mm256_or_si256(b1, _mm256_or_si256(_mm256_srli_epi64(b2, 24), _mm256_slli_epi64(b3, 24)));
+}
+
+// Slide one row of four boards: gather the table entries of row `shift / 16`
+__attribute__((target("avx2")))
+inline void slideRow(__m256i work, __m256i offset, int shift, const uint32_t* table, __m256i& result,
+                     __m256i& score) {
+    const __m256i rowMask = _mm256_set1_epi64x(0xFFFF);
+    __m128i count = _mm_cvtsi32_si128(shift);
+    __m256i index = _mm256_add_epi64(_mm256_and_si256(_mm256_srl_epi64(work, count), rowMask), offset);
+    __m256i entry = _mm256_cvtepu32_epi64(_mm256_i64gather_epi32(reinterpret_cast<const int*>(table), index, 4));
+    result = _mm256_or_si256(result, _mm256_sll_epi64(_mm256_and_si256(entry, rowMask), count));
+    score = _mm256_add_epi64(score, _mm256_srli_epi64(entry, 16));
+}
+
+// Four boards per step, the remainder with the scalar kernel
+__attribute__((target("avx2")))
+void avx2Batch(Board* boards, const uint8_t* moves, int uniformMove, int count, int* scoreDeltas, uint8_t* moved) {
+    const uint32_t* table = batchRowTable().entries;
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i two = _mm256_set1_epi64x(2);
+    const __m256i lowDwords = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+    __m256i direction = _mm256_set1_epi64x(uniformMove);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i board = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(boards + i));
+        if (moves) {
+            uint32_t packed;
+            std::memcpy(&packed, moves + i, sizeof(packed));
+            direction = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(static_cast<int>(packed)));
+        }
+        // Up and Down (0 and 1) slide the columns: those lanes work on the transposed board.
+        // Down and Right (1 and 3) read the right half of the table.
+        __m256i vertical = _mm256_cmpgt_epi64(two, direction);
+        __m256i offset = _mm256_slli_epi64(_mm256_and_si256(direction, one), 16);
+        __m256i work = _mm256_blendv_epi8(board, transposeLanes(board), vertical);
+
+        __m256i result = _mm256_setzero_si256();
+        __m256i score = _mm256_setzero_si256();
+        slideRow(work, offset, 0, table, result, score);
+        slideRow(work, offset, 16, table, result, score);
+        slideRow(work, offset, 32, table, result, score);
+        slideRow(work, offset, 48, table, result, score);
+        result = _mm256_blendv_epi8(result, transposeLanes(result), vertical);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(boards + i), result);
+        __m256i scores = _mm256_permutevar8x32_epi32(_mm256_slli_epi64(score, 2), lowDwords);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(scoreDeltas + i), _mm256_castsi256_si128(scores));
+        int same = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(result, board)));
+        for (int k = 0; k < 4; ++k) moved[i + k] = static_cast<uint8_t>(((same >> k) & 1) ^ 1);
+    }
+    scalarBatch(boards, moves, uniformMove, i, count, scoreDeltas, moved);
+}
+
+#endif // BATCHMOVE_X86
+
+BatchMoveKernel detectBatchMoveKernel() {
+#ifdef BATCHMOVE_X86
+    __builtin_cpu_init();  // May run before the other constructors
+#endif
+    return batchMoveKernelSupported(BATCH_MOVE_AVX2) ? BATCH_MOVE_AVX2 : BATCH_MOVE_SCALAR;
+}
+
+BatchMoveKernel activeKernel = detectBatchMoveKernel();  // Chosen once at program startup
+
+void runBatch(Board* boards, const uint8_t* moves, int uniformMove, int count, int* scoreDeltas, uint8_t* moved,
+              BatchMoveKernel kernel) {
+#ifdef BATCHMOVE_X86
+    if (kernel == BATCH_MOVE_AVX2 && batchMoveKernelSupported(BATCH_MOVE_AVX2)) {
+        avx2Batch(boards, moves, uniformMove, count, scoreDeltas, moved);
+        return;
+    }
+#endif
+    (void)kernel;
+    scalarBatch(boards, moves, uniformMove, 0, count, scoreDeltas, moved);
+}
+
+} // namespace
+
+bool batchMoveKernelSupported(BatchMoveKernel kernel) {
+    switch (kernel) {
+        case BATCH_MOVE_SCALAR: return true;
+#ifdef BATCHMOVE_X86
+        case BATCH_MOVE_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+const char* batchMoveKernelName(BatchMoveKernel kernel) {
+    return (kernel == BATCH_MOVE_AVX2) ? "avx2" : "scalar";
+}
+
+BatchMoveKernel activeBatchMoveKernel() {
+    return activeKernel;
+}
+
+void setBatchMoveKernel(BatchMoveKernel kernel) {
+    if (batchMoveKernelSupported(kernel)) activeKernel = kernel;
+}
+
+void batchMove(Board* boards, const uint8_t* moves, int count, int* scoreDeltas, uint8_t* moved) {
+    runBatch(boards, moves, 0, count, scoreDeltas, moved, activeKernel);
+}
+
+void batchMove(Board* boards, const uint8_t* moves, int count, int* scoreDeltas, uint8_t* moved,
+               BatchMoveKernel kernel) {
+    runBatch(boards, moves, 0, count, scoreDeltas, moved, kernel);
+}
+
+void batchMoveAll(Board* boards, int move, int count, int* scoreDeltas, uint8_t* moved) {
+    runBatch(boards, nullptr, move, count, scoreDeltas, moved, activeKernel);
+}
+
+void batchMoveAll(Board* boards, int move, int count, int* scoreDeltas, uint8_t* moved, BatchMoveKernel kernel) {
+    runBatch(boards, nullptr, move, count, scoreDeltas, moved, kernel);
+}
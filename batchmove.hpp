@@ -0,0 +1,35 @@
+#ifndef BATCHMOVE_HPP
+#define BATCHMOVE_HPP
+
+#include <cstdint>
+#include "bitboard.hpp"
+
+// Moves applied to many packed 4x4 boards at once. The batch is a structure
+// of arrays: boards[i], moves[i], scoreDeltas[i] and moved[i] describe board i.
+// The AVX2 kernel moves four boards per instruction: one gather per row looks
+// up the slid row and its score for the four boards, and Up/Down boards are
+// transposed in their lanes, so mixed directions need no branch. Every kernel
+// gives exactly the same results as boardMoveLeft and the other scalar moves.
+
+// Kernels, from the slowest to the fastest
+enum BatchMoveKernel {
+    BATCH_MOVE_SCALAR,  // One boardMove* call per board (the reference)
+    BATCH_MOVE_AVX2
+};
+
+bool batchMoveKernelSupported(BatchMoveKernel kernel);
+const char* batchMoveKernelName(BatchMoveKernel kernel);
+BatchMoveKernel activeBatchMoveKernel();  // The best supported kernel, picked at startup
+void setBatchMoveKernel(BatchMoveKernel kernel);  // Ignored when the CPU does not support the kernel
+
+// Apply moves[i] (0 = Up, 1 = Down, 2 = Left, 3 = Right) to boards[i] in place
+// for every i < count. scoreDeltas[i] receives the merged tile values and
+// moved[i] is 1 when the board changed, 0 otherwise.
+void batchMove(Board* boards, const uint8_t* moves, int count, int* scoreDeltas, uint8_t* moved);
+void batchMove(Board* boards, const uint8_t* moves, int count, int* scoreDeltas, uint8_t* moved,
+               BatchMoveKernel kernel);
+// Same move for every board
+void batchMoveAll(Board* boards, int move, int count, int* scoreDeltas, uint8_t* moved);
+void batchMoveAll(Board* boards, int move, int count, int* scoreDeltas, uint8_t* moved, BatchMoveKernel kernel);
+
+#endif // BATCHMOVE_HPP
@@ -0,0 +1,415 @@
+#include "modele.hpp"   // Game logic functions
+#include "ai.hpp"       // AI decision-making
+#include "simdeval.hpp" // Evaluation kernels
+#include "batchmove.hpp" // Batch move kernels
+#include "sizedboard.hpp" // Packed 5x5 and 6x6 boards
+#include "checkpoint.hpp" // Saved games
+#include <algorithm>    // For sorting the timings
+#include <chrono>       // For timing
+#include <cmath>        // For the standard deviation
+#include <cstdio>       // To delete the checkpoint file
+#include <cstdlib>      // For std::atoi and std::atof
+#include <fstream>      // For the baseline file
+#include <functional>   // For the benchmark bodies
+#include <iomanip>      // For formatted output
+#include <iostream>     // For the report
+#include <map>          // For the baseline values
+#include <sstream>      // For the baseline keys
+#include <string>       // For names and options
+#include <vector>       // For the corpus
+
+typedef std::vector<std::vector<int>> Grid;
+
+// Timing of one kernel on one board size
+struct BenchResult {
+    std::string name;
+    int gridSize;
+    double medianNs;  // Median ns/op over the rounds (used for regressions)
+    double meanNs;
+    double stddevNs;
+};
+
+// Settings read from the command line
+struct BenchOptions {
+    int rounds;
+    int corpusSize;
+    std::string baselinePath;
+    bool writeBaseline;
+    double threshold;  // Allowed slowdown against the baseline (0.10 = 10%)
+
+    BenchOptions() : rounds(7), corpusSize(512), baselinePath("data/bench_baseline.txt"),
+                     writeBaseline(false), threshold(0.10) {}
+};
+
+volatile long long benchSink = 0;  // Keeps results alive so the compiler cannot drop the work
+
+// Build a fixed corpus of mid-game boards: each board comes from a game of
+// random moves stopped after a random number of steps. The seed depends only
+// on the size, so every run measures the same boards.
+std::vector<Grid> buildCorpus(int gridSize, int count) {
+    GameRng rng(2048 + gridSize);
+    std::vector<Grid> corpus;
+    while (static_cast<int>(corpus.size()) < count) {
+        Grid grid(gridSize, std::vector<int>(gridSize, 0));
+        addRandomTile(grid, rng);
+        addRandomTile(grid, rng);
+        int steps = static_cast<int>(rng.below(gridSize * gridSize * 8));
+        int score = 0;
+        bool moved = false;
+        for (int step = 0; step < steps && !isGameOver(grid); ++step) {
+            switch (rng.below(4)) {
+                case 0: moveUp(grid, moved, score); break;
+                case 1: moveDown(grid, moved, score); break;
+                case 2: moveLeft(grid, moved, score); break;
+                case 3: moveRight(grid, moved, score); break;
+            }
+            if (moved) addRandomTile(grid, rng);
+        }
+        corpus.push_back(grid);
+    }
+    return corpus;
+}
+
+// Time a kernel: every round runs prepare() (not timed), then body() (timed),
+// which performs opsPerRound operations. Returns ns/op statistics over the rounds.
+BenchResult runBench(const std::string& name, int gridSize, int rounds, int opsPerRound,
+                     const std::function<void()>& prepare, const std::function<void()>& body) {
+    std::vector<double> samples;
+    for (int round = 0; round <= rounds; ++round) {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (round > 0) samples.push_back(ns / opsPerRound);  // Round 0 warms up the caches
+    }
+
+    double mean = 0.0;
+    for (double sample : samples) mean += sample;
+    mean /= samples.size();
+    double variance = 0.0;
+    for (double sample : samples) variance += (sample - mean) * (sample - mean);
+    variance /= samples.size();
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = name;
+    result.gridSize = gridSize;
+    result.medianNs = samples[samples.size() / 2];
+    result.meanNs = mean;
+    result.stddevNs = std::sqrt(variance);
+    return result;
+}
+
+// The four moves on packed N x N boards (sizedboard.hpp), with each kernel the CPU supports
+template <int N>
+void benchSizedMoves(const std::vector<FlatGrid>& flatCorpus, int rounds, std::vector<BenchResult>& results) {
+    std::vector<SizedBoard<N> > boards;
+    for (const FlatGrid& grid : flatCorpus) {
+        if (canPackSizedBoard<N>(grid)) boards.push_back(packSizedBoard<N>(grid));
+    }
+    std::vector<SizedBoard<N> > work;
+    for (int kernel = SIZED_MOVE_SCALAR; kernel <= SIZED_MOVE_AVX2; ++kernel) {
+        if (!sizedMoveKernelSupported(static_cast<SizedMoveKernel>(kernel))) continue;
+        results.push_back(runBench(std::string("sizedMove-") + sizedMoveKernelName(static_cast<SizedMoveKernel>(kernel)),
+            N, rounds, 4 * static_cast<int>(boards.size()), [&]() { work = boards; },
+            [&]() {
+                int score = 0;
+                for (SizedBoard<N>& board : work) {
+                    for (int move : {0, 2, 1, 3}) {
+                        board = sizedBoardMove(board, move, score, static_cast<SizedMoveKernel>(kernel));
+                    }
+                }
+                benchSink += score;
+            }));
+    }
+}
+
+// Run every kernel on one board size
+void benchSize(int gridSize, const BenchOptions& options, std::vector<BenchResult>& results) {
+    const std::vector<Grid> corpus = buildCorpus(gridSize, options.corpusSize);
+    const int count = static_cast<int>(corpus.size());
+    std::vector<Grid> work;
+    std::vector<std::vector<int>> lines;
+    int rounds = options.rounds;
+
+    auto copyCorpus = [&]() { work = corpus; };
+
+    // slideAndMerge on every row of the corpus
+    results.push_back(runBench("slideAndMerge", gridSize, rounds, count * gridSize,
+        [&]() {
+            lines.clear();
+            for (const Grid& grid : corpus) lines.insert(lines.end(), grid.begin(), grid.end());
+        },
+        [&]() {
+            int scoreDelta = 0;
+            for (auto& line : lines) {
+                bool moved = false;
+                slideAndMerge(line, moved, scoreDelta);
+            }
+            benchSink += scoreDelta;
+        }));
+
+    // The four moves
+    const char* moveNames[] = {"moveUp", "moveDown", "moveLeft", "moveRight"};
+    for (int move = 0; move < 4; ++move) {
+        results.push_back(runBench(moveNames[move], gridSize, rounds, count, copyCorpus,
+            [&]() {
+                int score = 0;
+                bool moved = false;
+                for (Grid& grid : work) {
+                    switch (move) {
+                        case 0: moveUp(grid, moved, score); break;
+                        case 1: moveDown(grid, moved, score); break;
+                        case 2: moveLeft(grid, moved, score); break;
+                        case 3: moveRight(grid, moved, score); break;
+                    }
+                }
+                benchSink += score;
+            }));
+    }
+
+    results.push_back(runBench("evaluateGrid", gridSize, rounds, count, []() {},
+        [&]() {
+            long long total = 0;
+            for (const Grid& grid : corpus) total += evaluateGrid(grid);
+            benchSink += total;
+        }));
+
+    // Flat grid evaluation with each kernel the CPU supports
+    std::vector<FlatGrid> flatCorpus;
+    for (const Grid& grid : corpus) flatCorpus.push_back(flattenGrid(grid));
+    const EvalKernel activeKernel = activeEvalKernel();
+    for (int kernel = EVAL_KERNEL_SCALAR; kernel <= EVAL_KERNEL_AVX2; ++kernel) {
+        if (!evalKernelSupported(static_cast<EvalKernel>(kernel))) continue;
+        setEvalKernel(static_cast<EvalKernel>(kernel));
+        results.push_back(runBench(std::string("evaluate-") + evalKernelName(static_cast<EvalKernel>(kernel)),
+            gridSize, rounds, count, []() {},
+            [&]() {
+                long long total = 0;
+                for (const FlatGrid& grid : flatCorpus) total += evaluateGrid(grid);
+                benchSink += total;
+            }));
+    }
+    setEvalKernel(activeKernel);
+
+    // Packed board evaluation with each backend (4x4 only)
+    if (gridSize == 4) {
+        std::vector<Board> boards;
+        for (const Grid& grid : corpus) boards.push_back(packGrid(grid));
+        const EvalBackend activeBackend = evalBackend();
+        const EvalBackend backends[] = {EVAL_BACKEND_SIMD, EVAL_BACKEND_TABLE};
+        const char* backendNames[] = {"evalBoard-simd", "evalBoard-table"};
+        for (int b = 0; b < 2; ++b) {
+            setEvalBackend(backends[b]);
+            results.push_back(runBench(backendNames[b], gridSize, rounds, count, []() {},
+                [&]() {
+                    long long total = 0;
+                    for (Board board : boards) total += evaluateBoard(board);
+                    benchSink += total;
+                }));
+        }
+        setEvalBackend(activeBackend);
+
+        // The four moves on the whole corpus at once, with each batch kernel the CPU supports
+        std::vector<Board> batch;
+        std::vector<int> batchScores(count);
+        std::vector<uint8_t> batchMoved(count);
+        for (int kernel = BATCH_MOVE_SCALAR; kernel <= BATCH_MOVE_AVX2; ++kernel) {
+            if (!batchMoveKernelSupported(static_cast<BatchMoveKernel>(kernel))) continue;
+            results.push_back(runBench(std::string("batchMove-") + batchMoveKernelName(static_cast<BatchMoveKernel>(kernel)),
+                gridSize, rounds, 4 * count, [&]() { batch = boards; },
+                [&]() {
+                    long long total = 0;
+                    for (int move = 0; move < 4; ++move) {
+                        batchMoveAll(batch.data(), move, count, batchScores.data(), batchMoved.data(),
+                                     static_cast<BatchMoveKernel>(kernel));
+                        total += batchScores[0] + batchMoved[0];
+                    }
+                    benchSink += total;
+                }));
+        }
+    }
+
+    // The four moves on flat grids, and on the compile-time sized boards that the search uses for 5x5 and 6x6
+    std::vector<FlatGrid> flatWork;
+    results.push_back(runBench("flatMove", gridSize, rounds, 4 * count, [&]() { flatWork = flatCorpus; },
+        [&]() {
+            int score = 0;
+            bool moved = false;
+            for (FlatGrid& grid : flatWork) {
+                moveUp(grid, moved, score);
+                moveLeft(grid, moved, score);
+                moveDown(grid, moved, score);
+                moveRight(grid, moved, score);
+            }
+            benchSink += score;
+        }));
+    if (gridSize == 5) benchSizedMoves<5>(flatCorpus, rounds, results);
+    if (gridSize == 6) benchSizedMoves<6>(flatCorpus, rounds, results);
+
+    results.push_back(runBench("isGameOver", gridSize, rounds, count, []() {},
+        [&]() {
+            int over = 0;
+            for (const Grid& grid : corpus) over += isGameOver(grid) ? 1 : 0;
+            benchSink += over;
+        }));
+
+    GameRng spawnRng;
+    results.push_back(runBench("addRandomTile", gridSize, rounds, count,
+        [&]() {
+            copyCorpus();
+            spawnRng.reseed(1);
+        },
+        [&]() {
+            for (Grid& grid : work) addRandomTile(grid, spawnRng);
+            benchSink += work[0][0][0];
+        }));
+
+    // checkpoint: the cost a game sees (the writer thread does the file work);
+    // checkpointFile: one write and rename, timed on a slice of the corpus
+    const int checkpointCount = std::min(count, 64);
+    const std::string checkpointPath = "bench_checkpoint.bin";
+    GameCheckpoint checkpoint;
+    {
+        CheckpointWriter writer(checkpointPath);
+        results.push_back(runBench("checkpoint", gridSize, rounds, count, []() {},
+            [&]() {
+                for (int i = 0; i < count; ++i) {
+                    checkpoint.grid = flattenGrid(corpus[i]);
+                    checkpoint.moveCount = i;
+                    spawnRng.saveState(checkpoint.rngState);
+                    writer.save(checkpoint);
+                }
+            }));
+        writer.discard();
+        writer.flush();
+    }
+    results.push_back(runBench("checkpointFile", gridSize, rounds, checkpointCount, []() {},
+        [&]() {
+            for (int i = 0; i < checkpointCount; ++i) {
+                checkpoint.grid = flattenGrid(corpus[i]);
+                benchSink += saveCheckpoint(checkpointPath, checkpoint) ? 1 : 0;
+            }
+        }));
+    std::remove(checkpointPath.c_str());
+
+    // Full searches are slow: time a slice of the corpus
+    const int searchCount = std::min(count, 32);
+    results.push_back(runBench("getBestMove", gridSize, rounds, searchCount, []() {},
+        [&]() {
+            int chosen = 0;
+            for (int i = 0; i < searchCount; ++i) {
+                chosen += static_cast<int>(getBestMove(corpus[i], 0).size());
+            }
+            benchSink += chosen;
+        }));
+}
+
+// Key of a result in the baseline file
+std::string baselineKey(const std::string& name, int gridSize) {
+    std::ostringstream key;
+    key << name << " " << gridSize;
+    return key.str();
+}
+
+// Baseline format: one line per kernel, "name size median_ns mean_ns stddev_ns"
+void writeBaseline(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cout << "Could not write " << path << "\n";
+        return;
+    }
+    file << "# name size median_ns mean_ns stddev_ns\n";
+    for (const BenchResult& result : results) {
+        file << result.name << " " << result.gridSize << " " << result.medianNs << " "
+             << result.meanNs << " " << result.stddevNs << "\n";
+    }
+    std::cout << "Baseline written to " << path << "\n";
+}
+
+std::map<std::string, double> readBaseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name;
+        int gridSize = 0;
+        double medianNs = 0.0;
+        if (fields >> name >> gridSize >> medianNs) {
+            baseline[baselineKey(name, gridSize)] = medianNs;
+        }
+    }
+    return baseline;
+}
+
+// Print usage information
+void printUsage() {
+    std::cout << "Usage: bench [--rounds R] [--corpus N] [--baseline FILE] [--write-baseline]\n"
+              << "             [--threshold PERCENT]\n"
+              << "Times the game kernels on 4x4, 5x5 and 6x6 boards. Fails when a kernel is\n"
+              << "slower than the baseline by more than the threshold (10% by default).\n";
+}
+
+// Main function of the micro-benchmark suite
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--rounds" && hasValue) options.rounds = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--corpus" && hasValue) options.corpusSize = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--baseline" && hasValue) options.baselinePath = argv[++i];
+        else if (arg == "--write-baseline") options.writeBaseline = true;
+        else if (arg == "--threshold" && hasValue) options.threshold = std::atof(argv[++i]) / 100.0;
+        else {
+            printUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    for (int gridSize = 4; gridSize <= 6; ++gridSize) {
+        benchSize(gridSize, options, results);
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.writeBaseline) baseline = readBaseline(options.baselinePath);
+
+    int regressions = 0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(16) << "kernel" << std::right << std::setw(6) << "size"
+              << std::setw(14) << "median ns/op" << std::setw(14) << "mean ns/op"
+              << std::setw(12) << "stddev" << std::setw(12) << "baseline" << "\n";
+    for (const BenchResult& result : results) {
+        std::cout << std::left << std::setw(16) << result.name << std::right
+                  << std::setw(4) << result.gridSize << "x" << result.gridSize
+                  << std::setw(14) << result.medianNs << std::setw(14) << result.meanNs
+                  << std::setw(12) << result.stddevNs;
+
+        auto found = baseline.find(baselineKey(result.name, result.gridSize));
+        if (found != baseline.end()) {
+            double change = result.medianNs / found->second - 1.0;
+            std::cout << std::setw(11) << std::showpos << change * 100.0 << "%" << std::noshowpos;
+            if (change > options.threshold) {
+                std::cout << "  REGRESSION";
+                regressions++;
+            }
+        }
+        std::cout << "\n";
+    }
+
+    if (options.writeBaseline) {
+        writeBaseline(options.baselinePath, results);
+    } else if (baseline.empty()) {
+        std::cout << "No baseline in " << options.baselinePath << " (run with --write-baseline)\n";
+    }
+
+    if (regressions > 0) {
+        std::cout << regressions << " kernel(s) regressed by more than "
+                  << options.threshold * 100.0 << "%\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include "bitboard.hpp"
+
+namespace {
+
+const uint64_t ROW_MASK = 0xFFFFULL;
+
+// Precomputed results for every possible 16-bit row (4 cells of 4 bits).
+// moveLeft/moveRight hold the row after sliding; score holds the merged tile values.
+// The merge score does not depend on the direction: every run of equal tiles
+// merges into the same pairs whichever end it is pushed to.
+struct RowTables {
+    uint16_t moveLeft[65536];
+    uint16_t moveRight[65536];
+    int score[65536];
+
+    RowTables() {
+        for (int row = 0; row < 65536; ++row) {
+            int cells[4];
+            for (int i = 0; i < 4; ++i) {
+                cells[i] = (row >> (4 * i)) & 0xF;
+            }
+
+            // Slide non-zero exponents to the left
+            int line[4] = {0, 0, 0, 0};
+            int count = 0;
+            for (int i = 0; i < 4; ++i) {
+                if (cells[i] != 0) line[count++] = cells[i];
+            }
+
+            // Merge adjacent equal tiles, the same way slideAndMerge does on values
+            int merged[4] = {0, 0, 0, 0};
+            int rowScore = 0;
+            int index = 0;
+            for (int i = 0; i < count; ++i) {
+                if (i + 1 < count && line[i] == line[i + 1] && line[i] < BOARD_MAX_EXPONENT) {
+                    merged[index++] = line[i] + 1;
+                    rowScore += 1 << (line[i] + 1);
+                    ++i; // Skip the next tile to avoid double merge
+                } else {
+                    merged[index++] = line[i];
+                }
+            }
+
+            uint16_t left = 0;
+            uint16_t right = 0;
+            for (int i = 0; i < 4; ++i) {
+                left |= static_cast<uint16_t>(merged[i] << (4 * i));
+                right |= static_cast<uint16_t>(merged[i] << (4 * (3 - i)));
+            }
+
+            // The right move is the left move of the mirrored row, mirrored back
+            int mirrored = ((row & 0xF) << 12) | ((row & 0xF0) << 4) |
+                           ((row & 0xF00) >> 4) | ((row & 0xF000) >> 12);
+            moveLeft[row] = left;
+            moveRight[mirrored] = right;
+            score[row] = rowScore;
+        }
+    }
+};
+
+const RowTables tables; // Built once at program startup
+
+// Apply a row table to the four rows of a board
+inline Board applyRowTable(Board board, const uint16_t* table, int& scoreDelta) {
+    Board result = 0;
+    for (int i = 0; i < 4; ++i) {
+        int row = static_cast<int>((board >> (16 * i)) & ROW_MASK);
+        result |= static_cast<Board>(table[row]) << (16 * i);
+        scoreDelta += tables.score[row];
+    }
+    return result;
+}
+
+// Sets the low bit of every nibble that is zero in x
+inline uint64_t zeroNibbles(uint64_t x) {
+    x |= x >> 2;
+    x |= x >> 1;
+    return ~x & 0x1111111111111111ULL;
+}
+
+} // namespace
+
+// A 4x4 grid can be packed when every tile fits in a 4-bit exponent
+bool canPackGrid(const std::vector<std::vector<int>>& grid) {
+    if (grid.size() != 4) return false;
+    for (const auto& row : grid) {
+        if (row.size() != 4) return false;
+        for (int value : row) {
+            if (value < 0 || value >= (1 << BOARD_MAX_EXPONENT)) return false;
+        }
+    }
+    return true;
+}
+
+Board packGrid(const std::vector<std::vector<int>>& grid) {
+    Board board = 0;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            int value = grid[i][j];
+            int exponent = (value == 0) ? 0 : __builtin_ctz(value); // Tiles are powers of two
+            board |= static_cast<Board>(exponent) << (4 * (4 * i + j));
+        }
+    }
+    return board;
+}
+
+void unpackBoard(Board board, std::vector<std::vector<int>>& grid) {
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            int exponent = getBoardCell(board, i, j);
+            grid[i][j] = (exponent == 0) ? 0 : (1 << exponent);
+        }
+    }
+}
+
+bool canPackGrid(const FlatGrid& grid) {
+    if (grid.size != 4) return false;
+    for (int i = 0; i < 16; ++i) {
+        if (grid.cells[i] >= BOARD_MAX_EXPONENT) return false;
+    }
+    return true;
+}
+
+Board packGrid(const FlatGrid& grid) {
+    Board board = 0;
+    for (int i = 0; i < 16; ++i) {
+        board |= static_cast<Board>(grid.cells[i]) << (4 * i);  // Same row-major order
+    }
+    return board;
+}
+
+void unpackBoard(Board board, FlatGrid& grid) {
+    grid.size = 4;
+    for (int i = 0; i < 16; ++i) {
+        grid.cells[i] = static_cast<uint8_t>((board >> (4 * i)) & 0xF);
+    }
+}
+
+int getBoardCell(Board board, int row, int col) {
+    return static_cast<int>((board >> (4 * (4 * row + col))) & 0xF);
+}
+
+Board setBoardCell(Board board, int row, int col, int exponent) {
+    int shift = 4 * (4 * row + col);
+    board &= ~(static_cast<Board>(0xF) << shift);
+    return board | (static_cast<Board>(exponent & 0xF) << shift);
+}
+
+int countEmptyCells(Board board) {
+    return __builtin_popcountll(zeroNibbles(board));
+}
+
+uint64_t boardEmptyCellMask(Board board) {
+    uint64_t mask = 0;
+    for (uint64_t zeros = zeroNibbles(board); zeros != 0; zeros &= zeros - 1) {
+        mask |= 1ULL << (__builtin_ctzll(zeros) / 4);
+    }
+    return mask;
+}
+
+// Swap rows and columns with three masked shifts per step (2x2 blocks, then 1x1 cells)
+Board transposeBoard(Board board) {
+    Board a1 = board & 0xF0F00F0FF0F00F0FULL;
+    Board a2 = board & 0x0000F0F00000F0F0ULL;
+    Board a3 = board & 0x0F0F00000F0F0000ULL;
+    Board a = a1 | (a2 << 12) | (a3 >> 12);
+    Board b1 = a & 0xFF00FF0000FF00FFULL;
+    Board b2 = a & 0x00FF00FF00000000ULL;
+    Board b3 = a & 0x00000000FF00FF00ULL;
+    return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+Board boardMoveLeft(Board board, int& scoreDelta) {
+    return applyRowTable(board, tables.moveLeft, scoreDelta);
+}
+
+Board boardMoveRight(Board board, int& scoreDelta) {
+    return applyRowTable(board, tables.moveRight, scoreDelta);
+}
+
+// Columns become rows after a transpose, with the top cell in the lowest nibble
+Board boardMoveUp(Board board, int& scoreDelta) {
+    return transposeBoard(applyRowTable(transposeBoard(board), tables.moveLeft, scoreDelta));
+}
+
+Board boardMoveDown(Board board, int& scoreDelta) {
+    return transposeBoard(applyRowTable(transposeBoard(board), tables.moveRight, scoreDelta));
+}
+
+// The game is over when no cell is empty and no two neighbours are equal
+bool boardIsGameOver(Board board) {
+    if (zeroNibbles(board) != 0) return false;
+    // Horizontal neighbours: equal cells give a zero nibble, the last column of each row is ignored
+    if (zeroNibbles(board ^ (board >> 4)) & 0x0111011101110111ULL) return false;
+    // Vertical neighbours: only the first three rows have a cell below them
+    if (zeroNibbles(board ^ (board >> 16)) & 0x0000111111111111ULL) return false;
+    return true;
+}
+
+// Empty cells are the low bits of the zero nibbles, so the n-th empty cell is
+// the n-th set bit divided by 4
+int spawnBoardTile(Board& board, GameRng& rng) {
+    uint64_t empty = zeroNibbles(board);
+    if (empty == 0) return -1;
+    int target = static_cast<int>(rng.below(__builtin_popcountll(empty)));
+    Board exponent = (rng.below(10) < 9) ? 1 : 2;
+    int cell = selectNthSetBit(empty, target) / 4;
+    board |= exponent << (4 * cell);
+    return cell;
+}
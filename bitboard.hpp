@@ -0,0 +1,46 @@
+#ifndef BITBOARD_HPP
+#define BITBOARD_HPP
+
+#include <vector>
+#include <cstdint>
+#include "grid.hpp"
+#include "rng.hpp"
+
+// Packed 4x4 board: every cell holds a 4-bit tile exponent (0 = empty, k = tile 2^k).
+// Row i lives in bits [16*i, 16*i + 15]; column j of a row is nibble j, so the
+// leftmost cell of a row is its lowest nibble.
+typedef uint64_t Board;
+
+// Highest exponent a cell can hold (2^15 = 32768). Two 32768 tiles never merge on a Board.
+const int BOARD_MAX_EXPONENT = 15;
+
+// Conversion between the classic 2D grid and the packed board
+bool canPackGrid(const std::vector<std::vector<int>>& grid); // 4x4 and every tile below 32768
+Board packGrid(const std::vector<std::vector<int>>& grid);
+void unpackBoard(Board board, std::vector<std::vector<int>>& grid);
+bool canPackGrid(const FlatGrid& grid);
+Board packGrid(const FlatGrid& grid);
+void unpackBoard(Board board, FlatGrid& grid);
+
+// Cell access (exponents, not tile values)
+int getBoardCell(Board board, int row, int col);
+Board setBoardCell(Board board, int row, int col, int exponent);
+int countEmptyCells(Board board);
+uint64_t boardEmptyCellMask(Board board);  // Bit k is set when cell k (4 * row + col) is empty
+Board transposeBoard(Board board);
+
+// Moves: return the board after the move and add the merged tile values to scoreDelta.
+// The board is unchanged when the move is not possible.
+Board boardMoveLeft(Board board, int& scoreDelta);
+Board boardMoveRight(Board board, int& scoreDelta);
+Board boardMoveUp(Board board, int& scoreDelta);
+Board boardMoveDown(Board board, int& scoreDelta);
+
+bool boardIsGameOver(Board board);
+
+// Same spawn as addRandomTile (same random draws, same cell and tile): a 2 with
+// p = 0.9, otherwise a 4, on a random empty cell. Returns the cell index
+// (4 * row + column) or -1 when the board is full.
+int spawnBoardTile(Board& board, GameRng& rng);
+
+#endif // BITBOARD_HPP
@@ -0,0 +1,182 @@
+#include "checkpoint.hpp"
+#include "rng.hpp"  // To check the saved generator state
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char CHECKPOINT_MAGIC[8] = {'2', '0', '4', '8', 'C', 'K', 'P', '1'};
+const uint8_t FLAG_TRANSPOSITION_TABLE = 1;
+const uint8_t FLAG_TIMED_MODE = 2;
+
+// The file is the in-memory struct (written on little-endian machines, like the game logs)
+struct CheckpointFile {
+    char magic[8];
+    uint64_t seed;
+    uint64_t rngState[4];
+    double probCutoff;
+    uint32_t score;
+    uint32_t moveCount;
+    int32_t depth;
+    int32_t threads;
+    int32_t rollouts;
+    int32_t moveTimeMs;
+    int32_t timeLimit;
+    int32_t elapsedSeconds;
+    uint8_t gridSize;
+    uint8_t mode;
+    uint8_t flags;
+    uint8_t reserved;
+    uint8_t cells[MAX_GRID_SIZE * MAX_GRID_SIZE];
+    uint64_t checksum;  // FNV-1a of every byte before it
+};
+
+static_assert(sizeof(CheckpointFile) == 136, "CheckpointFile must have no padding");
+
+uint64_t fileChecksum(const CheckpointFile& file) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&file);
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < offsetof(CheckpointFile, checksum); ++i) hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+} // namespace
+
+GameCheckpoint::GameCheckpoint()
+    : grid(makeFlatGrid(4)), score(0), moveCount(0), seed(0), moveTimeMs(0), timedMode(false), timeLimit(0),
+      elapsedSeconds(0) {
+    for (int i = 0; i < 4; ++i) rngState[i] = 0;
+}
+
+bool saveCheckpoint(const std::string& path, const GameCheckpoint& checkpoint) {
+    CheckpointFile file;
+    std::memset(&file, 0, sizeof(file));
+    std::memcpy(file.magic, CHECKPOINT_MAGIC, sizeof(file.magic));
+    file.seed = checkpoint.seed;
+    for (int i = 0; i < 4; ++i) file.rngState[i] = checkpoint.rngState[i];
+    file.probCutoff = checkpoint.search.probCutoff;
+    file.score = static_cast<uint32_t>(checkpoint.score);
+    file.moveCount = static_cast<uint32_t>(checkpoint.moveCount);
+    file.depth = checkpoint.search.depth;
+    file.threads = checkpoint.search.threads;
+    file.rollouts = checkpoint.search.rollouts;
+    file.moveTimeMs = checkpoint.moveTimeMs;
+    file.timeLimit = checkpoint.timeLimit;
+    file.elapsedSeconds = checkpoint.elapsedSeconds;
+    file.gridSize = checkpoint.grid.size;
+    file.mode = static_cast<uint8_t>(checkpoint.search.mode);
+    file.flags = (checkpoint.search.useTranspositionTable ? FLAG_TRANSPOSITION_TABLE : 0) |
+                 (checkpoint.timedMode ? FLAG_TIMED_MODE : 0);
+    std::memcpy(file.cells, checkpoint.grid.cells, sizeof(file.cells));
+    file.checksum = fileChecksum(file);
+
+    // Write a new file and rename it over the old one: a crash at any point
+    // leaves either the previous checkpoint or this one, never a mix
+    std::string tempPath = path + ".tmp";
+    FILE* out = std::fopen(tempPath.c_str(), "wb");
+    if (!out) return false;
+    bool ok = std::fwrite(&file, sizeof(file), 1, out) == 1;
+    ok = (std::fclose(out) == 0) && ok;
+#ifdef _WIN32
+    if (ok) std::remove(path.c_str());  // rename does not replace an existing file there
+#endif
+    ok = ok && std::rename(tempPath.c_str(), path.c_str()) == 0;
+    if (!ok) std::remove(tempPath.c_str());
+    return ok;
+}
+
+bool loadCheckpoint(const std::string& path, GameCheckpoint& checkpoint) {
+    FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) return false;
+    CheckpointFile file;
+    bool ok = std::fread(&file, sizeof(file), 1, in) == 1 && std::fgetc(in) == EOF;
+    std::fclose(in);
+    ok = ok && std::memcmp(file.magic, CHECKPOINT_MAGIC, sizeof(file.magic)) == 0 &&
+         file.checksum == fileChecksum(file) && file.gridSize >= 1 && file.gridSize <= MAX_GRID_SIZE &&
+         file.mode <= SEARCH_ROLLOUT && file.depth >= 1 && file.rollouts >= 1 && file.moveTimeMs >= 0 &&
+         file.score <= INT32_MAX && file.moveCount <= INT32_MAX;
+    for (int i = 0; ok && i < file.gridSize * file.gridSize; ++i) ok = file.cells[i] < 31;  // Tiles fit an int
+    GameRng rng;
+    ok = ok && rng.restoreState(file.rngState);  // Rejects the all-zero state
+    if (!ok) return false;
+
+    GameCheckpoint loaded;
+    loaded.grid = makeFlatGrid(file.gridSize);
+    std::memcpy(loaded.grid.cells, file.cells, file.gridSize * file.gridSize);
+    loaded.score = static_cast<int>(file.score);
+    loaded.moveCount = static_cast<int>(file.moveCount);
+    loaded.seed = file.seed;
+    for (int i = 0; i < 4; ++i) loaded.rngState[i] = file.rngState[i];
+    loaded.search.mode = static_cast<SearchMode>(file.mode);
+    loaded.search.depth = file.depth;
+    loaded.search.probCutoff = file.probCutoff;
+    loaded.search.useTranspositionTable = (file.flags & FLAG_TRANSPOSITION_TABLE) != 0;
+    loaded.search.threads = file.threads;
+    loaded.search.rollouts = file.rollouts;
+    loaded.moveTimeMs = file.moveTimeMs;
+    loaded.timedMode = (file.flags & FLAG_TIMED_MODE) != 0;
+    loaded.timeLimit = file.timeLimit;
+    loaded.elapsedSeconds = file.elapsedSeconds;
+    checkpoint = loaded;
+    return true;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& path)
+    : path(path), job(JOB_NONE), busy(false), lastWriteOk(true), stopping(false) {
+    worker = std::thread(&CheckpointWriter::writerLoop, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_one();
+    worker.join();
+}
+
+void CheckpointWriter::save(const GameCheckpoint& checkpoint) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        waiting = checkpoint;
+        job = JOB_SAVE;
+    }
+    wakeUp.notify_one();
+}
+
+void CheckpointWriter::discard() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = JOB_DISCARD;
+    }
+    wakeUp.notify_one();
+}
+
+bool CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return job == JOB_NONE && !busy; });
+    return lastWriteOk;
+}
+
+void CheckpointWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeUp.wait(lock, [this]() { return stopping || job != JOB_NONE; });
+        if (job == JOB_NONE) return;  // Stopping with nothing left to write
+        Job current = job;
+        GameCheckpoint checkpoint = waiting;
+        job = JOB_NONE;
+        busy = true;
+        lock.unlock();
+
+        bool ok = true;
+        if (current == JOB_SAVE) ok = saveCheckpoint(path, checkpoint);
+        else std::remove(path.c_str());
+
+        lock.lock();
+        busy = false;
+        lastWriteOk = ok;
+        idle.notify_all();
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "ai.hpp"
+#include "grid.hpp"
+
+// Crash-safe snapshots of a game in progress, to continue it after the
+// process was killed. A checkpoint file is one fixed 136-byte record (magic
+// "2048CKP1", the state below and an FNV-1a checksum of the rest), written to
+// "<path>.tmp" and renamed over the previous checkpoint, so the file always
+// holds a whole snapshot. Nothing is synced to disk: a killed process loses
+// nothing the rename published. Replacing a file by rename can still take
+// hundreds of microseconds (ext4 starts writing the new data back), so games
+// hand their checkpoints to a CheckpointWriter thread instead of waiting.
+
+// Everything needed to go on with a game exactly where it stopped
+struct GameCheckpoint {
+    FlatGrid grid;          // Tile exponents
+    int score;
+    int moveCount;
+    uint64_t seed;          // Seed the game started from
+    uint64_t rngState[4];   // Tile generator (GameRng::saveState): the game goes on with the same spawns
+    SearchOptions search;   // AI settings (the thread count is not restored)
+    int moveTimeMs;         // Time limit of an AI move, 0 for a fixed-depth search
+    bool timedMode;         // Interactive game in timed mode
+    int timeLimit;          // Seconds allowed in timed mode
+    int elapsedSeconds;     // Seconds already played in timed mode
+
+    GameCheckpoint();
+};
+
+bool saveCheckpoint(const std::string& path, const GameCheckpoint& checkpoint);
+// Fails (checkpoint unchanged) when the file is missing, truncated, corrupt or
+// holds an impossible state
+bool loadCheckpoint(const std::string& path, GameCheckpoint& checkpoint);
+
+// Saves checkpoints to one file from a background thread. save() only copies
+// the checkpoint (about a microsecond); a checkpoint given while the previous
+// one is being written replaces any other still waiting, so only the newest
+// reaches the file.
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(const std::string& path);
+    ~CheckpointWriter();  // Writes the waiting checkpoint, then stops the thread
+
+    void save(const GameCheckpoint& checkpoint);
+    // Drop the waiting checkpoint and delete the file (the game is over)
+    void discard();
+    // Wait until everything given so far is written (or deleted). Returns
+    // false if the last write failed.
+    bool flush();
+
+private:
+    CheckpointWriter(const CheckpointWriter&);             // Not copyable
+    CheckpointWriter& operator=(const CheckpointWriter&);
+
+    enum Job { JOB_NONE, JOB_SAVE, JOB_DISCARD };
+
+    void writerLoop();
+
+    std::string path;
+    std::mutex mutex;
+    std::condition_variable wakeUp;    // A job is waiting, or stopping
+    std::condition_variable idle;      // The thread finished a job
+    GameCheckpoint waiting;
+    Job job;                           // Job waiting for the thread
+    bool busy;                         // The thread is running a job
+    bool lastWriteOk;
+    bool stopping;
+    std::thread worker;
+};
+
+#endif // CHECKPOINT_HPP
@@ -0,0 +1,50 @@
+#include "evaltable.hpp"
+
+namespace {
+
+int64_t rowScore[65536];     // Weighted terms of a row (a row sum times a large weight overflows an int)
+int64_t columnScore[65536];  // Weighted neighbour terms of a column (a row of the transposed board)
+
+// Built once at program startup with the default weights
+struct DefaultTables {
+    DefaultTables() { buildEvalTables(EvalWeights()); }
+};
+
+const DefaultTables defaultTables;
+
+} // namespace
+
+void buildEvalTables(const EvalWeights& weights) {
+    for (int row = 0; row < 65536; ++row) {
+        int cells[4];
+        int sum = 0;
+        int empty = 0;
+        for (int i = 0; i < 4; ++i) {
+            cells[i] = (row >> (4 * i)) & 0xF;
+            if (cells[i] == 0) empty++;
+            sum += (cells[i] == 0) ? 0 : (1 << cells[i]);
+        }
+
+        // The lowest nibble is the left cell of a row, or the top cell of a transposed column
+        int monotonicity = 0;
+        int mergePotential = 0;
+        for (int i = 0; i < 3; ++i) {
+            if (cells[i] >= cells[i + 1]) monotonicity++;
+            if (cells[i] == cells[i + 1]) mergePotential++;
+        }
+
+        int64_t neighbours = static_cast<int64_t>(monotonicity) * weights.monotonicity +
+                             static_cast<int64_t>(mergePotential) * weights.mergePotential;
+        rowScore[row] = static_cast<int64_t>(sum) * weights.tileSum + static_cast<int64_t>(empty) * weights.empty +
+                        neighbours;
+        columnScore[row] = neighbours;
+    }
+}
+
+int64_t tableEvaluateBoard(Board board) {
+    Board transposed = transposeBoard(board);
+    return rowScore[board & 0xFFFF] + rowScore[(board >> 16) & 0xFFFF] +
+           rowScore[(board >> 32) & 0xFFFF] + rowScore[board >> 48] +
+           columnScore[transposed & 0xFFFF] + columnScore[(transposed >> 16) & 0xFFFF] +
+           columnScore[(transposed >> 32) & 0xFFFF] + columnScore[transposed >> 48];
+}
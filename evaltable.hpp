@@ -0,0 +1,26 @@
+#ifndef EVALTABLE_HPP
+#define EVALTABLE_HPP
+
+#include "bitboard.hpp"
+
+// Weights of the evaluateGrid heuristic terms
+struct EvalWeights {
+    int tileSum;         // Per point of tile value
+    int empty;           // Per empty cell
+    int monotonicity;    // Per neighbour pair ordered left >= right or top >= bottom
+    int mergePotential;  // Per equal neighbour pair
+
+    EvalWeights() : tileSum(1), empty(200), monotonicity(50), mergePotential(100) {}
+};
+
+// Table-driven heuristic for packed 4x4 boards. Every term of the heuristic is
+// a sum over rows and columns, so the weighted score of all 65536 possible rows
+// is precomputed: one table for rows (every term) and one for columns (the
+// neighbour terms only, the cells are already counted by the rows). A board
+// is then scored with four row lookups and four lookups on the transposed board.
+
+// Rebuild both tables with new weights. Not thread-safe: call it before searching.
+void buildEvalTables(const EvalWeights& weights);
+int64_t tableEvaluateBoard(Board board);
+
+#endif // EVALTABLE_HPP
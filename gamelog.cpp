@@ -0,0 +1,344 @@
+#include "gamelog.hpp"
+#include "modele.hpp"  // To replay the moves
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char LOG_MAGIC[8] = {'2', '0', '4', '8', 'L', 'O', 'G', '1'};
+const char RECORD_MAGIC[4] = {'G', 'R', 'E', 'C'};
+const uint8_t NO_SPAWN = 0xFF;
+const uint8_t SPAWN_FOUR = 0x40;  // Bit 6 of a spawn byte: the tile is a 4
+
+static_assert(sizeof(GameRecordHeader) == 32, "GameRecordHeader must have no padding");
+
+// Apply a recorded move to a board
+void applyRecordedMove(FlatGrid& grid, int move, int& score) {
+    bool moved = false;
+    switch (move) {
+        case 0: moveUp(grid, moved, score); break;
+        case 1: moveDown(grid, moved, score); break;
+        case 2: moveLeft(grid, moved, score); break;
+        case 3: moveRight(grid, moved, score); break;
+    }
+}
+
+void applySpawn(FlatGrid& grid, uint8_t spawn) {
+    int cell = spawn & 0x3F;
+    if (spawn == NO_SPAWN || cell >= grid.size * grid.size) return;  // No spawn, or a damaged byte
+    grid.cells[cell] = (spawn & SPAWN_FOUR) ? 2 : 1;
+}
+
+void appendUint32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+uint32_t readUint32(const uint8_t* bytes) {
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+// Sizes of the sections of a record
+size_t movesBytes(uint32_t moveCount) { return (moveCount + 3) / 4; }
+size_t spawnsBytes(uint32_t moveCount) { return moveCount + 2; }
+size_t keyframeBytes(int gridSize) { return gridSize * gridSize + 4; }
+size_t keyframeCount(uint32_t moveCount, int interval) { return moveCount / interval + 1; }
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+// GameRecord
+/////////////////////////////////////////////////////////////////////////////////
+
+GameRecord::GameRecord(uint64_t seed, int gridSize)
+    : seed(seed), current(makeFlatGrid(gridSize)), currentScore(0), moves(0) {}
+
+void GameRecord::addSpawn(int cell, int exponent) {
+    if (cell < 0) {
+        spawns.push_back(NO_SPAWN);
+        return;
+    }
+    spawns.push_back(static_cast<uint8_t>(cell | (exponent == 2 ? SPAWN_FOUR : 0)));
+    current.cells[cell] = static_cast<uint8_t>(exponent);
+}
+
+void GameRecord::addMove(int move) {
+    if (moves % RECORD_KEYFRAME_INTERVAL == 0) addKeyframe();  // The board before this move
+    if (moves % 4 == 0) packedMoves.push_back(0);
+    packedMoves.back() |= static_cast<uint8_t>((move & 3) << (2 * (moves % 4)));
+    applyRecordedMove(current, move, currentScore);
+    moves++;
+}
+
+void GameRecord::addKeyframe() {
+    keyframes.insert(keyframes.end(), current.cells, current.cells + current.size * current.size);
+    appendUint32(keyframes, static_cast<uint32_t>(currentScore));
+}
+
+void GameRecord::serialize(std::vector<uint8_t>& out) const {
+    const int cells = current.size * current.size;
+    const uint32_t moveCount = static_cast<uint32_t>(moves);
+
+    // The last keyframe (before move moveCount) is only known once the game is over
+    size_t storedKeyframes = keyframes.size() / keyframeBytes(current.size);
+    bool finalKeyframe = storedKeyframes < keyframeCount(moveCount, RECORD_KEYFRAME_INTERVAL);
+
+    GameRecordHeader header;
+    std::memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    header.gridSize = current.size;
+    header.reserved = 0;
+    header.keyframeInterval = static_cast<uint16_t>(RECORD_KEYFRAME_INTERVAL);
+    header.moveCount = moveCount;
+    header.finalScore = static_cast<uint32_t>(currentScore);
+    header.seed = seed;
+    header.recordBytes = static_cast<uint32_t>(sizeof(header) + packedMoves.size() + spawns.size() +
+                                               keyframes.size() + (finalKeyframe ? keyframeBytes(current.size) : 0));
+    header.maxTile = 0;
+    for (int i = 0; i < cells; ++i) {
+        header.maxTile = std::max<uint32_t>(header.maxTile, tileValue(current.cells[i]));
+    }
+
+    const uint8_t* headerBytes = reinterpret_cast<const uint8_t*>(&header);
+    out.insert(out.end(), headerBytes, headerBytes + sizeof(header));
+    out.insert(out.end(), packedMoves.begin(), packedMoves.end());
+    out.insert(out.end(), spawns.begin(), spawns.end());
+    out.insert(out.end(), keyframes.begin(), keyframes.end());
+    if (finalKeyframe) {
+        out.insert(out.end(), current.cells, current.cells + cells);
+        appendUint32(out, static_cast<uint32_t>(currentScore));
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// GameLogWriter
+/////////////////////////////////////////////////////////////////////////////////
+
+GameLogWriter::GameLogWriter(size_t bufferBytes)
+    : logFile(nullptr), indexFile(nullptr), fileSize(0), bufferBytes(bufferBytes) {}
+
+GameLogWriter::~GameLogWriter() {
+    close();
+}
+
+bool GameLogWriter::open(const std::string& path) {
+    close();
+
+    // An existing log must start with the magic
+    FILE* existing = std::fopen(path.c_str(), "rb");
+    if (existing) {
+        char magic[sizeof(LOG_MAGIC)];
+        size_t read = std::fread(magic, 1, sizeof(magic), existing);
+        std::fseek(existing, 0, SEEK_END);
+        long size = std::ftell(existing);
+        std::fclose(existing);
+        if (size > 0 && (read != sizeof(magic) || std::memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0)) {
+            return false;
+        }
+    }
+
+    logFile = std::fopen(path.c_str(), "ab");
+    indexFile = std::fopen((path + ".idx").c_str(), "ab");
+    if (!logFile || !indexFile) {
+        close();
+        return false;
+    }
+    std::fseek(logFile, 0, SEEK_END);
+    fileSize = static_cast<uint64_t>(std::ftell(logFile));
+    if (fileSize == 0) {
+        std::fwrite(LOG_MAGIC, 1, sizeof(LOG_MAGIC), logFile);
+        fileSize = sizeof(LOG_MAGIC);
+    }
+    return true;
+}
+
+void GameLogWriter::write(const GameRecord& record) {
+    std::vector<uint8_t> bytes;  // Serialized outside the lock
+    record.serialize(bytes);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!logFile) return;
+    offsets.push_back(fileSize + buffer.size());
+    buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+    if (buffer.size() >= bufferBytes) flushLocked();
+}
+
+void GameLogWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    flushLocked();
+}
+
+// The log is written before the index, so the index never points past the log
+void GameLogWriter::flushLocked() {
+    if (!logFile || buffer.empty()) return;
+    std::fwrite(buffer.data(), 1, buffer.size(), logFile);
+    std::fflush(logFile);
+    for (uint64_t offset : offsets) {
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; ++i) bytes[i] = static_cast<uint8_t>(offset >> (8 * i));
+        std::fwrite(bytes, 1, sizeof(bytes), indexFile);
+    }
+    std::fflush(indexFile);
+    fileSize += buffer.size();
+    buffer.clear();
+    offsets.clear();
+}
+
+void GameLogWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    flushLocked();
+    if (logFile) std::fclose(logFile);
+    if (indexFile) std::fclose(indexFile);
+    logFile = indexFile = nullptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// GameLogReader
+/////////////////////////////////////////////////////////////////////////////////
+
+GameLogReader::GameLogReader() : data(nullptr), size(0), mapped(false) {}
+
+GameLogReader::~GameLogReader() {
+    close();
+}
+
+void GameLogReader::close() {
+    if (data) {
+#ifndef _WIN32
+        if (mapped) munmap(const_cast<uint8_t*>(data), size);
+#endif
+        if (!mapped) delete[] data;
+    }
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    offsets.clear();
+}
+
+bool GameLogReader::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    // No mmap: read the whole log into memory
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    size = static_cast<size_t>(file.tellg());
+    uint8_t* copy = new uint8_t[size];
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(copy), size);
+    data = copy;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+    void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping stays valid
+    if (view == MAP_FAILED) {
+        size = 0;
+        return false;
+    }
+    data = static_cast<const uint8_t*>(view);
+    mapped = true;
+#endif
+    if (size < sizeof(LOG_MAGIC) || std::memcmp(data, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+        close();
+        return false;
+    }
+
+    // Offsets from the index, as long as they point at whole records in order
+    uint64_t next = sizeof(LOG_MAGIC);
+    std::ifstream index((path + ".idx").c_str(), std::ios::binary);
+    uint8_t bytes[8];
+    while (index.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+        uint64_t offset = 0;
+        for (int i = 0; i < 8; ++i) offset |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+        if (offset != next || !validRecord(offset)) break;
+        offsets.push_back(offset);
+        next = offset + readHeader(offset).recordBytes;
+    }
+
+    // Records missing from the index (the index was lost or the writer stopped
+    // between the two files) are found by walking the log; a torn last record is ignored
+    while (validRecord(next)) {
+        offsets.push_back(next);
+        next += readHeader(next).recordBytes;
+    }
+    return true;
+}
+
+// Records are not aligned in the file: headers are copied out, not cast
+GameRecordHeader GameLogReader::readHeader(uint64_t offset) const {
+    GameRecordHeader header;
+    std::memcpy(&header, data + offset, sizeof(header));
+    return header;
+}
+
+bool GameLogReader::validRecord(uint64_t offset) const {
+    if (offset + sizeof(GameRecordHeader) > size) return false;
+    GameRecordHeader header = readHeader(offset);
+    if (std::memcmp(header.magic, RECORD_MAGIC, sizeof(header.magic)) != 0 || header.gridSize < 1 ||
+        header.gridSize > MAX_GRID_SIZE || header.keyframeInterval == 0) {
+        return false;
+    }
+    // boardAt and moveAt trust the layout: the size must be exactly the one of
+    // moveCount moves, so a damaged header never sends them past the record
+    uint64_t expected = sizeof(GameRecordHeader) + movesBytes(header.moveCount) + spawnsBytes(header.moveCount) +
+                        static_cast<uint64_t>(keyframeCount(header.moveCount, header.keyframeInterval)) *
+                            keyframeBytes(header.gridSize);
+    return header.recordBytes == expected && offset + header.recordBytes <= size;
+}
+
+bool GameLogReader::gameInfo(size_t game, GameRecordInfo& info) const {
+    if (game >= offsets.size()) return false;
+    GameRecordHeader header = readHeader(offsets[game]);
+    info.seed = header.seed;
+    info.gridSize = header.gridSize;
+    info.moveCount = static_cast<int>(header.moveCount);
+    info.finalScore = static_cast<int>(header.finalScore);
+    info.maxTile = static_cast<int>(header.maxTile);
+    return true;
+}
+
+int GameLogReader::moveAt(size_t game, int move) const {
+    if (game >= offsets.size()) return -1;
+    GameRecordHeader header = readHeader(offsets[game]);
+    if (move < 0 || move >= static_cast<int>(header.moveCount)) return -1;
+    const uint8_t* moves = data + offsets[game] + sizeof(GameRecordHeader);
+    return (moves[move / 4] >> (2 * (move % 4))) & 3;
+}
+
+bool GameLogReader::boardAt(size_t game, int move, FlatGrid& grid, int& score) const {
+    if (game >= offsets.size()) return false;
+    GameRecordHeader header = readHeader(offsets[game]);
+    if (move < 0 || move > static_cast<int>(header.moveCount)) return false;
+
+    const int interval = header.keyframeInterval;
+    const uint8_t* moves = data + offsets[game] + sizeof(GameRecordHeader);
+    const uint8_t* spawns = moves + movesBytes(header.moveCount);
+    const uint8_t* keyframes = spawns + spawnsBytes(header.moveCount);
+
+    // Start from the keyframe before the move, then replay at most interval - 1 moves
+    int first = (move / interval) * interval;
+    const uint8_t* keyframe = keyframes + (move / interval) * keyframeBytes(header.gridSize);
+    const int cells = header.gridSize * header.gridSize;
+    grid = makeFlatGrid(header.gridSize);
+    std::memcpy(grid.cells, keyframe, cells);
+    score = static_cast<int>(readUint32(keyframe + cells));
+
+    for (int m = first; m < move; ++m) {
+        applyRecordedMove(grid, (moves[m / 4] >> (2 * (m % 4))) & 3, score);
+        applySpawn(grid, spawns[m + 2]);  // The first two spawns are the starting tiles
+    }
+    return true;
+}
@@ -0,0 +1,136 @@
+#ifndef GAMELOG_HPP
+#define GAMELOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "grid.hpp"
+
+// Binary game records.
+//
+// A log file starts with an 8-byte magic ("2048LOG1") followed by one record
+// per game, appended as games finish. A record is:
+//   - a 32-byte header (GameRecordHeader);
+//   - the moves, 2 bits each (0 = Up, 1 = Down, 2 = Left, 3 = Right), four per byte;
+//   - the spawns, one byte each: the two starting tiles, then one after each move.
+//     Bits 0-5 hold the cell (row-major), bit 6 is set for a 4; 0xFF means no spawn;
+//   - keyframes: the board before move 0, K, 2K, ... (and before the last move
+//     count when it is a multiple of K), as size * size tile exponents followed
+//     by the 4-byte score.
+// Next to the log, "<log>.idx" holds the 8-byte file offset of every record, so
+// a reader finds game G in O(1), then move M from the keyframe before it with
+// at most K - 1 moves replayed. Numbers are stored little-endian (the header
+// is the in-memory struct, so logs are written on little-endian machines).
+
+const int RECORD_KEYFRAME_INTERVAL = 64;  // K: moves between two keyframes
+
+struct GameRecordHeader {
+    char magic[4];             // "GREC"
+    uint8_t gridSize;
+    uint8_t reserved;
+    uint16_t keyframeInterval;
+    uint32_t moveCount;
+    uint32_t finalScore;
+    uint64_t seed;
+    uint32_t recordBytes;      // Size of the whole record, header included
+    uint32_t maxTile;
+};
+
+// One game being recorded. Feed it the two starting spawns, then a move and a
+// spawn for every turn: it replays the game itself to build the keyframes.
+class GameRecord {
+public:
+    GameRecord(uint64_t seed, int gridSize);
+
+    void addSpawn(int cell, int exponent);  // cell -1: no tile was spawned
+    void addMove(int move);                 // 0 = Up, 1 = Down, 2 = Left, 3 = Right
+
+    int moveCount() const { return moves; }
+    int score() const { return currentScore; }
+    const FlatGrid& board() const { return current; }
+
+    // The complete record, ready to be appended to a log
+    void serialize(std::vector<uint8_t>& out) const;
+
+private:
+    void addKeyframe();
+
+    uint64_t seed;
+    FlatGrid current;                 // Board after the moves and spawns so far
+    int currentScore;
+    int moves;
+    std::vector<uint8_t> packedMoves;
+    std::vector<uint8_t> spawns;
+    std::vector<uint8_t> keyframes;
+};
+
+// Appends records to a log from any number of threads. Records are collected
+// in memory and written in large batches, and the index file is kept in step.
+class GameLogWriter {
+public:
+    explicit GameLogWriter(size_t bufferBytes = 4 << 20);
+    ~GameLogWriter();
+
+    bool open(const std::string& path);  // Creates the log or appends to an existing one
+    void write(const GameRecord& record);
+    void flush();
+    void close();
+
+private:
+    GameLogWriter(const GameLogWriter&);             // Not copyable
+    GameLogWriter& operator=(const GameLogWriter&);
+
+    void flushLocked();
+
+    std::mutex mutex;
+    FILE* logFile;
+    FILE* indexFile;
+    uint64_t fileSize;              // Offset of the next record
+    size_t bufferBytes;
+    std::vector<uint8_t> buffer;    // Records waiting to be written
+    std::vector<uint64_t> offsets;  // Their offsets, for the index
+};
+
+// Summary of a recorded game
+struct GameRecordInfo {
+    uint64_t seed;
+    int gridSize;
+    int moveCount;
+    int finalScore;
+    int maxTile;
+};
+
+// Read-only view of a log, memory-mapped. Rebuilds the index by scanning the
+// records when the .idx file is missing or behind the log.
+class GameLogReader {
+public:
+    GameLogReader();
+    ~GameLogReader();
+
+    bool open(const std::string& path);
+    void close();
+
+    size_t gameCount() const { return offsets.size(); }
+    bool gameInfo(size_t game, GameRecordInfo& info) const;
+
+    // Board and score before move `move` of a game (move == moveCount gives the final board)
+    bool boardAt(size_t game, int move, FlatGrid& grid, int& score) const;
+    int moveAt(size_t game, int move) const;  // -1 when out of range
+
+private:
+    GameLogReader(const GameLogReader&);             // Not copyable
+    GameLogReader& operator=(const GameLogReader&);
+
+    GameRecordHeader readHeader(uint64_t offset) const;
+    bool validRecord(uint64_t offset) const;  // A whole record starts at offset
+
+    const uint8_t* data;
+    size_t size;
+    bool mapped;                    // data comes from mmap (otherwise from a heap copy)
+    std::vector<uint64_t> offsets;
+};
+
+#endif // GAMELOG_HPP
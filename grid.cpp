@@ -0,0 +1,38 @@
+#include "grid.hpp"
+#include <cstring>
+
+FlatGrid makeFlatGrid(int size) {
+    FlatGrid grid;
+    std::memset(grid.cells, 0, sizeof(grid.cells));
+    grid.size = static_cast<uint8_t>(size);
+    return grid;
+}
+
+bool canFlattenGrid(const std::vector<std::vector<int>>& grid) {
+    if (grid.empty() || grid.size() > static_cast<size_t>(MAX_GRID_SIZE)) return false;
+    for (const auto& row : grid) {
+        if (row.size() != grid.size()) return false;
+    }
+    return true;
+}
+
+FlatGrid flattenGrid(const std::vector<std::vector<int>>& grid) {
+    int size = static_cast<int>(grid.size());
+    FlatGrid flat = makeFlatGrid(size);
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            int value = grid[i][j];
+            flat.cells[i * size + j] = static_cast<uint8_t>((value == 0) ? 0 : __builtin_ctz(value)); // Tiles are powers of two
+        }
+    }
+    return flat;
+}
+
+void unflattenGrid(const FlatGrid& flat, std::vector<std::vector<int>>& grid) {
+    int size = flat.size;
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            grid[i][j] = tileValue(flat.cells[i * size + j]);
+        }
+    }
+}
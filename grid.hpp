@@ -0,0 +1,66 @@
+#ifndef GRID_HPP
+#define GRID_HPP
+
+#include <vector>
+#include <cstdint>
+
+// Largest grid size offered by the menu
+const int MAX_GRID_SIZE = 6;
+
+// Flat NxN grid with no heap storage: the tile exponents (0 = empty, k = tile 2^k)
+// of the rows one after the other, size cells per row.
+struct FlatGrid {
+    uint8_t cells[MAX_GRID_SIZE * MAX_GRID_SIZE];
+    uint8_t size;
+};
+
+// In-place view of one row or column of a FlatGrid: length cells, step apart.
+// A negative step walks the line backwards (right to left, bottom to top).
+struct LineView {
+    uint8_t* first;
+    int step;
+    int length;
+
+    uint8_t& operator[](int i) const { return first[i * step]; }
+};
+
+// Row `row` read left to right (or right to left when reversed)
+inline LineView rowView(FlatGrid& grid, int row, bool reversed) {
+    uint8_t* start = grid.cells + row * grid.size;
+    LineView view = {reversed ? start + grid.size - 1 : start, reversed ? -1 : 1, grid.size};
+    return view;
+}
+
+// Column `col` read top to bottom (or bottom to top when reversed)
+inline LineView columnView(FlatGrid& grid, int col, bool reversed) {
+    uint8_t* start = grid.cells + col;
+    int step = grid.size;
+    LineView view = {reversed ? start + (grid.size - 1) * step : start, reversed ? -step : step, grid.size};
+    return view;
+}
+
+inline int tileValue(uint8_t exponent) { return (exponent == 0) ? 0 : (1 << exponent); }
+
+// Bit i is set when cell i (row-major) is empty
+inline uint64_t emptyCellMask(const FlatGrid& grid) {
+    uint64_t mask = 0;
+    int cells = grid.size * grid.size;
+    for (int i = 0; i < cells; ++i) {
+        if (grid.cells[i] == 0) mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+// Position of the n-th set bit of mask, counting from the lowest (n = 0)
+inline int selectNthSetBit(uint64_t mask, int n) {
+    for (; n > 0; --n) mask &= mask - 1;  // Clear the n lowest set bits
+    return __builtin_ctzll(mask);
+}
+
+// Conversion from and to the classic 2D grid
+FlatGrid makeFlatGrid(int size);  // Empty grid
+bool canFlattenGrid(const std::vector<std::vector<int>>& grid);  // Square and at most MAX_GRID_SIZE
+FlatGrid flattenGrid(const std::vector<std::vector<int>>& grid);
+void unflattenGrid(const FlatGrid& flat, std::vector<std::vector<int>>& grid);
+
+#endif // GRID_HPP
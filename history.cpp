@@ -0,0 +1,76 @@
+#include "history.hpp"
+#include <algorithm>
+
+namespace {
+
+// Exponent of a tile (0 for an empty cell); tiles of an int grid are below 2^31
+inline uint64_t tileExponent(int value) {
+    return value > 0 ? static_cast<uint64_t>(__builtin_ctz(static_cast<unsigned>(value))) : 0;
+}
+
+} // namespace
+
+GameHistory::GameHistory(int capacity)
+    : entries(static_cast<size_t>(std::max(1, capacity))), first(0), count(0), current(0), score(0) {}
+
+void GameHistory::store(Entry& target, const std::vector<std::vector<int>>& grid, int scoreDelta) {
+    target.words[0] = target.words[1] = target.words[2] = 0;
+    int size = static_cast<int>(grid.size());
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
+            int cell = row * size + col;
+            target.words[cell / 12] |= tileExponent(grid[row][col]) << (5 * (cell % 12));
+        }
+    }
+    target.scoreDelta = scoreDelta;
+}
+
+void GameHistory::restore(const Entry& source, std::vector<std::vector<int>>& grid) const {
+    int size = static_cast<int>(grid.size());
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
+            int cell = row * size + col;
+            int exponent = static_cast<int>((source.words[cell / 12] >> (5 * (cell % 12))) & 0x1F);
+            grid[row][col] = exponent ? (1 << exponent) : 0;
+        }
+    }
+}
+
+void GameHistory::reset(const std::vector<std::vector<int>>& grid, int newScore) {
+    first = 0;
+    count = 1;
+    current = 0;
+    score = newScore;
+    store(entries[0], grid, 0);
+}
+
+void GameHistory::push(const std::vector<std::vector<int>>& grid, int newScore) {
+    if (count == 0) {  // Nothing recorded yet
+        reset(grid, newScore);
+        return;
+    }
+    count = current + 1;  // Drop the positions that could be redone
+    if (count == capacity()) {  // Full: drop the oldest position
+        first = (first + 1) % capacity();
+        --count;
+    }
+    store(entry(count), grid, newScore - score);
+    current = count++;
+    score = newScore;
+}
+
+bool GameHistory::undo(std::vector<std::vector<int>>& grid, int& gameScore) {
+    if (current == 0) return false;
+    score -= entry(current).scoreDelta;
+    restore(entry(--current), grid);
+    gameScore = score;
+    return true;
+}
+
+bool GameHistory::redo(std::vector<std::vector<int>>& grid, int& gameScore) {
+    if (current + 1 >= count) return false;
+    score += entry(++current).scoreDelta;
+    restore(entry(current), grid);
+    gameScore = score;
+    return true;
+}
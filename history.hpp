@@ -0,0 +1,51 @@
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Undo/redo history of a game with bounded memory. Every position is stored
+// packed (a 5-bit tile exponent per cell, so 24 bytes for any grid up to 6x6)
+// with the points scored since the previous position, in a ring buffer
+// allocated once: recording a move allocates nothing, and once the buffer is
+// full the oldest positions are dropped.
+class GameHistory {
+public:
+    static const int DEFAULT_CAPACITY = 1024;  // Positions kept, the current one included
+
+    explicit GameHistory(int capacity = DEFAULT_CAPACITY);
+
+    // Forget everything: the grid (at most 6x6) becomes the only position
+    void reset(const std::vector<std::vector<int>>& grid, int score);
+    // Record the position reached by a move. Positions that were undone can
+    // no longer be redone.
+    void push(const std::vector<std::vector<int>>& grid, int score);
+
+    // Go back to the previous position, or forward to the one that was last
+    // undone. The grid keeps its size (no allocation). Return false, leaving
+    // grid and score unchanged, when there is nothing to undo or redo.
+    bool undo(std::vector<std::vector<int>>& grid, int& score);
+    bool redo(std::vector<std::vector<int>>& grid, int& score);
+
+    int undoLevels() const { return current; }
+    int redoLevels() const { return count - 1 - current; }
+    int capacity() const { return static_cast<int>(entries.size()); }
+
+private:
+    struct Entry {
+        uint64_t words[3];   // Cell i in bits 5 * (i % 12) of words[i / 12]
+        int32_t scoreDelta;  // Points scored by the move that reached this position
+    };
+
+    Entry& entry(int index) { return entries[(first + index) % entries.size()]; }
+    void store(Entry& target, const std::vector<std::vector<int>>& grid, int scoreDelta);
+    void restore(const Entry& source, std::vector<std::vector<int>>& grid) const;
+
+    std::vector<Entry> entries;
+    int first;    // Slot of the oldest position
+    int count;    // Positions kept
+    int current;  // Index of the current position, 0 = oldest
+    int score;    // Score of the current position
+};
+
+#endif // HISTORY_HPP
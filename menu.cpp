@@ -1,28 +1,6 @@
 #include "menu.hpp"
 #include <iostream>
 #include <algorithm>
-#include <fstream> // For file handling
-
-// Function to save the best score to a file in a specific folder
-void saveBestScore(int bestScore) {
-    std::ofstream file("data/best_score.txt"); // File path includes "data" folder
-    if (file.is_open()) {
-        file << bestScore;
-        file.close();
-    }
-}
-
-// Function to load the best score from a file in a specific folder
-int loadBestScore() {
-    std::ifstream file("data/best_score.txt"); // File path includes "data" folder
-    int bestScore = 0;
-    if (file.is_open()) {
-        file >> bestScore;
-        file.close();
-    }
-    return bestScore;
-}
-
 
 void showMenu(bool &timedMode, int &timeLimit, int &gridSize) {
     while (true) {
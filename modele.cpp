@@ -1,11 +1,16 @@
 #include "modele.hpp"
+#include "bitboard.hpp"
+#include "grid.hpp"
 #include <cstdlib>
 #include <ctime>
 #include <algorithm>
+#ifndef HEADLESS
 #include <curses.h>
+#endif
 #include <iostream>
 #include <vector>
 
+#ifndef HEADLESS
 // Initialize ncurses color pairs for tiles and borders
 void initializeColors() {
     start_color(); // Enable color functionality in ncurses
@@ -24,6 +29,7 @@ void initializeColors() {
     init_pair(8, COLOR_YELLOW, -1);    // Horizontal border
     init_pair(9, COLOR_YELLOW, -1); // Vertical border
 }
+#endif // HEADLESS
 
 // Map a tile value (e.g., 2, 4, 8, ...) to a color pair index
 int getColorPairIndex(int value) {
@@ -46,6 +52,7 @@ void initializeGrid(std::vector<std::vector<int>>& grid) {
     addRandomTile(grid); // Add the second random tile
 }
 
+#ifndef HEADLESS
 // Display the game grid with tiles and score
 void displayGrid(const std::vector<std::vector<int>>& grid, int score, int bestScore) {
     clear(); // Clear the screen before drawing the grid
@@ -100,32 +107,68 @@ void displayGrid(const std::vector<std::vector<int>>& grid, int score, int bestS
     mvprintw(grid.size() * 2 + 5, 0, "Best Score: %d", bestScore); // Display the best score
     refresh(); // Refresh the screen to show all the changes
 }
+#endif // HEADLESS
 
 
-// Add a random tile (2 or 4) to an empty cell
-void addRandomTile(std::vector<std::vector<int>>& grid) {
-    std::vector<std::pair<int, int>> emptyCells; // List of empty cells
+// Largest grid whose cells fit in the 64 bits of emptyCellMask
+const size_t MAX_MASK_GRID_SIZE = 8;
 
-    // Find all empty cells in the grid
-    for (int i = 0; i < grid.size(); ++i) {
-        for (int j = 0; j < grid.size(); ++j) {
-            if (grid[i][j] == 0) {
-                emptyCells.emplace_back(i, j); // Add empty cell to the list
+// Empty cells of a grid of at most 8x8 as a bit mask (bit i * size + j for cell (i, j))
+static uint64_t emptyCellMask(const std::vector<std::vector<int>>& grid) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < grid.size(); ++i) {
+        for (size_t j = 0; j < grid.size(); ++j) {
+            if (grid[i][j] == 0) mask |= 1ULL << (i * grid.size() + j);
+        }
+    }
+    return mask;
+}
+
+// Place a 2 or 4 in a random empty cell, below(n) drawing a number in [0, n).
+// Returns the cell (i * size + j), or -1 when the grid is full.
+template <typename Below>
+static int placeRandomTile(std::vector<std::vector<int>>& grid, Below below) {
+    size_t size = grid.size();
+    int cell;
+    if (size <= MAX_MASK_GRID_SIZE) {
+        uint64_t empty = emptyCellMask(grid); // Bit i * size + j is set when cell (i, j) is empty
+        if (empty == 0) return -1;
+        cell = selectNthSetBit(empty, static_cast<int>(below(__builtin_popcountll(empty))));
+    } else {
+        // Larger grids do not fit in a mask: list their empty cells instead
+        std::vector<int> empty;
+        for (size_t i = 0; i < size; ++i) {
+            for (size_t j = 0; j < size; ++j) {
+                if (grid[i][j] == 0) empty.push_back(static_cast<int>(i * size + j));
             }
         }
+        if (empty.empty()) return -1;
+        cell = empty[below(static_cast<uint32_t>(empty.size()))];
     }
+    int value = (below(10) < 9) ? 2 : 4; // 90% chance for 2, 10% for 4
+    grid[cell / size][cell % size] = value;
+    return cell;
+}
 
-    // If no empty cells are available, do nothing
-    if (emptyCells.empty()) return;
+// Add a random tile (2 or 4) to an empty cell
+void addRandomTile(std::vector<std::vector<int>>& grid) {
+    placeRandomTile(grid, [](uint32_t bound) { return static_cast<uint32_t>(std::rand()) % bound; });
+}
 
-    // Select a random empty cell and place a 2 or 4
-    int randomIndex = std::rand() % emptyCells.size(); //std::rand() generates a random integer and % emptyCells.size() ensures the index is within the valid range of emptyCells. 
-    int value = (std::rand() % 10 < 9) ? 2 : 4; // 90% chance for 2, 10% for 4
-    grid[emptyCells[randomIndex].first][emptyCells[randomIndex].second] = value; //Accesses the grid cell at the row emptyCells[randomIndex].first and column emptyCells[randomIndex].second. Assigns the value (2 or 4) to that cell.
+// Same as addRandomTile, drawing from the game's own generator instead of std::rand().
+// Games with the same seed get the same tiles, whatever thread plays them.
+int addRandomTile(std::vector<std::vector<int>>& grid, GameRng& rng) {
+    return placeRandomTile(grid, [&rng](uint32_t bound) { return rng.below(bound); });
+}
+
+void initializeGrid(std::vector<std::vector<int>>& grid, GameRng& rng) {
+    addRandomTile(grid, rng);
+    addRandomTile(grid, rng);
 }
 
 // Check if the game is over
 bool isGameOver(const std::vector<std::vector<int>>& grid) {
+    if (canPackGrid(grid)) return boardIsGameOver(packGrid(grid)); // Fast path for 4x4 grids
     for (int i = 0; i < grid.size(); ++i) { // Loop through rows
         for (int j = 0; j < grid.size(); ++j) { // Loop through columns
             if (grid[i][j] == 0) return false; // Empty cell found, not over
@@ -188,8 +231,46 @@ bool slideAndMerge(std::vector<int>& line, bool& moved, int& scoreDelta) {
     return lineChanged; // Возвращаем обновление флага движения
 }
 
-// Movement functions
+// Run a move on the packed 4x4 board and copy the result back into the grid
+static bool moveOnBoard(std::vector<std::vector<int>>& grid, Board (*boardMove)(Board, int&), bool& moved, int& score) {
+    Board before = packGrid(grid);
+    int scoreDelta = 0;
+    Board after = boardMove(before, scoreDelta);
+    moved = (after != before);
+    if (moved) {
+        unpackBoard(after, grid);
+    }
+    score += scoreDelta;
+    return moved;
+}
+
+// Slide a flat grid line by line through in-place row or column views
+static bool moveFlat(FlatGrid& grid, bool columns, bool reversed, bool& moved, int& score) {
+    moved = false;
+    int scoreDelta = 0;
+    for (int k = 0; k < grid.size; ++k) {
+        LineView line = columns ? columnView(grid, k, reversed) : rowView(grid, k, reversed);
+        slideAndMerge(line, moved, scoreDelta);
+    }
+    score += scoreDelta;
+    return moved;
+}
+
+// Run a move on a flat copy of the grid and copy the result back into the grid
+static bool moveThroughFlatGrid(std::vector<std::vector<int>>& grid, bool columns, bool reversed, bool& moved, int& score) {
+    FlatGrid flat = flattenGrid(grid);
+    moveFlat(flat, columns, reversed, moved, score);
+    if (moved) {
+        unflattenGrid(flat, grid);
+    }
+    return moved;
+}
+
+// Movement functions (4x4 grids go through the packed board lookup tables,
+// the other menu sizes through the flat grid)
 bool moveLeft(std::vector<std::vector<int>>& grid, bool& moved, int& score) {
+    if (canPackGrid(grid)) return moveOnBoard(grid, boardMoveLeft, moved, score);
+    if (canFlattenGrid(grid)) return moveThroughFlatGrid(grid, false, false, moved, score);
     moved = false;
     int scoreDelta = 0;
     for (auto& row : grid) {
@@ -204,6 +285,8 @@ bool moveLeft(std::vector<std::vector<int>>& grid, bool& moved, int& score) {
 }
 
 bool moveRight(std::vector<std::vector<int>>& grid, bool& moved, int& score) {
+    if (canPackGrid(grid)) return moveOnBoard(grid, boardMoveRight, moved, score);
+    if (canFlattenGrid(grid)) return moveThroughFlatGrid(grid, false, true, moved, score);
     moved = false;
     int scoreDelta = 0;
     for (auto& row : grid) {
@@ -220,6 +303,8 @@ bool moveRight(std::vector<std::vector<int>>& grid, bool& moved, int& score) {
 }
 
 bool moveUp(std::vector<std::vector<int>>& grid, bool& moved, int& score) {
+    if (canPackGrid(grid)) return moveOnBoard(grid, boardMoveUp, moved, score);
+    if (canFlattenGrid(grid)) return moveThroughFlatGrid(grid, true, false, moved, score);
     moved = false;
     int scoreDelta = 0;
     for (int col = 0; col < grid.size(); ++col) {
@@ -241,6 +326,8 @@ bool moveUp(std::vector<std::vector<int>>& grid, bool& moved, int& score) {
 }
 
 bool moveDown(std::vector<std::vector<int>>& grid, bool& moved, int& score) {
+    if (canPackGrid(grid)) return moveOnBoard(grid, boardMoveDown, moved, score);
+    if (canFlattenGrid(grid)) return moveThroughFlatGrid(grid, true, true, moved, score);
     moved = false;
     int scoreDelta = 0;
     for (int col = 0; col < grid.size(); ++col) {
@@ -259,4 +346,91 @@ bool moveDown(std::vector<std::vector<int>>& grid, bool& moved, int& score) {
     }
     score += scoreDelta; // Update the score after merging
     return moved;
-}
\ No newline at end of file
+}
+
+// Flat grid versions: same rules as the functions above, no heap allocation
+
+// Slide and merge one line of exponents in place. Tiles are written back
+// as they are read, so the line never needs a temporary copy.
+bool slideAndMerge(LineView line, bool& moved, int& scoreDelta) {
+    bool lineChanged = false;
+    int write = 0;            // Next cell to fill
+    bool canMerge = false;    // The last written tile has not merged yet
+    for (int i = 0; i < line.length; ++i) {
+        uint8_t exponent = line[i];
+        if (exponent == 0) continue;
+        if (canMerge && line[write - 1] == exponent) {
+            line[write - 1] = exponent + 1;           // Double the value
+            scoreDelta += 1 << (exponent + 1);        // Update score for the merged value
+            canMerge = false;                         // A merged tile does not merge again
+            lineChanged = true;
+        } else {
+            if (write != i) lineChanged = true;       // The tile slides
+            line[write++] = exponent;
+            canMerge = true;
+        }
+    }
+    for (int i = write; i < line.length; ++i) {       // Fill remaining cells with 0
+        line[i] = 0;
+    }
+    if (lineChanged) moved = true;
+    return lineChanged;
+}
+
+bool moveLeft(FlatGrid& grid, bool& moved, int& score) {
+    return moveFlat(grid, false, false, moved, score);
+}
+
+bool moveRight(FlatGrid& grid, bool& moved, int& score) {
+    return moveFlat(grid, false, true, moved, score);
+}
+
+bool moveUp(FlatGrid& grid, bool& moved, int& score) {
+    return moveFlat(grid, true, false, moved, score);
+}
+
+bool moveDown(FlatGrid& grid, bool& moved, int& score) {
+    return moveFlat(grid, true, true, moved, score);
+}
+
+bool isGameOver(const FlatGrid& grid) {
+    int size = grid.size;
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            uint8_t cell = grid.cells[i * size + j];
+            if (cell == 0) return false;                                                 // Empty cell found
+            if (i < size - 1 && cell == grid.cells[(i + 1) * size + j]) return false;    // Vertical merge possible
+            if (j < size - 1 && cell == grid.cells[i * size + j + 1]) return false;      // Horizontal merge possible
+        }
+    }
+    return true;
+}
+
+// Place a 2 (exponent 1) or a 4 (exponent 2) in the target-th empty cell
+void addRandomTile(FlatGrid& grid) {
+    uint64_t empty = emptyCellMask(grid);
+    if (empty == 0) return;
+    int target = std::rand() % __builtin_popcountll(empty);
+    uint8_t exponent = (std::rand() % 10 < 9) ? 1 : 2; // 90% chance for 2, 10% for 4
+    grid.cells[selectNthSetBit(empty, target)] = exponent;
+}
+
+int addRandomTile(FlatGrid& grid, GameRng& rng) {
+    uint64_t empty = emptyCellMask(grid);
+    if (empty == 0) return -1;
+    int target = static_cast<int>(rng.below(__builtin_popcountll(empty)));
+    uint8_t exponent = (rng.below(10) < 9) ? 1 : 2;
+    int cell = selectNthSetBit(empty, target);
+    grid.cells[cell] = exponent;
+    return cell;
+}
+
+void initializeGrid(FlatGrid& grid, GameRng& rng) {
+    addRandomTile(grid, rng);
+    addRandomTile(grid, rng);
+}
+
+void initializeGrid(FlatGrid& grid) {
+    addRandomTile(grid);
+    addRandomTile(grid);
+}
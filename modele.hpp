@@ -3,11 +3,17 @@
 
 #include <vector>
 #include <string>
+#include "grid.hpp"
+#include "rng.hpp"
 
 // Function prototypes
 void initializeGrid(std::vector<std::vector<int>>& grid);
 void displayGrid(const std::vector<std::vector<int>>& grid, int score, int bestScore);
 void addRandomTile(std::vector<std::vector<int>>& grid);
+void initializeGrid(std::vector<std::vector<int>>& grid, GameRng& rng);
+// Per-game generator: thread-safe and reproducible. Returns the row-major index
+// of the new tile, or -1 when the grid is full.
+int addRandomTile(std::vector<std::vector<int>>& grid, GameRng& rng);
 bool isGameOver(const std::vector<std::vector<int>>& grid);
 bool moveLeft(std::vector<std::vector<int>>& grid, bool& moved, int& score);
 bool moveRight(std::vector<std::vector<int>>& grid, bool& moved, int& score);
@@ -17,9 +23,17 @@ bool slideAndMerge(std::vector<int>& line, bool& moved, int& scoreDelta);
 void initializeColors();
 int getColorPairIndex(int value);
 
-// Function declarations for best score management
-void saveBestScore(int bestScore);  // Save the best score to a file
-int loadBestScore();               // Load the best score from a file
+// Flat grid overloads: same game rules without any heap allocation
+void initializeGrid(FlatGrid& grid);
+void addRandomTile(FlatGrid& grid);
+void initializeGrid(FlatGrid& grid, GameRng& rng);
+int addRandomTile(FlatGrid& grid, GameRng& rng);
+bool isGameOver(const FlatGrid& grid);
+bool moveLeft(FlatGrid& grid, bool& moved, int& score);
+bool moveRight(FlatGrid& grid, bool& moved, int& score);
+bool moveUp(FlatGrid& grid, bool& moved, int& score);
+bool moveDown(FlatGrid& grid, bool& moved, int& score);
+bool slideAndMerge(LineView line, bool& moved, int& scoreDelta); // Works in place on a row or column view
 
 
 #endif
\ No newline at end of file
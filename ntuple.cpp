@@ -0,0 +1,216 @@
+#include "ntuple.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace {
+
+const char NETWORK_MAGIC[8] = {'2', '0', '4', '8', 'N', 'T', 'N', '1'};
+
+// Reverse the cells of every row (left-right mirror)
+Board mirrorBoard(Board board) {
+    return ((board & 0x000F000F000F000FULL) << 12) | ((board & 0x00F000F000F000F0ULL) << 4) |
+           ((board & 0x0F000F000F000F00ULL) >> 4) | ((board & 0xF000F000F000F000ULL) >> 12);
+}
+
+// Reverse the order of the rows (top-bottom mirror)
+Board flipBoard(Board board) {
+    return (board << 48) | ((board & 0xFFFF0000ULL) << 16) | ((board >> 16) & 0xFFFF0000ULL) | (board >> 48);
+}
+
+// Table index of a tuple: one nibble per cell, first cell lowest
+inline size_t tupleIndex(Board board, const int* cells, int length) {
+    size_t index = 0;
+    for (int k = 0; k < length; ++k) {
+        index |= static_cast<size_t>((board >> (4 * cells[k])) & 0xF) << (4 * k);
+    }
+    return index;
+}
+
+std::vector<std::vector<int> > layoutShapes(NTupleLayout layout) {
+    std::vector<std::vector<int> > shapes;
+    if (layout == NTUPLE_LAYOUT_6) {
+        int six[4][6] = {{0, 1, 2, 3, 4, 5}, {4, 5, 6, 7, 8, 9}, {0, 1, 2, 4, 5, 6}, {4, 5, 6, 8, 9, 10}};
+        for (auto& shape : six) shapes.push_back(std::vector<int>(shape, shape + 6));
+    } else {
+        int four[5][4] = {{0, 1, 2, 3}, {4, 5, 6, 7}, {0, 1, 4, 5}, {1, 2, 5, 6}, {5, 6, 9, 10}};
+        for (auto& shape : four) shapes.push_back(std::vector<int>(shape, shape + 4));
+    }
+    return shapes;
+}
+
+} // namespace
+
+void boardSymmetries(Board board, Board symmetries[8]) {
+    symmetries[0] = board;
+    symmetries[1] = mirrorBoard(board);
+    symmetries[2] = flipBoard(board);
+    symmetries[3] = mirrorBoard(symmetries[2]);
+    for (int i = 0; i < 4; ++i) symmetries[4 + i] = transposeBoard(symmetries[i]);
+}
+
+NTupleNetwork::NTupleNetwork() : block(nullptr), totalWeights(0) {}
+
+NTupleNetwork::~NTupleNetwork() {
+    release();
+}
+
+void NTupleNetwork::release() {
+    ::operator delete(block);  // std::atomic<float> needs no destructor call
+    block = nullptr;
+    tuples.clear();
+    totalWeights = 0;
+}
+
+void NTupleNetwork::allocate(const std::vector<std::vector<int> >& shapes) {
+    release();
+    size_t total = 0;
+    for (const auto& shape : shapes) total += static_cast<size_t>(1) << (4 * shape.size());
+
+    // One block, the first table aligned on a cache line (every table size is a multiple of 16 floats)
+    block = ::operator new(total * sizeof(std::atomic<float>) + 64);
+    uintptr_t address = reinterpret_cast<uintptr_t>(block);
+    std::atomic<float>* weights = reinterpret_cast<std::atomic<float>*>((address + 63) & ~static_cast<uintptr_t>(63));
+    for (size_t w = 0; w < total; ++w) new (&weights[w]) std::atomic<float>(0.0f);
+
+    for (const auto& shape : shapes) {
+        Tuple tuple;
+        tuple.length = static_cast<int>(shape.size());
+        for (int k = 0; k < tuple.length; ++k) tuple.cells[k] = shape[k];
+        tuple.weights = weights;
+        weights += static_cast<size_t>(1) << (4 * tuple.length);
+        tuples.push_back(tuple);
+    }
+    totalWeights = total;
+}
+
+void NTupleNetwork::reset(NTupleLayout layout) {
+    allocate(layoutShapes(layout));
+}
+
+float NTupleNetwork::value(Board board) const {
+    Board symmetries[8];
+    boardSymmetries(board, symmetries);
+    float total = 0.0f;
+    for (const Tuple& tuple : tuples) {
+        for (int s = 0; s < 8; ++s) {
+            total += tuple.weights[tupleIndex(symmetries[s], tuple.cells, tuple.length)].load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+void NTupleNetwork::update(Board board, float delta) {
+    if (tuples.empty()) return;
+    Board symmetries[8];
+    boardSymmetries(board, symmetries);
+    float step = delta / (8.0f * tuples.size());
+    for (const Tuple& tuple : tuples) {
+        for (int s = 0; s < 8; ++s) {
+            std::atomic<float>& weight = tuple.weights[tupleIndex(symmetries[s], tuple.cells, tuple.length)];
+            weight.store(weight.load(std::memory_order_relaxed) + step, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool NTupleNetwork::save(const std::string& path) const {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(NETWORK_MAGIC, 1, sizeof(NETWORK_MAGIC), file) == sizeof(NETWORK_MAGIC);
+    uint8_t count = static_cast<uint8_t>(tuples.size());
+    ok = ok && std::fwrite(&count, 1, 1, file) == 1;
+    for (const Tuple& tuple : tuples) {
+        uint8_t shape[1 + NTUPLE_MAX_LENGTH];
+        shape[0] = static_cast<uint8_t>(tuple.length);
+        for (int k = 0; k < tuple.length; ++k) shape[1 + k] = static_cast<uint8_t>(tuple.cells[k]);
+        ok = ok && std::fwrite(shape, 1, 1 + tuple.length, file) == static_cast<size_t>(1 + tuple.length);
+    }
+    // Weights in chunks (the atomics hold plain floats)
+    std::vector<float> chunk;
+    for (const Tuple& tuple : tuples) {
+        size_t size = static_cast<size_t>(1) << (4 * tuple.length);
+        for (size_t start = 0; ok && start < size; start += 65536) {
+            size_t n = std::min<size_t>(65536, size - start);
+            chunk.resize(n);
+            for (size_t i = 0; i < n; ++i) chunk[i] = tuple.weights[start + i].load(std::memory_order_relaxed);
+            ok = std::fwrite(&chunk[0], sizeof(float), n, file) == n;
+        }
+    }
+    return (std::fclose(file) == 0) && ok;
+}
+
+bool NTupleNetwork::load(const std::string& path) {
+    NTupleNetwork loaded;  // Swapped in once the whole file is read
+    if (!loaded.read(path)) return false;
+    swap(loaded);
+    return true;
+}
+
+void NTupleNetwork::swap(NTupleNetwork& other) {
+    tuples.swap(other.tuples);
+    std::swap(block, other.block);
+    std::swap(totalWeights, other.totalWeights);
+}
+
+bool NTupleNetwork::read(const std::string& path) {
+    release();
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    char magic[8];
+    uint8_t count = 0;
+    bool ok = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+              std::memcmp(magic, NETWORK_MAGIC, sizeof(magic)) == 0 && std::fread(&count, 1, 1, file) == 1 &&
+              count > 0;
+    std::vector<std::vector<int> > shapes;
+    for (int t = 0; ok && t < count; ++t) {
+        uint8_t length = 0;
+        uint8_t cells[NTUPLE_MAX_LENGTH];
+        ok = std::fread(&length, 1, 1, file) == 1 && length >= 1 && length <= NTUPLE_MAX_LENGTH &&
+             std::fread(cells, 1, length, file) == length;
+        for (int k = 0; ok && k < length; ++k) ok = cells[k] < 16;
+        if (ok) shapes.push_back(std::vector<int>(cells, cells + length));
+    }
+    if (!ok) {
+        std::fclose(file);
+        return false;
+    }
+
+    allocate(shapes);
+    std::vector<float> chunk;
+    for (const Tuple& tuple : tuples) {
+        size_t size = static_cast<size_t>(1) << (4 * tuple.length);
+        for (size_t start = 0; ok && start < size; start += 65536) {
+            size_t n = std::min<size_t>(65536, size - start);
+            chunk.resize(n);
+            ok = std::fread(&chunk[0], sizeof(float), n, file) == n;
+            for (size_t i = 0; ok && i < n; ++i) tuple.weights[start + i].store(chunk[i], std::memory_order_relaxed);
+        }
+    }
+    ok = ok && std::fgetc(file) == EOF;  // Nothing after the last table
+    std::fclose(file);
+    if (!ok) release();
+    return ok;
+}
+
+uint64_t NTupleNetwork::checksum() const {
+    uint64_t hash = 0xCBF29CE484222325ULL;  // FNV-1a
+    for (const Tuple& tuple : tuples) {
+        hash = (hash ^ static_cast<uint64_t>(tuple.length)) * 0x100000001B3ULL;
+        for (int k = 0; k < tuple.length; ++k) hash = (hash ^ static_cast<uint64_t>(tuple.cells[k])) * 0x100000001B3ULL;
+        size_t size = static_cast<size_t>(1) << (4 * tuple.length);
+        for (size_t i = 0; i < size; ++i) {
+            float weight = tuple.weights[i].load(std::memory_order_relaxed);
+            uint32_t bits;
+            std::memcpy(&bits, &weight, sizeof(bits));
+            hash = (hash ^ bits) * 0x100000001B3ULL;
+        }
+    }
+    return hash;
+}
+
+NTupleNetwork& sharedNTupleNetwork() {
+    static NTupleNetwork network;
+    return network;
+}
@@ -0,0 +1,76 @@
+#ifndef NTUPLE_HPP
+#define NTUPLE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "bitboard.hpp"
+
+// Learned evaluation of packed 4x4 boards (n-tuple network).
+// A tuple is a fixed list of cells; its table holds one weight for every
+// combination of exponents in those cells (16^length entries). The value of a
+// board is the sum, over every tuple and every one of the 8 symmetries of the
+// board (rotations and reflections), of the weight of the exponents found
+// there, so the 8 symmetric copies of a tuple share one table.
+// The network estimates the score still to come from an afterstate (the board
+// just after a move, before the tile spawns); see train.cpp.
+//
+// Tables are one 64-byte aligned block of floats. They are atomics so that
+// training threads can update them without locks (Hogwild): relaxed loads and
+// stores are plain moves, and a lost update only costs a little learning.
+
+const int NTUPLE_MAX_LENGTH = 6;
+
+// Named tuple sets
+enum NTupleLayout {
+    NTUPLE_LAYOUT_4,  // 2 rows and 3 squares of 4 cells: 5 x 64K weights (1.3 MB)
+    NTUPLE_LAYOUT_6   // 4 shapes of 6 cells: 4 x 16M weights (256 MB), stronger but slow to train
+};
+
+class NTupleNetwork {
+public:
+    NTupleNetwork();
+    ~NTupleNetwork();
+
+    void reset(NTupleLayout layout);  // New tuples, every weight 0
+    bool empty() const { return tuples.empty(); }
+    size_t weightCount() const { return totalWeights; }
+
+    float value(Board board) const;
+    void update(Board board, float delta);  // Add delta, spread over every feature
+
+    // Binary file: magic "2048NTN1", the tuples, then the raw little-endian floats.
+    // A failed load leaves the network unchanged.
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+    uint64_t checksum() const;  // Hash of the tuples and weights, identifies a network
+
+private:
+    struct Tuple {
+        int length;
+        int cells[NTUPLE_MAX_LENGTH];  // Row-major cell numbers (4 * row + column)
+        std::atomic<float>* weights;   // 16^length entries
+    };
+
+    NTupleNetwork(const NTupleNetwork&);             // Not copyable
+    NTupleNetwork& operator=(const NTupleNetwork&);
+
+    void allocate(const std::vector<std::vector<int> >& shapes);
+    void release();
+    bool read(const std::string& path);  // Load into this (empty) network; empty again on failure
+    void swap(NTupleNetwork& other);
+
+    std::vector<Tuple> tuples;
+    void* block;          // Allocation holding every table
+    size_t totalWeights;
+};
+
+// The 8 symmetries of a board (the board itself first)
+void boardSymmetries(Board board, Board symmetries[8]);
+
+// Network used by evaluateBoard with EVAL_BACKEND_NTUPLE
+NTupleNetwork& sharedNTupleNetwork();
+
+#endif // NTUPLE_HPP
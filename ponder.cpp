@@ -0,0 +1,111 @@
+#include "ponder.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+HintPonderer::HintPonderer(const SearchOptions& options)
+    : options(options), cancel(false), hasBoard(false), pending(false), done(true), stopping(false), generation(0),
+      bestDepth(0) {
+    worker = std::thread(&HintPonderer::workerLoop, this);
+}
+
+HintPonderer::~HintPonderer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cancel = true;
+    }
+    boardChanged.notify_all();
+    worker.join();
+}
+
+// Replace the board: the result of the previous one is dropped (callers hold the lock)
+void HintPonderer::startSearch(const FlatGrid& grid, bool searchNeeded) {
+    board = grid;
+    hasBoard = true;
+    ++generation;
+    best.clear();
+    bestDepth = 0;
+    pending = searchNeeded;
+    done = !searchNeeded;
+    cancel = true;  // The thread clears it when it starts the next search
+}
+
+void HintPonderer::ponder(const std::vector<std::vector<int>>& grid) {
+    if (!canFlattenGrid(grid)) {
+        // Not a board the searches take: the lookahead answers at once
+        std::string move = getBestMove(grid, 0);
+        std::lock_guard<std::mutex> lock(mutex);
+        startSearch(FlatGrid(), false);
+        hasBoard = false;
+        best = move;
+        bestDepth = 1;
+        resultChanged.notify_all();
+        return;
+    }
+    FlatGrid flat = flattenGrid(grid);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (hasBoard && board.size == flat.size && std::memcmp(board.cells, flat.cells, sizeof(flat.cells)) == 0) {
+            return;  // Same board (e.g. an undo without anything to undo): keep searching
+        }
+        startSearch(flat, true);
+    }
+    boardChanged.notify_one();
+    resultChanged.notify_all();
+}
+
+void HintPonderer::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++generation;
+    hasBoard = false;
+    pending = false;
+    done = true;
+    cancel = true;
+    resultChanged.notify_all();
+}
+
+std::string HintPonderer::bestMove(int waitMs, int& depth) {
+    std::unique_lock<std::mutex> lock(mutex);
+    resultChanged.wait_for(lock, std::chrono::milliseconds(waitMs), [this]() { return bestDepth > 0 || done; });
+    depth = bestDepth;
+    return best.empty() ? "None" : best;
+}
+
+bool HintPonderer::finished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return done;
+}
+
+void HintPonderer::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        boardChanged.wait(lock, [this]() { return stopping || pending; });
+        if (stopping) return;
+        pending = false;
+        cancel = false;  // Under the lock, so a ponder() call after this point cancels this search
+        FlatGrid grid = board;
+        unsigned long long searched = generation;
+        lock.unlock();
+
+        std::string move = ponderBestMove(grid, options, cancel, [this, searched](int depth, const std::string& found) {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (generation != searched) return;  // Finished after the board changed
+            best = found;
+            bestDepth = depth;
+            resultChanged.notify_all();
+        });
+
+        lock.lock();
+        if (generation == searched) {
+            if (bestDepth == 0) best = move;  // No legal move: "None"
+            done = true;
+            resultChanged.notify_all();
+        }
+    }
+}
+
+int hintWaitBudget(int waitMs, bool timedMode, long long remainingMs) {
+    if (!timedMode) return waitMs;
+    return static_cast<int>(std::max(10LL, std::min(static_cast<long long>(waitMs), remainingMs / 10)));
+}
@@ -0,0 +1,61 @@
+#ifndef PONDER_HPP
+#define PONDER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ai.hpp"
+#include "grid.hpp"
+
+// Hint search running in a background thread while the player thinks. Every
+// board given to ponder() is searched by iterative deepening (ponderBestMove)
+// until options.depth is reached or another board replaces it, and the move
+// of the deepest finished iteration is kept, so a hint is ready at once.
+class HintPonderer {
+public:
+    explicit HintPonderer(const SearchOptions& options);
+    ~HintPonderer();  // Cancels the search and waits for the thread
+
+    // Search this board from now on. The search of another board is cancelled
+    // and its result dropped; the same board keeps its running search.
+    void ponder(const std::vector<std::vector<int>>& grid);
+    // Cancel the search (the game is over) until the next ponder()
+    void stop();
+
+    // Best move found so far for the last board ("None" without a legal move),
+    // waiting up to waitMs for the first iteration when none has finished yet.
+    // depth receives the depth of that iteration (0 when there is no result).
+    std::string bestMove(int waitMs, int& depth);
+    bool finished();  // The last board was searched to options.depth
+
+private:
+    HintPonderer(const HintPonderer&);             // Not copyable
+    HintPonderer& operator=(const HintPonderer&);
+
+    void workerLoop();
+    void startSearch(const FlatGrid& grid, bool searchNeeded);
+
+    SearchOptions options;
+    std::mutex mutex;
+    std::condition_variable boardChanged;   // Wakes the thread for a new board or to stop
+    std::condition_variable resultChanged;  // Wakes bestMove() callers
+    std::atomic<bool> cancel;               // Ends the running search
+    FlatGrid board;                         // Last board given to ponder()
+    bool hasBoard;
+    bool pending;                           // The thread has not started on board yet
+    bool done;                              // No more result will come for board
+    bool stopping;
+    unsigned long long generation;          // Incremented for every new board
+    std::string best;
+    int bestDepth;
+    std::thread worker;
+};
+
+// Longest wait of bestMove() for an 'H' hint: waitMs, capped in timed mode to
+// a tenth of the time left in the game (at least 10 ms)
+int hintWaitBudget(int waitMs, bool timedMode, long long remainingMs);
+
+#endif // PONDER_HPP
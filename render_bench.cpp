@@ -0,0 +1,148 @@
+#include "modele.hpp"    // Game logic and displayGrid
+#include "ai.hpp"        // Moves of the recorded game
+#include "renderer.hpp"  // Incremental board drawing
+#include <curses.h>
+#include <sys/stat.h>    // For the size of the output file
+#include <algorithm>     // For std::max
+#include <chrono>        // For timing
+#include <cstdio>        // For the output file
+#include <cstdlib>       // For std::atoi, std::strtoull and std::getenv
+#include <iostream>      // For the report
+#include <string>        // For options
+#include <vector>        // For the recorded frames
+
+typedef std::vector<std::vector<int>> Grid;
+
+// One position of the recorded game
+struct Frame {
+    Grid grid;
+    int score;
+};
+
+// Play a seeded game with the lookahead AI and keep every position
+std::vector<Frame> recordGame(int gridSize, int maxMoves, uint64_t seed) {
+    GameRng rng(seed);
+    Grid grid(gridSize, std::vector<int>(gridSize, 0));
+    addRandomTile(grid, rng);
+    addRandomTile(grid, rng);
+    int score = 0;
+    bool moved = false;
+
+    std::vector<Frame> frames;
+    Frame first = {grid, score};
+    frames.push_back(first);
+    while (static_cast<int>(frames.size()) <= maxMoves && !isGameOver(grid)) {
+        std::string bestMove = getBestMove(grid, score);
+        if (bestMove == "Up") moveUp(grid, moved, score);
+        else if (bestMove == "Down") moveDown(grid, moved, score);
+        else if (bestMove == "Left") moveLeft(grid, moved, score);
+        else if (bestMove == "Right") moveRight(grid, moved, score);
+        else break;
+        if (moved) addRandomTile(grid, rng);
+        Frame frame = {grid, score};
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+// Bytes curses has written to the output file so far
+long long bytesWritten(FILE* out) {
+    fflush(out);
+    struct stat info;
+    if (fstat(fileno(out), &info) != 0) return 0;
+    return static_cast<long long>(info.st_size);
+}
+
+// Measured cost of drawing every frame of the game
+struct RenderCost {
+    double bytesPerMove;
+    double framesPerSecond;
+};
+
+// Draw every frame, with a full redraw (clear() and displayGrid, as the mains
+// used to do) or with the incremental renderer
+RenderCost replay(const std::vector<Frame>& frames, bool incremental, FILE* out) {
+    clear();
+    refresh();
+    long long startBytes = bytesWritten(out);
+    auto start = std::chrono::steady_clock::now();
+
+    GridRenderer renderer;
+    for (const Frame& frame : frames) {
+        if (incremental) {
+            renderer.render(frame.grid, frame.score, 0);
+            refresh();
+        } else {
+            clear();
+            displayGrid(frame.grid, frame.score, 0);  // Refreshes the screen itself
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    RenderCost cost;
+    cost.bytesPerMove = static_cast<double>(bytesWritten(out) - startBytes) / frames.size();
+    cost.framesPerSecond = frames.size() / seconds;
+    return cost;
+}
+
+// Print usage information
+void printUsage() {
+    std::cout << "Usage: render_bench [--size 4|5|6] [--moves N] [--seed S] [--term NAME]\n"
+              << "Replays a seeded AI game on a curses screen that writes to a temporary file,\n"
+              << "and reports the bytes sent per move and the frames per second of a full\n"
+              << "redraw (displayGrid) and of the incremental renderer.\n";
+}
+
+// Main function of the rendering benchmark
+int main(int argc, char* argv[]) {
+    int gridSize = 4;
+    int maxMoves = 500;
+    uint64_t seed = 1;
+    const char* termName = std::getenv("TERM");
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--size" && hasValue) gridSize = std::atoi(argv[++i]);
+        else if (arg == "--moves" && hasValue) maxMoves = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--term" && hasValue) termName = argv[++i];
+        else {
+            printUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+    if (gridSize < 4 || gridSize > 6) {
+        std::cout << "Invalid grid size! Use 4, 5 or 6.\n";
+        return 1;
+    }
+    if (termName == nullptr || termName[0] == '\0') termName = "xterm-256color";
+
+    std::vector<Frame> frames = recordGame(gridSize, maxMoves, seed);
+
+    // The screen writes to a temporary file instead of the terminal
+    FILE* out = std::tmpfile();
+    FILE* in = std::fopen("/dev/null", "r");
+    SCREEN* screen = (out && in) ? newterm(termName, out, in) : nullptr;
+    if (screen == nullptr) {
+        std::cout << "Could not open a curses screen for terminal " << termName << "\n";
+        return 1;
+    }
+    set_term(screen);
+    initializeColors();
+
+    RenderCost full = replay(frames, false, out);
+    RenderCost incremental = replay(frames, true, out);
+
+    endwin();
+    delscreen(screen);
+    std::fclose(out);
+    std::fclose(in);
+
+    std::cout << "Terminal: " << termName << ", " << gridSize << "x" << gridSize << ", "
+              << frames.size() << " moves\n";
+    std::cout << "Full redraw: " << full.bytesPerMove << " bytes/move, "
+              << full.framesPerSecond << " frames/sec\n";
+    std::cout << "Incremental: " << incremental.bytesPerMove << " bytes/move, "
+              << incremental.framesPerSecond << " frames/sec\n";
+    return 0;
+}
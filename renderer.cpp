@@ -0,0 +1,88 @@
+#include "renderer.hpp"
+#include "modele.hpp"  // For getColorPairIndex
+#include <curses.h>
+
+GridRenderer::GridRenderer(int maxFps)
+    : maxFps(maxFps), shownSize(0), shownScore(-1), shownBestScore(-1), frames(0),
+      lastFrame(std::chrono::steady_clock::now()) {}
+
+void GridRenderer::invalidate() {
+    shownSize = 0;
+}
+
+// Static part of the board, the same characters and colors as displayGrid
+void GridRenderer::drawBorders(int size) {
+    attron(COLOR_PAIR(8));  // Horizontal borders
+    for (int i = 0; i <= size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            mvprintw(i * 2, j * 6, "+-----");
+        }
+        mvprintw(i * 2, size * 6, "+");
+    }
+    attroff(COLOR_PAIR(8));
+
+    attron(COLOR_PAIR(9));  // Vertical borders
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j <= size; ++j) {
+            mvprintw(i * 2 + 1, j * 6, "|");
+        }
+    }
+    attroff(COLOR_PAIR(9));
+}
+
+void GridRenderer::drawCell(int row, int col, int value) {
+    if (value == 0) {
+        mvprintw(row * 2 + 1, col * 6 + 1, "     ");  // Blank space for empty cells
+    } else {
+        int colorPair = getColorPairIndex(value);
+        attron(COLOR_PAIR(colorPair));
+        mvprintw(row * 2 + 1, col * 6 + 1, " %4d", value);
+        attroff(COLOR_PAIR(colorPair));
+    }
+
+    // Tiles of five digits run over the right border: put it back, as displayGrid does
+    attron(COLOR_PAIR(9));
+    mvprintw(row * 2 + 1, (col + 1) * 6, "|");
+    attroff(COLOR_PAIR(9));
+}
+
+bool GridRenderer::render(const std::vector<std::vector<int>>& grid, int score, int bestScore, bool force) {
+    auto now = std::chrono::steady_clock::now();
+    if (maxFps > 0 && !force && frames > 0 && now - lastFrame < std::chrono::microseconds(1000000 / maxFps)) {
+        return false;  // Too soon after the previous frame
+    }
+    lastFrame = now;
+    frames++;
+
+    const int size = static_cast<int>(grid.size());
+    bool fullRedraw = (shownSize != size);
+    if (fullRedraw) {
+        drawBorders(size);
+        shownSize = size;
+        shown.assign(size * size, -1);  // No cell matches: every cell is drawn
+        shownScore = shownBestScore = -1;
+    }
+
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            int& cell = shown[i * size + j];
+            if (cell != grid[i][j]) {
+                cell = grid[i][j];
+                drawCell(i, j, cell);
+            }
+        }
+    }
+
+    // Score and best score below the board
+    if (score != shownScore) {
+        mvprintw(size * 2 + 4, 0, "Score: %d", score);
+        clrtoeol();  // The score goes down after an undo
+        shownScore = score;
+    }
+    if (bestScore != shownBestScore) {
+        mvprintw(size * 2 + 5, 0, "Best Score: %d", bestScore);
+        clrtoeol();
+        shownBestScore = bestScore;
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <vector>
+#include <chrono>
+
+// Incremental version of displayGrid with the same screen layout. It keeps the
+// last board it drew: the borders are drawn once, then each frame only rewrites
+// the cells that changed and the score lines. Nothing is cleared, so curses
+// only sends the changed characters to the terminal.
+class GridRenderer {
+public:
+    explicit GridRenderer(int maxFps = 0);  // 0: no frame-rate cap
+
+    // Redraw everything at the next frame (after clear(), or when other text
+    // overwrote the board)
+    void invalidate();
+
+    // Draw the changes since the previous frame. Call refresh() (or getch())
+    // afterwards to send them. With a frame-rate cap, frames that come too soon
+    // after the previous one are skipped (returns false) unless force is set;
+    // the next frame then catches up with every change.
+    bool render(const std::vector<std::vector<int>>& grid, int score, int bestScore, bool force = false);
+
+    long long framesDrawn() const { return frames; }
+
+private:
+    void drawBorders(int size);
+    void drawCell(int row, int col, int value);
+
+    int maxFps;
+    int shownSize;            // Size of the board on screen (0: nothing drawn yet)
+    std::vector<int> shown;   // Tile values on screen, row-major
+    int shownScore;
+    int shownBestScore;
+    long long frames;
+    std::chrono::steady_clock::time_point lastFrame;
+};
+
+#endif // RENDERER_HPP
@@ -0,0 +1,103 @@
+#include "modele.hpp"   // Game logic functions
+#include "ai.hpp"       // Analysis of recorded positions
+#include "gamelog.hpp"  // Binary game records
+#include <cstdlib>      // For std::atoi
+#include <iomanip>      // For formatted output
+#include <iostream>     // For the report
+#include <string>       // For command-line options
+
+static const char* const MOVE_NAMES[4] = {"Up", "Down", "Left", "Right"};
+
+// Print a board as a plain text table of tile values
+void printBoard(const FlatGrid& grid) {
+    for (int i = 0; i < grid.size; ++i) {
+        for (int j = 0; j < grid.size; ++j) {
+            std::cout << std::setw(6) << tileValue(grid.cells[i * grid.size + j]);
+        }
+        std::cout << "\n";
+    }
+}
+
+// Print usage information
+void printUsage() {
+    std::cout << "Usage: replay LOG\n"
+              << "       replay LOG --game G [--move M] [--count N] [--analyze]\n"
+              << "Lists the games of a log written with --record, or shows the board of game G\n"
+              << "before move M and the N moves played from there. --analyze also asks the\n"
+              << "expectimax search which move it would play in that position.\n";
+}
+
+// Main function of the game-log viewer
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    std::string path = argv[1];
+    long long game = -1;   // -1: list the games
+    int move = 0;
+    int count = 10;
+    bool analyze = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--game" && hasValue) game = std::atoll(argv[++i]);
+        else if (arg == "--move" && hasValue) move = std::atoi(argv[++i]);
+        else if (arg == "--count" && hasValue) count = std::atoi(argv[++i]);
+        else if (arg == "--analyze") analyze = true;
+        else {
+            printUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+
+    GameLogReader reader;
+    if (!reader.open(path)) {
+        std::cout << "Could not read game log " << path << "\n";
+        return 1;
+    }
+
+    GameRecordInfo info;
+    if (game < 0) {
+        std::cout << reader.gameCount() << " games\n";
+        std::cout << std::setw(6) << "Game" << std::setw(22) << "Seed" << std::setw(6) << "Size"
+                  << std::setw(8) << "Moves" << std::setw(10) << "Score" << std::setw(10) << "Max tile" << "\n";
+        for (size_t g = 0; g < reader.gameCount(); ++g) {
+            if (!reader.gameInfo(g, info)) continue;
+            std::cout << std::setw(6) << g << std::setw(22) << info.seed << std::setw(6) << info.gridSize
+                      << std::setw(8) << info.moveCount << std::setw(10) << info.finalScore
+                      << std::setw(10) << info.maxTile << "\n";
+        }
+        return 0;
+    }
+
+    if (!reader.gameInfo(static_cast<size_t>(game), info)) {
+        std::cout << "No game " << game << " in " << path << " (" << reader.gameCount() << " games)\n";
+        return 1;
+    }
+    if (move < 0 || move > info.moveCount) {
+        std::cout << "Game " << game << " has " << info.moveCount << " moves\n";
+        return 1;
+    }
+
+    FlatGrid grid;
+    int score = 0;
+    reader.boardAt(static_cast<size_t>(game), move, grid, score);
+    std::cout << "Game " << game << " (seed " << info.seed << "), before move " << move
+              << " of " << info.moveCount << ", score " << score << "\n";
+    printBoard(grid);
+
+    if (analyze) {
+        SearchOptions options;
+        options.mode = SEARCH_EXPECTIMAX;
+        configureTranspositionTable(64);
+        std::cout << "Expectimax move: " << getBestMove(grid, score, options) << "\n";
+    }
+
+    std::cout << "Moves played:";
+    for (int m = move; m < info.moveCount && m < move + count; ++m) {
+        std::cout << " " << MOVE_NAMES[reader.moveAt(static_cast<size_t>(game), m)];
+    }
+    std::cout << "\n";
+    return 0;
+}
@@ -0,0 +1,349 @@
+#include "resultstore.hpp"
+#include "grid.hpp"  // For MAX_GRID_SIZE
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char RESULTS_MAGIC[8] = {'2', '0', '4', '8', 'R', 'E', 'S', '1'};
+const int RESULT_CATEGORIES = MAX_GRID_SIZE * 2 * 2;
+
+static_assert(sizeof(ResultSummary) == 32 + 16 * RESULT_BUCKETS, "ResultSummary must have no padding");
+
+struct ResultsHeader {
+    char magic[8];
+    uint32_t recordBytes;  // Size of a ResultRecord, checked on open
+    uint32_t categories;
+    ResultSummary summaries[RESULT_CATEGORIES];
+};
+
+// One game appended after the header
+struct ResultRecord {
+    uint32_t score;
+    uint32_t moves;
+    uint64_t timestamp;
+    uint8_t gridSize;
+    uint8_t mode;
+    uint8_t ai;
+    uint8_t maxTileExponent;
+    uint32_t checksum;  // FNV-1a of the bytes before it, folded to 32 bits
+};
+
+static_assert(sizeof(ResultRecord) == 24, "ResultRecord must have no padding");
+
+int categoryIndex(int gridSize, int mode, bool ai) {
+    return ((gridSize - 1) * 2 + mode) * 2 + (ai ? 1 : 0);
+}
+
+bool validCategory(int gridSize, int mode) {
+    return gridSize >= 1 && gridSize <= MAX_GRID_SIZE && (mode == RESULT_CLASSIC || mode == RESULT_TIMED);
+}
+
+uint32_t recordChecksum(const ResultRecord& record) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < offsetof(ResultRecord, checksum); ++i) hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+ResultRecord packResult(const StoredResult& result) {
+    ResultRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.score = static_cast<uint32_t>(std::max(0, result.score));
+    record.moves = static_cast<uint32_t>(std::max(0, result.moves));
+    record.timestamp = result.timestamp;
+    record.gridSize = static_cast<uint8_t>(result.gridSize);
+    record.mode = static_cast<uint8_t>(result.mode);
+    record.ai = result.ai ? 1 : 0;
+    record.maxTileExponent = static_cast<uint8_t>(result.maxTile > 0 ? __builtin_ctz(result.maxTile) : 0);
+    record.checksum = recordChecksum(record);
+    return record;
+}
+
+// Fold a record into its summary; damaged records are skipped
+void foldRecord(const ResultRecord& record, ResultSummary summaries[]) {
+    if (record.checksum != recordChecksum(record) || !validCategory(record.gridSize, record.mode) ||
+        record.maxTileExponent >= RESULT_BUCKETS) {
+        return;
+    }
+    StoredResult result;
+    result.gridSize = record.gridSize;
+    result.mode = static_cast<ResultMode>(record.mode);
+    result.ai = record.ai != 0;
+    result.score = static_cast<int>(std::min<uint32_t>(record.score, 0x7FFFFFFF));
+    result.maxTile = record.maxTileExponent ? (1 << record.maxTileExponent) : 0;
+    result.moves = static_cast<int>(std::min<uint32_t>(record.moves, 0x7FFFFFFF));
+    summaries[categoryIndex(result.gridSize, result.mode, result.ai)].add(result);
+}
+
+void emptyHeader(ResultsHeader& header) {
+    std::memcpy(header.magic, RESULTS_MAGIC, sizeof(header.magic));
+    header.recordBytes = sizeof(ResultRecord);
+    header.categories = RESULT_CATEGORIES;
+    for (int c = 0; c < RESULT_CATEGORIES; ++c) header.summaries[c].clear();
+}
+
+bool readAll(int fd, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        long got = ::read(fd, bytes, static_cast<unsigned>(std::min<size_t>(size, 1 << 30)));
+        if (got <= 0) return false;
+        bytes += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        long written = ::write(fd, bytes, static_cast<unsigned>(std::min<size_t>(size, 1 << 30)));
+        if (written <= 0) return false;
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+#ifdef _WIN32
+const int LOCK_SH = 1;
+const int LOCK_EX = 2;
+int flock(int, int) { return 0; }  // No advisory locks: the file is used unlocked
+int ftruncate(int fd, long size) { return _chsize(fd, size); }
+typedef long off_t;
+const int OPEN_FLAGS = O_BINARY;
+#else
+const int OPEN_FLAGS = 0;
+#endif
+
+// Open the store and lock it (LOCK_SH or LOCK_EX). A compaction may replace
+// the file between open and flock: the lock is then on the old file, so it is
+// opened again. With `create`, a missing file is created with an empty header.
+// Returns -1 when the file is missing (without create) or cannot be opened.
+int openLocked(const std::string& path, int lockType, bool create) {
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        int fd = ::open(path.c_str(), (create ? O_RDWR | O_CREAT | O_APPEND : O_RDONLY) | OPEN_FLAGS, 0644);
+        if (fd < 0) return -1;
+        if (flock(fd, lockType) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        struct stat opened, current;
+        if (fstat(fd, &opened) == 0 && stat(path.c_str(), &current) == 0 && opened.st_ino == current.st_ino &&
+            opened.st_dev == current.st_dev) {
+            if (create && opened.st_size == 0) {  // New file: we hold the exclusive lock
+                ResultsHeader header;
+                emptyHeader(header);
+                if (!writeAll(fd, &header, sizeof(header))) {
+                    ::close(fd);
+                    return -1;
+                }
+            }
+            return fd;
+        }
+        ::close(fd);  // Replaced by a compaction
+    }
+    return -1;
+}
+
+// Read the header and every whole record after it. Returns false for a file
+// that is not a results store.
+bool readStore(int fd, ResultsHeader& header, std::vector<ResultRecord>& records) {
+    struct stat info;
+    if (fstat(fd, &info) != 0) return false;
+    if (info.st_size == 0) {  // Created by a process that has not written the header yet
+        emptyHeader(header);
+        records.clear();
+        return true;
+    }
+    if (static_cast<size_t>(info.st_size) < sizeof(header) || ::lseek(fd, 0, SEEK_SET) != 0 ||
+        !readAll(fd, &header, sizeof(header)) || std::memcmp(header.magic, RESULTS_MAGIC, sizeof(header.magic)) != 0 ||
+        header.recordBytes != sizeof(ResultRecord) || header.categories != RESULT_CATEGORIES) {
+        return false;
+    }
+    // A record cut short by a crash is ignored (and dropped by the next append)
+    records.resize((static_cast<size_t>(info.st_size) - sizeof(header)) / sizeof(ResultRecord));
+    return records.empty() || readAll(fd, &records[0], records.size() * sizeof(ResultRecord));
+}
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+// ResultSummary
+/////////////////////////////////////////////////////////////////////////////////
+
+void ResultSummary::clear() {
+    games = scoreSum = moveSum = 0;
+    bestScore = bestTile = 0;
+    for (int b = 0; b < RESULT_BUCKETS; ++b) scoreBuckets[b] = tileCounts[b] = 0;
+}
+
+void ResultSummary::add(const StoredResult& result) {
+    uint32_t score = static_cast<uint32_t>(std::max(0, result.score));
+    games++;
+    scoreSum += score;
+    moveSum += static_cast<uint64_t>(std::max(0, result.moves));
+    bestScore = std::max(bestScore, score);
+    bestTile = std::max(bestTile, static_cast<uint32_t>(std::max(0, result.maxTile)));
+    scoreBuckets[score ? 32 - __builtin_clz(score) : 0]++;  // Scores stay below 2^31
+    tileCounts[result.maxTile > 0 ? __builtin_ctz(result.maxTile) : 0]++;
+}
+
+void ResultSummary::merge(const ResultSummary& other) {
+    games += other.games;
+    scoreSum += other.scoreSum;
+    moveSum += other.moveSum;
+    bestScore = std::max(bestScore, other.bestScore);
+    bestTile = std::max(bestTile, other.bestTile);
+    for (int b = 0; b < RESULT_BUCKETS; ++b) {
+        scoreBuckets[b] += other.scoreBuckets[b];
+        tileCounts[b] += other.tileCounts[b];
+    }
+}
+
+double ResultSummary::meanScore() const {
+    return games ? static_cast<double>(scoreSum) / games : 0.0;
+}
+
+double ResultSummary::reachedTile(int tile) const {
+    if (games == 0) return 0.0;
+    uint64_t reached = 0;
+    for (int k = 0; k < RESULT_BUCKETS; ++k) {
+        if ((1LL << k) >= tile) reached += tileCounts[k];
+    }
+    return static_cast<double>(reached) / games;
+}
+
+uint32_t ResultSummary::scorePercentile(double fraction) const {
+    if (games == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(fraction * (games - 1)) + 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < RESULT_BUCKETS; ++b) {
+        seen += scoreBuckets[b];
+        if (seen >= target) return b ? std::min<uint32_t>(bestScore, (1u << b) - 1) : 0;
+    }
+    return bestScore;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// ResultStore
+/////////////////////////////////////////////////////////////////////////////////
+
+ResultStore::ResultStore(const std::string& path, int batchSize, int compactAfter)
+    : path(path), batchSize(std::max(1, batchSize)), compactAfter(std::max(1, compactAfter)) {}
+
+ResultStore::~ResultStore() {
+    flush();
+}
+
+void ResultStore::add(const StoredResult& result) {
+    if (!validCategory(result.gridSize, result.mode)) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(result);
+    if (static_cast<int>(pending.size()) >= batchSize) flushLocked(false);
+}
+
+bool ResultStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return flushLocked(false);
+}
+
+bool ResultStore::compact() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return flushLocked(true);
+}
+
+// Append the waiting results in one write, then compact when the records
+// after the header are too many (callers hold the mutex)
+bool ResultStore::flushLocked(bool forceCompaction) {
+    if (pending.empty() && !forceCompaction) return true;
+    int fd = openLocked(path, LOCK_EX, true);
+    if (fd < 0) return false;
+
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(ResultsHeader);
+    size_t records = ok ? (static_cast<size_t>(info.st_size) - sizeof(ResultsHeader)) / sizeof(ResultRecord) : 0;
+    if (ok && sizeof(ResultsHeader) + records * sizeof(ResultRecord) != static_cast<size_t>(info.st_size)) {
+        // Drop a record cut short by a crash, so the next ones stay aligned
+        ok = ftruncate(fd, static_cast<off_t>(sizeof(ResultsHeader) + records * sizeof(ResultRecord))) == 0;
+    }
+    if (ok && !pending.empty()) {
+        std::vector<ResultRecord> batch;
+        batch.reserve(pending.size());
+        for (const StoredResult& result : pending) batch.push_back(packResult(result));
+        ok = writeAll(fd, &batch[0], batch.size() * sizeof(ResultRecord));  // O_APPEND: one write per batch
+        if (ok) {
+            records += batch.size();
+            pending.clear();
+        }
+    }
+
+    if (ok && (forceCompaction || records >= static_cast<size_t>(compactAfter))) {
+        ResultsHeader header;
+        std::vector<ResultRecord> appended;
+        ok = readStore(fd, header, appended);
+        for (size_t r = 0; ok && r < appended.size(); ++r) foldRecord(appended[r], header.summaries);
+        std::string tempPath = path + ".tmp";
+        FILE* out = ok ? std::fopen(tempPath.c_str(), "wb") : nullptr;
+        if (out) {
+            ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+            ok = (std::fclose(out) == 0) && ok;
+#ifdef _WIN32
+            if (ok) std::remove(path.c_str());
+#endif
+            // Still holding the lock on the old file: other processes see the new one once we close it
+            ok = ok && std::rename(tempPath.c_str(), path.c_str()) == 0;
+            if (!ok) std::remove(tempPath.c_str());
+        } else {
+            ok = false;
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+bool ResultStore::summary(int gridSize, ResultMode mode, bool ai, ResultSummary& out) {
+    out.clear();
+    if (!validCategory(gridSize, mode)) return true;
+    int category = categoryIndex(gridSize, mode, ai);
+    bool ok = true;
+    int fd = openLocked(path, LOCK_SH, false);
+    if (fd >= 0) {
+        ResultsHeader header;
+        std::vector<ResultRecord> records;
+        ok = readStore(fd, header, records);
+        ::close(fd);
+        if (ok) {
+            std::vector<ResultSummary> summaries(RESULT_CATEGORIES);
+            for (const ResultRecord& record : records) foldRecord(record, &summaries[0]);
+            out.merge(header.summaries[category]);
+            out.merge(summaries[category]);
+        }
+    } else {
+        struct stat info;
+        ok = stat(path.c_str(), &info) != 0;  // A missing file holds no results
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const StoredResult& result : pending) {
+        if (categoryIndex(result.gridSize, result.mode, result.ai) == category) out.add(result);
+    }
+    return ok;
+}
+
+int ResultStore::bestScore(int gridSize, ResultMode mode, bool ai) {
+    ResultSummary totals;
+    summary(gridSize, mode, ai, totals);
+    return static_cast<int>(totals.bestScore);
+}
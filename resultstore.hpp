@@ -0,0 +1,100 @@
+#ifndef RESULTSTORE_HPP
+#define RESULTSTORE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Results of finished games, shared by every process that plays.
+//
+// The file starts with a fixed header: the magic "2048RES1", then one
+// ResultSummary per category (grid size x classic/timed x human/AI) covering
+// every game folded in by the last compaction. Games finished since then follow
+// as 24-byte records. Processes append their records in batches with one
+// write under an exclusive advisory lock (flock), and queries read the header
+// and the records after it under a shared lock, so they never read the whole
+// history. Once more than `compactAfter` records follow the header, the
+// process that appended the last batch folds them into the summaries and
+// renames a new file over the old one; a process that then gets the lock on
+// the old file sees it was replaced and opens the new one. Numbers are stored
+// little-endian (the header is the in-memory struct, like the game logs).
+// Without flock (Windows) the file is used without locking.
+
+const char* const DEFAULT_RESULTS_FILE = "data/results.bin";
+const int RESULT_BUCKETS = 32;  // Score buckets and tile exponents of a summary
+
+enum ResultMode {
+    RESULT_CLASSIC,
+    RESULT_TIMED
+};
+
+// One finished game
+struct StoredResult {
+    int gridSize;     // 1 to MAX_GRID_SIZE
+    ResultMode mode;
+    bool ai;          // Played by ai_player or simulate rather than a person
+    int score;
+    int maxTile;      // Value of the largest tile (0 for an empty board)
+    int moves;
+    uint64_t timestamp;  // Seconds since the epoch (std::time)
+
+    StoredResult() : gridSize(4), mode(RESULT_CLASSIC), ai(false), score(0), maxTile(0), moves(0), timestamp(0) {}
+};
+
+// Totals of the games of one category
+struct ResultSummary {
+    uint64_t games;
+    uint64_t scoreSum;
+    uint64_t moveSum;
+    uint32_t bestScore;
+    uint32_t bestTile;
+    uint64_t scoreBuckets[RESULT_BUCKETS];  // Bucket 0: score 0; bucket b: scores in [2^(b-1), 2^b)
+    uint64_t tileCounts[RESULT_BUCKETS];    // tileCounts[k]: games whose largest tile was 2^k
+
+    ResultSummary() { clear(); }
+    void clear();
+    void add(const StoredResult& result);
+    void merge(const ResultSummary& other);
+
+    double meanScore() const;
+    double reachedTile(int tile) const;  // Fraction of the games with a tile of at least `tile`
+    // Upper bound of the score bucket holding the given fraction of the games
+    // (0.5: median), within a factor of two
+    uint32_t scorePercentile(double fraction) const;
+};
+
+class ResultStore {
+public:
+    static const int DEFAULT_BATCH = 32;
+    static const int DEFAULT_COMPACT_AFTER = 4096;
+
+    explicit ResultStore(const std::string& path = DEFAULT_RESULTS_FILE, int batchSize = DEFAULT_BATCH,
+                         int compactAfter = DEFAULT_COMPACT_AFTER);
+    ~ResultStore();  // Appends the results still waiting
+
+    // Add a game (from any thread). It reaches the file with the next batch,
+    // once batchSize results wait, or at flush().
+    void add(const StoredResult& result);
+    bool flush();
+    bool compact();  // Fold every appended record into the header now
+
+    // Totals of a category, the results of this process still waiting
+    // included. Returns false when the file exists but cannot be read.
+    bool summary(int gridSize, ResultMode mode, bool ai, ResultSummary& out);
+    int bestScore(int gridSize, ResultMode mode, bool ai);  // 0 without any game
+
+private:
+    ResultStore(const ResultStore&);             // Not copyable
+    ResultStore& operator=(const ResultStore&);
+
+    bool flushLocked(bool forceCompaction);
+
+    std::string path;
+    int batchSize;
+    int compactAfter;
+    std::mutex mutex;
+    std::vector<StoredResult> pending;
+};
+
+#endif // RESULTSTORE_HPP
@@ -0,0 +1,74 @@
+#ifndef RNG_HPP
+#define RNG_HPP
+
+#include <cstdint>
+
+// Small, fast random generator for the tile spawns (xoshiro256**). Each game
+// owns one, so games never share state across threads, and the same seed
+// always gives the same sequence of spawns on every platform.
+// It also meets the requirements of the <random> generators.
+class GameRng {
+public:
+    typedef uint64_t result_type;
+
+    explicit GameRng(uint64_t seed = 0) { reseed(seed); }
+
+    // The four state words come from SplitMix64, so any seed (even 0) is usable
+    void reseed(uint64_t seed) {
+        for (int i = 0; i < 4; ++i) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            state[i] = mix(seed);
+        }
+    }
+
+    uint64_t operator()() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Uniform integer in [0, bound) from the high 32 bits (multiply-shift, no division)
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>(((*this)() >> 32) * bound >> 32);
+    }
+
+    // The whole state, to save a game and continue it later with the same spawns
+    void saveState(uint64_t out[4]) const {
+        for (int i = 0; i < 4; ++i) out[i] = state[i];
+    }
+    // False (state unchanged) for the all-zero state, which xoshiro never leaves
+    bool restoreState(const uint64_t in[4]) {
+        if ((in[0] | in[1] | in[2] | in[3]) == 0) return false;
+        for (int i = 0; i < 4; ++i) state[i] = in[i];
+        return true;
+    }
+
+    static uint64_t min() { return 0; }
+    static uint64_t max() { return ~0ULL; }
+
+    // SplitMix64 finalizer, also used to derive independent seeds
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t state[4];
+};
+
+// Seed of game number `game` of a run started with `runSeed`: the same pair
+// always gives the same game, whatever thread plays it.
+inline uint64_t gameSeed(uint64_t runSeed, uint64_t game) {
+    return GameRng::mix(runSeed * 0x9E3779B97F4A7C15ULL + game + 1);
+}
+
+#endif // RNG_HPP
@@ -0,0 +1,94 @@
+#include "searchstats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// Short count for the stats lines: 950, 12.3k, 4.5M
+std::string shortCount(uint64_t count) {
+    char text[32];
+    if (count < 1000) std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(count));
+    else if (count < 1000000) std::snprintf(text, sizeof(text), "%.1fk", count / 1e3);
+    else std::snprintf(text, sizeof(text), "%.1fM", count / 1e6);
+    return text;
+}
+
+} // namespace
+
+void SearchStats::clear() {
+    for (int ply = 0; ply < SEARCH_STATS_MAX_PLY; ++ply) nodes[ply] = 0;
+    evaluations = noopMoves = cacheProbes = cacheHits = cutoffs = 0;
+    depth = 0;
+    milliseconds = 0.0;
+}
+
+void SearchStats::add(const SearchStats& other) {
+    for (int ply = 0; ply < SEARCH_STATS_MAX_PLY; ++ply) nodes[ply] += other.nodes[ply];
+    evaluations += other.evaluations;
+    noopMoves += other.noopMoves;
+    cacheProbes += other.cacheProbes;
+    cacheHits += other.cacheHits;
+    cutoffs += other.cutoffs;
+    depth = std::max(depth, other.depth);
+    milliseconds += other.milliseconds;
+}
+
+uint64_t SearchStats::totalNodes() const {
+    uint64_t total = 0;
+    for (int ply = 0; ply < SEARCH_STATS_MAX_PLY; ++ply) total += nodes[ply];
+    return total;
+}
+
+std::string SearchStats::summaryLine() const {
+    char line[160];
+    std::snprintf(line, sizeof(line), "d%d %s nodes %s evals %s no-ops %s cutoffs cache %.0f%% %.2f ms", depth,
+                  shortCount(totalNodes()).c_str(), shortCount(evaluations).c_str(), shortCount(noopMoves).c_str(),
+                  shortCount(cutoffs).c_str(), cacheProbes ? 100.0 * cacheHits / cacheProbes : 0.0, milliseconds);
+    return line;
+}
+
+void LatencyHistogram::clear() {
+    for (int i = 0; i < BUCKETS; ++i) buckets[i] = 0;
+    samples = 0;
+    total = 0.0;
+    largest = 0.0;
+}
+
+void LatencyHistogram::record(double milliseconds) {
+    double microseconds = milliseconds * 1000.0;
+    int bucket = (microseconds < 1.0) ? 0 : static_cast<int>(8.0 * std::log2(microseconds)) + 1;
+    buckets[std::min(bucket, BUCKETS - 1)]++;
+    samples++;
+    total += milliseconds;
+    largest = std::max(largest, milliseconds);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < BUCKETS; ++i) buckets[i] += other.buckets[i];
+    samples += other.samples;
+    total += other.total;
+    largest = std::max(largest, other.largest);
+}
+
+double LatencyHistogram::percentile(double fraction) const {
+    if (samples == 0) return 0.0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * samples));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            double upperMs = std::pow(2.0, i / 8.0) / 1000.0;  // Bucket i >= 1 holds [2^((i-1)/8), 2^(i/8)) us
+            return std::min(upperMs, largest);
+        }
+    }
+    return largest;
+}
+
+std::string LatencyHistogram::summaryLine() const {
+    char line[96];
+    std::snprintf(line, sizeof(line), "p50 %.2f ms p99 %.2f ms max %.2f ms", percentile(0.50), percentile(0.99),
+                  max());
+    return line;
+}
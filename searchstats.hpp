@@ -0,0 +1,50 @@
+#ifndef SEARCHSTATS_HPP
+#define SEARCHSTATS_HPP
+
+#include <cstdint>
+#include <string>
+
+const int SEARCH_STATS_MAX_PLY = 16;  // Deeper plies are counted in the last one
+
+// What one getBestMove call did (see lastSearchStats)
+struct SearchStats {
+    uint64_t nodes[SEARCH_STATS_MAX_PLY];  // Positions expanded per ply (0: the root)
+    uint64_t evaluations;   // Heuristic evaluations
+    uint64_t noopMoves;     // Moves skipped because they change nothing
+    uint64_t cacheProbes;   // Transposition table lookups
+    uint64_t cacheHits;
+    uint64_t cutoffs;       // Chance nodes evaluated because their probability fell below the cutoff
+    int depth;              // Plies searched (deepest finished iteration of a timed search)
+    double milliseconds;    // Wall time of the decision
+
+    SearchStats() { clear(); }
+    void clear();
+    void add(const SearchStats& other);  // Sums the counters, keeps the deepest depth
+    uint64_t totalNodes() const;
+    std::string summaryLine() const;  // e.g. "d3 12.3k nodes 45.6k evals 1.2k no-ops cache 52% 3.1 ms"
+};
+
+// Distribution of decision times: 8 logarithmic buckets per power of two from
+// 1 microsecond, so any percentile is known within 9% with a fixed 2 KB.
+class LatencyHistogram {
+public:
+    LatencyHistogram() { clear(); }
+    void clear();
+    void record(double milliseconds);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return samples; }
+    double mean() const { return samples ? total / samples : 0.0; }
+    double max() const { return largest; }
+    double percentile(double fraction) const;  // Upper bound of the bucket, capped at max()
+    std::string summaryLine() const;  // e.g. "p50 2.9 ms p99 8.1 ms max 10.2 ms"
+
+private:
+    static const int BUCKETS = 256;
+    uint64_t buckets[BUCKETS];
+    uint64_t samples;
+    double total;
+    double largest;
+};
+
+#endif // SEARCHSTATS_HPP
@@ -0,0 +1,218 @@
+#include "simdeval.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMDEVAL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Bit k of a mask stands for cell k (row-major). For every grid size:
+// cellMask has the cells of the grid, rightMask the cells with a right
+// neighbour and downMask the cells with a neighbour below.
+struct NeighbourMasks {
+    uint64_t cellMask[7];
+    uint64_t rightMask[7];
+    uint64_t downMask[7];
+
+    NeighbourMasks() {
+        for (int size = 0; size <= 6; ++size) {
+            cellMask[size] = rightMask[size] = downMask[size] = 0;
+            for (int k = 0; k < size * size; ++k) {
+                uint64_t bit = 1ULL << k;
+                cellMask[size] |= bit;
+                if (k % size != size - 1) rightMask[size] |= bit;
+                if (k < size * (size - 1)) downMask[size] |= bit;
+            }
+        }
+    }
+};
+
+const NeighbourMasks masks;
+
+// Turn the per-cell comparison bits into the four terms
+inline EvalTerms termsFromMasks(int size, int sum, uint64_t zero, uint64_t geRight, uint64_t eqRight,
+                                uint64_t geDown, uint64_t eqDown) {
+    EvalTerms terms;
+    terms.sum = sum;
+    terms.empty = __builtin_popcountll(zero & masks.cellMask[size]);
+    terms.monotonicity = __builtin_popcountll(geRight & masks.rightMask[size]) +
+                         __builtin_popcountll(geDown & masks.downMask[size]);
+    terms.mergePotential = __builtin_popcountll(eqRight & masks.rightMask[size]) +
+                           __builtin_popcountll(eqDown & masks.downMask[size]);
+    return terms;
+}
+
+// Reference kernel: the loops of evaluateGrid on exponents, which are ordered like the tile values
+EvalTerms scalarTerms(const uint8_t* cells, int size) {
+    EvalTerms terms = {0, 0, 0, 0};
+    for (int i = 0; i < size * size; ++i) {
+        if (cells[i] == 0) terms.empty++;
+        terms.sum += (cells[i] == 0) ? 0 : (1 << cells[i]);
+    }
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size - 1; ++j) {
+            uint8_t left = cells[i * size + j], right = cells[i * size + j + 1];
+            uint8_t top = cells[j * size + i], bottom = cells[(j + 1) * size + i];
+            if (left >= right) terms.monotonicity++;
+            if (top >= bottom) terms.monotonicity++;
+            if (left == right) terms.mergePotential++;
+            if (top == bottom) terms.mergePotential++;
+        }
+    }
+    return terms;
+}
+
+#ifdef SIMDEVAL_X86
+
+// 2^e for four 32-bit exponents (0 gives 0): the exponent is written straight
+// into the exponent field of a float, which converts back to an exact integer.
+__attribute__((target("sse4.1")))
+inline __m128i powersOfTwoSse(__m128i exponents) {
+    __m128i bits = _mm_slli_epi32(_mm_add_epi32(exponents, _mm_set1_epi32(127)), 23);
+    __m128i values = _mm_cvttps_epi32(_mm_castsi128_ps(bits));
+    return _mm_andnot_si128(_mm_cmpeq_epi32(exponents, _mm_setzero_si128()), values);
+}
+
+// 16 cells per step. Each cell is compared with the cell on its right
+// (offset 1) and the cell below it (offset size); max(a, b) == a means a >= b.
+__attribute__((target("sse4.1,popcnt")))
+EvalTerms sse41Terms(const uint8_t* cells, int size) {
+    uint64_t zero = 0, geRight = 0, eqRight = 0, geDown = 0, eqDown = 0;
+    __m128i sum = _mm_setzero_si128();
+    const __m128i zeros = _mm_setzero_si128();
+    for (int offset = 0; offset < size * size; offset += 16) {
+        __m128i cell = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells + offset));
+        __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells + offset + 1));
+        __m128i down = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells + offset + size));
+
+        zero |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(cell, zeros))) << offset;
+        geRight |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(cell, right), cell))) << offset;
+        eqRight |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(cell, right))) << offset;
+        geDown |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(cell, down), cell))) << offset;
+        eqDown |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(cell, down))) << offset;
+
+        // Tile values, four cells at a time (the zero padding adds nothing)
+        sum = _mm_add_epi32(sum, powersOfTwoSse(_mm_cvtepu8_epi32(cell)));
+        sum = _mm_add_epi32(sum, powersOfTwoSse(_mm_cvtepu8_epi32(_mm_srli_si128(cell, 4))));
+        sum = _mm_add_epi32(sum, powersOfTwoSse(_mm_cvtepu8_epi32(_mm_srli_si128(cell, 8))));
+        sum = _mm_add_epi32(sum, powersOfTwoSse(_mm_cvtepu8_epi32(_mm_srli_si128(cell, 12))));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return termsFromMasks(size, _mm_cvtsi128_si32(sum), zero, geRight, eqRight, geDown, eqDown);
+}
+
+// 2^e for eight 32-bit exponents (0 gives 0) with a variable shift
+__attribute__((target("avx2")))
+inline __m256i powersOfTwoAvx2(__m128i exponentBytes) {
+    __m256i exponents = _mm256_cvtepu8_epi32(exponentBytes);
+    __m256i values = _mm256_sllv_epi32(_mm256_set1_epi32(1), exponents);
+    return _mm256_andnot_si256(_mm256_cmpeq_epi32(exponents, _mm256_setzero_si256()), values);
+}
+
+// Same as the SSE4.1 kernel with 32 cells per step: one step for 5x5, two for 6x6.
+// A 4x4 grid fits in one SSE vector, which is faster than a half-empty AVX2 one.
+__attribute__((target("avx2,popcnt")))
+EvalTerms avx2Terms(const uint8_t* cells, int size) {
+    if (size * size <= 16) return sse41Terms(cells, size);
+    uint64_t zero = 0, geRight = 0, eqRight = 0, geDown = 0, eqDown = 0;
+    __m256i sum = _mm256_setzero_si256();
+    const __m256i zeros = _mm256_setzero_si256();
+    for (int offset = 0; offset < size * size; offset += 32) {
+        __m256i cell = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells + offset));
+        __m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells + offset + 1));
+        __m256i down = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells + offset + size));
+
+        // movemask returns an int: go through uint32_t so bit 31 is not sign-extended
+        zero |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cell, zeros)))) << offset;
+        geRight |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(cell, right), cell)))) << offset;
+        eqRight |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cell, right)))) << offset;
+        geDown |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(cell, down), cell)))) << offset;
+        eqDown |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cell, down)))) << offset;
+
+        __m128i low = _mm256_castsi256_si128(cell);
+        __m128i high = _mm256_extracti128_si256(cell, 1);
+        sum = _mm256_add_epi32(sum, powersOfTwoAvx2(low));
+        sum = _mm256_add_epi32(sum, powersOfTwoAvx2(_mm_srli_si128(low, 8)));
+        sum = _mm256_add_epi32(sum, powersOfTwoAvx2(high));
+        sum = _mm256_add_epi32(sum, powersOfTwoAvx2(_mm_srli_si128(high, 8)));
+    }
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(1, 0, 3, 2)));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(2, 3, 0, 1)));
+    return termsFromMasks(size, _mm_cvtsi128_si32(total), zero, geRight, eqRight, geDown, eqDown);
+}
+
+#endif // SIMDEVAL_X86
+
+EvalKernel detectEvalKernel() {
+#ifdef SIMDEVAL_X86
+    __builtin_cpu_init();  // Runs before the other constructors, so initialize the CPU data first
+#endif
+    EvalKernel best = EVAL_KERNEL_SCALAR;
+    for (int kernel = EVAL_KERNEL_SSE41; kernel <= EVAL_KERNEL_AVX2; ++kernel) {
+        if (evalKernelSupported(static_cast<EvalKernel>(kernel))) best = static_cast<EvalKernel>(kernel);
+    }
+    return best;
+}
+
+EvalKernel activeKernel = detectEvalKernel();  // Chosen once at program startup
+
+} // namespace
+
+bool evalKernelSupported(EvalKernel kernel) {
+    switch (kernel) {
+        case EVAL_KERNEL_SCALAR: return true;
+#ifdef SIMDEVAL_X86
+        case EVAL_KERNEL_SSE41: return __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt");
+        case EVAL_KERNEL_AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+        default: return false;
+    }
+}
+
+const char* evalKernelName(EvalKernel kernel) {
+    switch (kernel) {
+        case EVAL_KERNEL_SSE41: return "sse4.1";
+        case EVAL_KERNEL_AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+EvalKernel activeEvalKernel() {
+    return activeKernel;
+}
+
+void setEvalKernel(EvalKernel kernel) {
+    if (evalKernelSupported(kernel)) activeKernel = kernel;
+}
+
+EvalTerms computeEvalTerms(const uint8_t* cells, int size) {
+    return computeEvalTerms(cells, size, activeKernel);
+}
+
+EvalTerms computeEvalTerms(const uint8_t* cells, int size, EvalKernel kernel) {
+    switch (kernel) {
+#ifdef SIMDEVAL_X86
+        case EVAL_KERNEL_AVX2: return avx2Terms(cells, size);
+        case EVAL_KERNEL_SSE41: return sse41Terms(cells, size);
+#endif
+        default: return scalarTerms(cells, size);
+    }
+}
+
+void unpackBoardCells(Board board, uint8_t* cells) {
+#ifdef SIMDEVAL_X86
+    // Low and high nibbles of every byte, interleaved back into cell order (SSE2 only)
+    __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&board));
+    __m128i nibbleMask = _mm_set1_epi8(0x0F);
+    __m128i low = _mm_and_si128(packed, nibbleMask);
+    __m128i high = _mm_and_si128(_mm_srli_epi64(packed, 4), nibbleMask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(cells), _mm_unpacklo_epi8(low, high));
+#else
+    for (int i = 0; i < 16; ++i) {
+        cells[i] = static_cast<uint8_t>((board >> (4 * i)) & 0xF);
+    }
+#endif
+}
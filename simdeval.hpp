@@ -0,0 +1,43 @@
+#ifndef SIMDEVAL_HPP
+#define SIMDEVAL_HPP
+
+#include <cstdint>
+#include "bitboard.hpp"
+
+// Vectorized kernels for the terms of the evaluateGrid heuristic.
+// Every kernel computes all four terms for rows and columns in one pass and
+// gives exactly the same counts as the scalar reference.
+
+// Kernels, from the slowest to the fastest
+enum EvalKernel {
+    EVAL_KERNEL_SCALAR,
+    EVAL_KERNEL_SSE41,
+    EVAL_KERNEL_AVX2
+};
+
+// The four terms of the heuristic, before weighting
+struct EvalTerms {
+    int sum;             // Sum of the tile values
+    int empty;           // Number of empty cells
+    int monotonicity;    // Neighbour pairs ordered left >= right or top >= bottom
+    int mergePotential;  // Equal neighbour pairs
+};
+
+// Size of the cell buffers the kernels read: the kernels load whole vectors
+// past the last cell, so the cells after size * size must be zero.
+const int EVAL_PADDED_CELLS = 96;
+
+bool evalKernelSupported(EvalKernel kernel);
+const char* evalKernelName(EvalKernel kernel);
+EvalKernel activeEvalKernel();  // The best supported kernel, picked at startup
+void setEvalKernel(EvalKernel kernel);  // Ignored when the CPU does not support the kernel
+
+// cells: size * size tile exponents (row-major, size 1 to 6, exponents below 31),
+// followed by zeros up to EVAL_PADDED_CELLS.
+EvalTerms computeEvalTerms(const uint8_t* cells, int size);  // Active kernel
+EvalTerms computeEvalTerms(const uint8_t* cells, int size, EvalKernel kernel);
+
+// Write the 16 exponents of a packed board to the first 16 cells of a buffer
+void unpackBoardCells(Board board, uint8_t* cells);
+
+#endif // SIMDEVAL_HPP
@@ -0,0 +1,450 @@
+#include "modele.hpp"   // Game logic functions
+#include "ai.hpp"       // AI decision-making
+#include "gamelog.hpp"  // Binary game records
+#include "batchmove.hpp" // Lockstep moves
+#include "transposition.hpp" // Cache statistics
+#include "resultstore.hpp" // Results shared with other runs
+#include <algorithm>    // For sorting the results
+#include <chrono>       // For throughput measurements
+#include <cstdlib>      // For std::atoi and std::strtoull
+#include <ctime>        // For the stored results
+#include <fstream>      // For the JSON report
+#include <iomanip>      // For formatted output
+#include <iostream>     // For the report
+#include <map>          // For the max-tile distribution
+#include <memory>       // For the optional game record
+#include <string>       // For command-line options
+#include <thread>       // For the simulation threads
+#include <vector>       // For the grids and the results
+
+// Outcome of one simulated game
+struct GameResult {
+    int score;
+    int maxTile;
+    int moves;
+    double openingSeconds;  // Search time of the first OPENING_MOVES moves
+    SearchStats search;     // Totals over every decision of the game
+    LatencyHistogram latency;
+
+    GameResult() : score(0), maxTile(0), moves(0), openingSeconds(0.0) {}
+};
+
+const int OPENING_MOVES = 20;  // Moves timed to measure how warm the search cache is
+
+// Settings read from the command line
+struct SimulationOptions {
+    uint64_t seed;
+    int gridSize;
+    int threads;
+    int gamesPerThread;
+    int moveTimeMs;  // Time limit per move (0: fixed-depth search)
+    SearchOptions search;
+    std::string recordPath;  // Binary game log (empty: no recording)
+    std::string cachePath;   // Persistent search cache (empty: in-memory table)
+    std::string jsonPath;    // Per-game search statistics (empty: none)
+    std::string weightsPath; // Heuristic weights (empty: data/weights.txt if it exists)
+    std::string ntuplePath;  // Trained n-tuple network evaluating 4x4 boards (empty: heuristic)
+    std::string resultsPath; // Results store the games are added to (empty: none)
+    int ttMegabytes;         // Size of the search cache
+    bool lockstep;           // Step each thread's games together with batchMove (4x4 only)
+
+    SimulationOptions() : seed(1), gridSize(4), threads(1), gamesPerThread(10), moveTimeMs(0), ttMegabytes(64),
+                          lockstep(false) {}
+};
+
+// Move index of a getBestMove answer (-1 for "None")
+int moveIndex(const std::string& name) {
+    static const char* names[] = {"Up", "Down", "Left", "Right"};
+    for (int move = 0; move < 4; ++move) {
+        if (name == names[move]) return move;
+    }
+    return -1;
+}
+
+void recordMaxTile(const FlatGrid& grid, GameResult& result) {
+    for (int i = 0; i < grid.size * grid.size; ++i) {
+        result.maxTile = std::max(result.maxTile, tileValue(grid.cells[i]));
+    }
+}
+
+// Time one decision and add its search statistics to the game
+std::string timedBestMove(const FlatGrid& grid, const SearchOptions& search, int moveTimeMs, GameResult& result) {
+    auto searchStart = std::chrono::steady_clock::now();
+    std::string bestMove = (moveTimeMs > 0) ? getBestMove(grid, result.score, search, moveTimeMs)
+                                            : getBestMove(grid, result.score, search);
+    result.search.add(lastSearchStats());
+    result.latency.record(lastSearchStats().milliseconds);
+    if (result.moves < OPENING_MOVES) {
+        result.openingSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - searchStart).count();
+    }
+    return bestMove;
+}
+
+// Play a game until it is over: ask getBestMove for a move, apply it and spawn
+// a tile. The game runs on a FlatGrid so no move allocates memory. With a
+// record, every move and spawn is added to it.
+void finishGame(FlatGrid& grid, GameRng& rng, const SearchOptions& search, int moveTimeMs, GameRecord* record,
+                GameResult& result) {
+    bool moved = false;
+    while (!isGameOver(grid)) {
+        std::string bestMove = timedBestMove(grid, search, moveTimeMs, result);
+        int move = -1;
+        if (bestMove == "Up") move = 0, moveUp(grid, moved, result.score);
+        else if (bestMove == "Down") move = 1, moveDown(grid, moved, result.score);
+        else if (bestMove == "Left") move = 2, moveLeft(grid, moved, result.score);
+        else if (bestMove == "Right") move = 3, moveRight(grid, moved, result.score);
+        else break;  // No valid move left
+
+        if (!moved) break;  // The AI should never pick a move that changes nothing
+        if (record) record->addMove(move);
+        int cell = addRandomTile(grid, rng);
+        if (record) record->addSpawn(cell, cell < 0 ? 0 : grid.cells[cell]);
+        result.moves++;
+    }
+    recordMaxTile(grid, result);
+}
+
+// Play one complete game without any display. With a log, the game is
+// appended to it at the end.
+GameResult playGame(int gridSize, uint64_t seed, const SearchOptions& search, int moveTimeMs, GameLogWriter* log) {
+    GameRng rng(seed);
+    FlatGrid grid = makeFlatGrid(gridSize);
+    std::unique_ptr<GameRecord> record(log ? new GameRecord(seed, gridSize) : nullptr);
+    for (int i = 0; i < 2; ++i) {
+        int cell = addRandomTile(grid, rng);
+        if (record) record->addSpawn(cell, cell < 0 ? 0 : grid.cells[cell]);
+    }
+
+    GameResult result;
+    finishGame(grid, rng, search, moveTimeMs, record.get(), result);
+    if (record) log->write(*record);
+    return result;
+}
+
+// One game of a lockstep batch
+struct LockstepGame {
+    int index;       // Position in the results
+    GameRng rng;
+    std::unique_ptr<GameRecord> record;
+    bool stopped;    // Its last move changed nothing
+
+    LockstepGame() : index(0), stopped(false) {}
+};
+
+// True when a cell holds 32768: packed boards cannot merge two of them
+bool hasMaxTile(Board board) {
+    uint64_t full = board & (board >> 1);
+    full &= full >> 2;
+    return (full & 0x1111111111111111ULL) != 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// Function: playLockstep
+// Description: Plays 4x4 games side by side on packed boards: every step asks
+//              each running game for its move, applies all the moves with one
+//              batchMove call, then spawns the tiles. Every game keeps its own
+//              generator, so the results are those of playGame. A game that
+//              reaches 32768 is finished on a FlatGrid, which merges past it.
+// Parameters:
+//   - first, count: Results indices of the games (seeded like playGame).
+//   - results: Receives the result of every game.
+/////////////////////////////////////////////////////////////////////////////////
+void playLockstep(int first, int count, const SimulationOptions& options, GameLogWriter* log,
+                  std::vector<GameResult>& results) {
+    std::vector<LockstepGame> games(count);
+    std::vector<Board> boards(count, 0);
+    for (int g = 0; g < count; ++g) {
+        LockstepGame& game = games[g];
+        game.index = first + g;
+        uint64_t seed = gameSeed(options.seed, game.index);
+        game.rng.reseed(seed);
+        if (log) game.record.reset(new GameRecord(seed, 4));
+        for (int i = 0; i < 2; ++i) {
+            int cell = spawnBoardTile(boards[g], game.rng);
+            if (game.record) game.record->addSpawn(cell, cell < 0 ? 0 : static_cast<int>((boards[g] >> (4 * cell)) & 0xF));
+        }
+    }
+
+    std::vector<uint8_t> moves(count);
+    std::vector<int> scoreDeltas(count);
+    std::vector<uint8_t> moved(count);
+    FlatGrid grid = makeFlatGrid(4);
+    while (!games.empty()) {
+        // Decisions: games that are over (or too far for a packed board) leave the batch
+        size_t running = 0;
+        for (size_t g = 0; g < games.size(); ++g) {
+            LockstepGame& game = games[g];
+            GameResult& result = results[game.index];
+            unpackBoard(boards[g], grid);
+            int move = -1;
+            if (hasMaxTile(boards[g])) {
+                finishGame(grid, game.rng, options.search, options.moveTimeMs, game.record.get(), result);
+            } else if (!game.stopped && !boardIsGameOver(boards[g])) {
+                move = moveIndex(timedBestMove(grid, options.search, options.moveTimeMs, result));
+            }
+            if (move < 0) {
+                recordMaxTile(grid, result);
+                if (game.record) log->write(*game.record);
+                continue;
+            }
+            if (running != g) {
+                games[running] = std::move(game);
+                boards[running] = boards[g];
+            }
+            moves[running] = static_cast<uint8_t>(move);
+            ++running;
+        }
+        games.resize(running);
+        boards.resize(running);
+
+        // One batch for every move of this step
+        batchMove(boards.data(), moves.data(), static_cast<int>(running), scoreDeltas.data(), moved.data());
+        for (size_t g = 0; g < running; ++g) {
+            if (!moved[g]) {  // The AI should never pick a move that changes nothing
+                games[g].stopped = true;
+                continue;
+            }
+            GameResult& result = results[games[g].index];
+            result.score += scoreDeltas[g];
+            result.moves++;
+            if (games[g].record) games[g].record->addMove(moves[g]);
+            int cell = spawnBoardTile(boards[g], games[g].rng);
+            if (games[g].record) {
+                games[g].record->addSpawn(cell, cell < 0 ? 0 : static_cast<int>((boards[g] >> (4 * cell)) & 0xF));
+            }
+        }
+    }
+}
+
+// Value at the given fraction of a sorted list
+int percentile(const std::vector<int>& sorted, double fraction) {
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+// One line of JSON with the result and search statistics of a game
+void writeGameJson(std::ostream& out, int game, uint64_t seed, int gridSize, const GameResult& result) {
+    const SearchStats& search = result.search;
+    out << "{\"game\":" << game << ",\"seed\":" << seed << ",\"size\":" << gridSize
+        << ",\"score\":" << result.score << ",\"maxTile\":" << result.maxTile << ",\"moves\":" << result.moves
+        << ",\"depth\":" << search.depth << ",\"nodesPerPly\":[";
+    int lastPly = SEARCH_STATS_MAX_PLY - 1;
+    while (lastPly > 0 && search.nodes[lastPly] == 0) lastPly--;
+    for (int ply = 0; ply <= lastPly; ++ply) {
+        out << (ply ? "," : "") << search.nodes[ply];
+    }
+    out << "],\"evaluations\":" << search.evaluations << ",\"noopMoves\":" << search.noopMoves
+        << ",\"cacheProbes\":" << search.cacheProbes << ",\"cacheHits\":" << search.cacheHits
+        << ",\"cutoffs\":" << search.cutoffs << ",\"latencyMs\":{\"mean\":" << result.latency.mean()
+        << ",\"p50\":" << result.latency.percentile(0.50) << ",\"p99\":" << result.latency.percentile(0.99)
+        << ",\"max\":" << result.latency.max() << "}}\n";
+}
+
+// Print usage information
+void printUsage() {
+    std::cout << "Usage: simulate [--seed S] [--size 4|5|6] [--threads T] [--games G]\n"
+              << "                [--expectimax] [--depth D] [--cutoff P] [--time MS]\n"
+              << "                [--eval table|simd] [--record FILE]\n"
+              << "                [--tt MB] [--cache FILE] [--json FILE]\n"
+              << "                [--weights FILE] [--ntuple FILE] [--greedy] [--lockstep]\n"
+              << "                [--rollouts N] [--search-threads T] [--results FILE]\n"
+              << "Plays G games on each of T threads and reports throughput and results.\n"
+              << "--results adds the games to a results store (data/results.bin is the one\n"
+              << "the game and ai_player use) and prints its totals for the grid size.\n";
+}
+
+// Main function of the headless batch simulator
+int main(int argc, char* argv[]) {
+    SimulationOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--seed" && hasValue) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--size" && hasValue) options.gridSize = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--games" && hasValue) options.gamesPerThread = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--expectimax") options.search.mode = SEARCH_EXPECTIMAX;
+        else if (arg == "--depth" && hasValue) options.search.depth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--cutoff" && hasValue) options.search.probCutoff = std::atof(argv[++i]);
+        else if (arg == "--time" && hasValue) options.moveTimeMs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--record" && hasValue) options.recordPath = argv[++i];
+        else if (arg == "--cache" && hasValue) options.cachePath = argv[++i];
+        else if (arg == "--weights" && hasValue) options.weightsPath = argv[++i];
+        else if (arg == "--ntuple" && hasValue) options.ntuplePath = argv[++i];
+        else if (arg == "--results" && hasValue) options.resultsPath = argv[++i];
+        else if (arg == "--greedy") options.search.mode = SEARCH_GREEDY;
+        else if (arg == "--rollouts" && hasValue) {
+            options.search.mode = SEARCH_ROLLOUT;
+            options.search.rollouts = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--search-threads" && hasValue) options.search.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--lockstep") options.lockstep = true;
+        else if (arg == "--json" && hasValue) options.jsonPath = argv[++i];
+        else if (arg == "--tt" && hasValue) options.ttMegabytes = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--eval" && hasValue) {
+            std::string backend = argv[++i];
+            if (backend == "table") setEvalBackend(EVAL_BACKEND_TABLE);
+            else if (backend == "simd") setEvalBackend(EVAL_BACKEND_SIMD);
+            else {
+                printUsage();
+                return 1;
+            }
+        }
+        else {
+            printUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+    if (options.gridSize < 4 || options.gridSize > 6) {
+        std::cout << "Invalid grid size! Use 4, 5 or 6.\n";
+        return 1;
+    }
+    if (options.lockstep && options.gridSize != 4) {
+        std::cout << "--lockstep plays packed 4x4 boards only.\n";
+        return 1;
+    }
+    // Tuned weights (see tune); the cache file is versioned with them, so load them first
+    EvalWeights weights;
+    if (!options.weightsPath.empty()) {
+        if (!readEvalWeights(options.weightsPath, weights)) {
+            std::cout << "Could not read weights file " << options.weightsPath << "\n";
+            return 1;
+        }
+        setEvalWeights(weights);
+    } else if (readEvalWeights(DEFAULT_WEIGHTS_FILE, weights)) {
+        setEvalWeights(weights);
+    }
+    if (!options.ntuplePath.empty() && !loadNTupleEvaluator(options.ntuplePath)) {
+        std::cout << "Could not read network " << options.ntuplePath << "\n";
+        return 1;
+    }
+    if (options.cachePath.empty()) {
+        configureTranspositionTable(options.ttMegabytes);
+    } else if (!openEvaluationCache(options.cachePath, options.ttMegabytes)) {
+        std::cout << "Could not open search cache " << options.cachePath << "\n";
+        return 1;
+    }
+
+    GameLogWriter log;
+    if (!options.recordPath.empty() && !log.open(options.recordPath)) {
+        std::cout << "Could not open " << options.recordPath << " for recording\n";
+        return 1;
+    }
+    GameLogWriter* logPointer = options.recordPath.empty() ? nullptr : &log;
+    // Games reach the store in batches while the run goes on
+    std::unique_ptr<ResultStore> store(options.resultsPath.empty() ? nullptr : new ResultStore(options.resultsPath));
+    ResultStore* storePointer = store.get();
+
+    // Every game has its own seed, so results do not depend on the thread schedule
+    int totalGames = options.threads * options.gamesPerThread;
+    std::vector<GameResult> results(totalGames);
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&options, &results, logPointer, storePointer, t]() {
+            auto storeGame = [&](const GameResult& result) {
+                StoredResult stored;
+                stored.gridSize = options.gridSize;
+                stored.ai = true;
+                stored.score = result.score;
+                stored.maxTile = result.maxTile;
+                stored.moves = result.moves;
+                stored.timestamp = static_cast<uint64_t>(std::time(0));
+                storePointer->add(stored);
+            };
+            if (options.lockstep) {
+                playLockstep(t * options.gamesPerThread, options.gamesPerThread, options, logPointer, results);
+                for (int g = 0; storePointer && g < options.gamesPerThread; ++g) {
+                    storeGame(results[t * options.gamesPerThread + g]);
+                }
+                return;
+            }
+            for (int g = 0; g < options.gamesPerThread; ++g) {
+                int game = t * options.gamesPerThread + g;
+                results[game] = playGame(options.gridSize, gameSeed(options.seed, game), options.search,
+                                         options.moveTimeMs, logPointer);
+                if (storePointer) storeGame(results[game]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    log.close();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    // Gather the distributions
+    std::vector<int> scores;
+    std::map<int, int> maxTiles;
+    long long totalMoves = 0;
+    long long totalScore = 0;
+    double openingSeconds = 0.0;
+    long long openingMoves = 0;
+    SearchStats search;
+    LatencyHistogram latency;
+    for (const GameResult& result : results) {
+        search.add(result.search);
+        latency.merge(result.latency);
+        scores.push_back(result.score);
+        maxTiles[result.maxTile]++;
+        totalMoves += result.moves;
+        totalScore += result.score;
+        openingSeconds += result.openingSeconds;
+        openingMoves += std::min(result.moves, OPENING_MOVES);
+    }
+    std::sort(scores.begin(), scores.end());
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Games: " << totalGames << " (" << options.threads << " threads, "
+              << options.gridSize << "x" << options.gridSize << ", seed " << options.seed << ")\n";
+    std::cout << "Time: " << std::setprecision(3) << seconds << " s\n" << std::setprecision(1);
+    std::cout << "Games/sec: " << totalGames / seconds << "\n";
+    std::cout << "Moves/sec: " << totalMoves / seconds << "\n";
+    std::cout << "Opening moves: " << std::setprecision(3) << 1000.0 * openingSeconds / std::max(1LL, openingMoves)
+              << " ms/move (first " << OPENING_MOVES << " moves of each game)\n" << std::setprecision(1);
+    std::cout << "Decision time: " << latency.summaryLine() << "\n";
+    double decisions = std::max<double>(1.0, static_cast<double>(latency.count()));
+    std::cout << "Per decision: " << search.totalNodes() / decisions << " nodes, "
+              << search.evaluations / decisions << " evaluations, " << search.noopMoves / decisions
+              << " no-op moves, " << search.cutoffs / decisions << " cutoffs\n";
+    if (sharedTranspositionTable().probeCount() > 0) {
+        std::cout << "Cache: " << sharedTranspositionTable().statsLine() << "\n";
+    }
+    std::cout << "Score: min " << scores.front()
+              << ", p10 " << percentile(scores, 0.10)
+              << ", median " << percentile(scores, 0.50)
+              << ", mean " << static_cast<double>(totalScore) / totalGames
+              << ", p90 " << percentile(scores, 0.90)
+              << ", max " << scores.back() << "\n";
+    std::cout << "Max tile:\n";
+    for (const auto& entry : maxTiles) {
+        std::cout << "  " << std::setw(6) << entry.first << ": " << std::setw(6) << entry.second
+                  << " (" << 100.0 * entry.second / totalGames << "%)\n";
+    }
+
+    if (store) {
+        ResultSummary stored;
+        if (!store->flush() || !store->summary(options.gridSize, RESULT_CLASSIC, true, stored)) {
+            std::cout << "Could not update " << options.resultsPath << "\n";
+            return 1;
+        }
+        std::cout << "Stored AI results (" << options.resultsPath << "): " << stored.games << " games, best "
+                  << stored.bestScore << ", mean " << stored.meanScore() << ", median at most "
+                  << stored.scorePercentile(0.5) << ", 2048 in " << 100.0 * stored.reachedTile(2048) << "%\n";
+    }
+
+    if (!options.jsonPath.empty()) {
+        std::ofstream json(options.jsonPath.c_str());
+        json << std::setprecision(4);
+        for (int game = 0; game < totalGames; ++game) {
+            writeGameJson(json, game, gameSeed(options.seed, game), options.gridSize, results[game]);
+        }
+        if (!json) {
+            std::cout << "Could not write " << options.jsonPath << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "sizedboard.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIZEDBOARD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+#ifdef SIZEDBOARD_X86
+
+// Lane k of the vectors below is line k of the move: row k for Left and Right,
+// column k for Up and Down. The lines run through the slide of
+// sized::slideLine together, one cell position per step, and lane k of the
+// result is the slid line packed like a row (a column: top cell first).
+template <int N, int MOVE>
+__attribute__((target("avx2")))
+SizedBoard<N> avx2MoveKernel(const SizedBoard<N>& board, int& scoreDelta) {
+    static_assert(SizedBoard<N>::ROW_BITS <= 32 && N <= 8, "one line per 32-bit lane");
+    const int bits = SizedBoard<N>::CELL_BITS;
+    const bool reversed = (MOVE == 1 || MOVE == 3);
+    uint32_t rows[8] = {0};
+    SIZED_UNROLL for (int i = 0; i < N; ++i) rows[i] = static_cast<uint32_t>(board.row(i));
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i cellMask = _mm256_set1_epi32(SizedBoard<N>::MAX_EXPONENT);
+    const __m256i laneShift = _mm256_setr_epi32(0, bits, 2 * bits, 3 * bits, 4 * bits, 5 * bits, 6 * bits, 7 * bits);
+    const __m256i rowVector = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows));
+    __m256i write = zero;   // Cells written so far
+    __m256i last = zero;    // Exponent of the last written tile while it can still merge
+    __m256i result = zero;
+    __m256i score = zero;
+    SIZED_UNROLL for (int i = 0; i < N; ++i) {
+        // Cell i of every line in slide order
+        __m256i exponent;
+        if (MOVE >= 2) {
+            exponent = _mm256_and_si256(_mm256_srli_epi32(rowVector, bits * (reversed ? N - 1 - i : i)), cellMask);
+        } else {
+            __m256i row = _mm256_set1_epi32(static_cast<int>(rows[reversed ? N - 1 - i : i]));
+            exponent = _mm256_and_si256(_mm256_srlv_epi32(row, laneShift), cellMask);
+        }
+        __m256i tile = _mm256_cmpgt_epi32(exponent, zero);
+        __m256i merge = _mm256_and_si256(_mm256_and_si256(tile, _mm256_cmpeq_epi32(exponent, last)),
+                                         _mm256_cmpgt_epi32(cellMask, exponent));
+        __m256i to = _mm256_add_epi32(write, merge);  // merge is -1 in the lanes that merge
+        if (reversed) to = _mm256_sub_epi32(_mm256_set1_epi32(N - 1), to);
+        __m256i shift = _mm256_mullo_epi32(to, _mm256_set1_epi32(bits));
+        result = _mm256_add_epi32(result, _mm256_sllv_epi32(_mm256_blendv_epi8(exponent, one, merge), shift));
+        score = _mm256_add_epi32(score, _mm256_and_si256(merge, _mm256_sllv_epi32(two, exponent)));
+        write = _mm256_sub_epi32(write, _mm256_andnot_si256(merge, tile));
+        last = _mm256_blendv_epi8(_mm256_blendv_epi8(last, exponent, tile), zero, merge);
+    }
+
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(score), _mm256_extracti128_si256(score, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    scoreDelta += _mm_cvtsi128_si32(sum);
+
+    SizedBoard<N> moved = SizedBoard<N>();
+    if (MOVE >= 2) {
+        uint32_t lines[8];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lines), result);
+        SIZED_UNROLL for (int i = 0; i < N; ++i) moved.setRow(i, lines[i]);
+    } else {
+        // Row i: cell i of every column, moved to the lane's column and ORed together
+        SIZED_UNROLL for (int i = 0; i < N; ++i) {
+            __m256i cells = _mm256_sllv_epi32(_mm256_and_si256(_mm256_srli_epi32(result, bits * i), cellMask), laneShift);
+            __m128i row = _mm_or_si128(_mm256_castsi256_si128(cells), _mm256_extracti128_si256(cells, 1));
+            row = _mm_or_si128(row, _mm_shuffle_epi32(row, 0x4E));
+            row = _mm_or_si128(row, _mm_shuffle_epi32(row, 0xB1));
+            moved.setRow(i, static_cast<uint32_t>(_mm_cvtsi128_si32(row)));
+        }
+    }
+    return moved;
+}
+
+template <int N>
+__attribute__((target("avx2")))
+SizedBoard<N> avx2MoveAny(const SizedBoard<N>& board, int move, int& scoreDelta) {
+    switch (move) {
+        case 0: return avx2MoveKernel<N, 0>(board, scoreDelta);
+        case 1: return avx2MoveKernel<N, 1>(board, scoreDelta);
+        case 2: return avx2MoveKernel<N, 2>(board, scoreDelta);
+        default: return avx2MoveKernel<N, 3>(board, scoreDelta);
+    }
+}
+
+#endif // SIZEDBOARD_X86
+
+SizedMoveKernel detectSizedMoveKernel() {
+#ifdef SIZEDBOARD_X86
+    __builtin_cpu_init();  // May run before the other constructors
+#endif
+    return sizedMoveKernelSupported(SIZED_MOVE_AVX2) ? SIZED_MOVE_AVX2 : SIZED_MOVE_SCALAR;
+}
+
+SizedMoveKernel activeKernel = detectSizedMoveKernel();  // Chosen once at program startup
+bool avx2Available = sizedMoveKernelSupported(SIZED_MOVE_AVX2);
+
+} // namespace
+
+bool sizedMoveKernelSupported(SizedMoveKernel kernel) {
+    switch (kernel) {
+        case SIZED_MOVE_SCALAR: return true;
+#ifdef SIZEDBOARD_X86
+        case SIZED_MOVE_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+const char* sizedMoveKernelName(SizedMoveKernel kernel) {
+    return (kernel == SIZED_MOVE_AVX2) ? "avx2" : "scalar";
+}
+
+SizedMoveKernel activeSizedMoveKernel() {
+    return activeKernel;
+}
+
+void setSizedMoveKernel(SizedMoveKernel kernel) {
+    if (sizedMoveKernelSupported(kernel)) activeKernel = kernel;
+}
+
+namespace sized {
+
+bool avx2Move(const SizedBoard<5>& board, int move, int& scoreDelta, SizedBoard<5>& result) {
+#ifdef SIZEDBOARD_X86
+    if (avx2Available) {
+        result = avx2MoveAny(board, move, scoreDelta);
+        return true;
+    }
+#endif
+    (void)board, (void)move, (void)scoreDelta, (void)result;
+    return false;
+}
+
+bool avx2Move(const SizedBoard<6>& board, int move, int& scoreDelta, SizedBoard<6>& result) {
+#ifdef SIZEDBOARD_X86
+    if (avx2Available) {
+        result = avx2MoveAny(board, move, scoreDelta);
+        return true;
+    }
+#endif
+    (void)board, (void)move, (void)scoreDelta, (void)result;
+    return false;
+}
+
+} // namespace sized
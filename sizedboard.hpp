@@ -0,0 +1,297 @@
+#ifndef SIZEDBOARD_HPP
+#define SIZEDBOARD_HPP
+
+#include <cstdint>
+#include "grid.hpp"
+#include "rng.hpp"
+
+// Packed N x N board with the size known at compile time, for the 4, 5 and 6
+// grids of the menu. Every loop below runs over a constant number of cells
+// and the move loops are unrolled (SIZED_UNROLL), so a move compiles to
+// straight-line code on registers; a board is copied as 1 to 3 words instead
+// of a 37-byte FlatGrid. On 5x5 and 6x6, an AVX2 kernel (sizedboard.cpp)
+// slides every line of the board at once, one line per vector lane.
+//
+// Cells hold tile exponents in CELL_BITS bits: 4 on 4x4 (the Board layout of
+// bitboard.hpp), 5 on the larger grids, whose games go far past 32768. Rows
+// of CELL_BITS * N bits are packed into 64-bit words without straddling two
+// words: 4 rows per word on 4x4, 2 on 5x5 and 6x6 (3 words). Like Board,
+// the packed board does not merge two tiles of the largest exponent.
+
+// Full unrolling of the loops over the cells of a line; -O2 does not unroll
+// them by itself, and then the line arrays stay in memory
+#if defined(__GNUC__) && !defined(__clang__)
+#define SIZED_UNROLL _Pragma("GCC unroll 8")
+#elif defined(__clang__)
+#define SIZED_UNROLL _Pragma("unroll")
+#else
+#define SIZED_UNROLL
+#endif
+
+template <int N>
+struct SizedBoard {
+    static const int CELL_BITS = (N <= 4) ? 4 : 5;
+    static const int ROW_BITS = CELL_BITS * N;
+    static const int ROWS_PER_WORD = 64 / ROW_BITS;
+    static const int WORDS = (N + ROWS_PER_WORD - 1) / ROWS_PER_WORD;
+    static const int MAX_EXPONENT = (1 << CELL_BITS) - 1;
+
+    uint64_t words[WORDS];
+
+    uint64_t row(int i) const {
+        return (words[i / ROWS_PER_WORD] >> (ROW_BITS * (i % ROWS_PER_WORD))) & rowMask();
+    }
+    void setRow(int i, uint64_t value) {
+        int shift = ROW_BITS * (i % ROWS_PER_WORD);
+        uint64_t& word = words[i / ROWS_PER_WORD];
+        word = (word & ~(rowMask() << shift)) | (value << shift);
+    }
+    void setCell(int index, int exponent) {
+        uint64_t value = row(index / N);
+        int shift = CELL_BITS * (index % N);
+        value = (value & ~(static_cast<uint64_t>(MAX_EXPONENT) << shift)) |
+                (static_cast<uint64_t>(exponent) << shift);
+        setRow(index / N, value);
+    }
+
+    static uint64_t rowMask() { return (ROW_BITS == 64) ? ~0ULL : (1ULL << ROW_BITS) - 1; }
+    // The lowest bit of every cell of a row
+    static uint64_t cellLowBits() {
+        uint64_t bits = 0;
+        for (int k = 0; k < N; ++k) bits |= 1ULL << (CELL_BITS * k);
+        return bits;
+    }
+
+    bool operator==(const SizedBoard& other) const {
+        for (int w = 0; w < WORDS; ++w) {
+            if (words[w] != other.words[w]) return false;
+        }
+        return true;
+    }
+    bool operator!=(const SizedBoard& other) const { return !(*this == other); }
+};
+
+namespace sized {
+
+// Sets the low bit of every cell of a row that is zero
+template <int N>
+inline uint64_t zeroCells(uint64_t row) {
+    uint64_t any = row;
+    for (int s = 1; s < SizedBoard<N>::CELL_BITS; ++s) any |= row >> s;
+    return ~any & SizedBoard<N>::cellLowBits();
+}
+
+// Slide and merge the N exponents of one line, given in slide order (the
+// first one is the cell the tiles move towards), with the rules of
+// slideAndMerge. Branch-free, as the tiles of the lines that do change make
+// the branches of the usual loop unpredictable.
+template <int N>
+inline void slideLine(const uint32_t* in, uint32_t* out, int& scoreDelta) {
+    SIZED_UNROLL for (int k = 0; k < N; ++k) out[k] = 0;
+    int write = 0;       // Cells written so far
+    uint32_t last = 0;   // Exponent of the last written tile while it can still merge
+    SIZED_UNROLL for (int i = 0; i < N; ++i) {
+        uint32_t exponent = in[i];
+        bool tile = exponent != 0;
+        bool merge = tile & (exponent == last) & (exponent < static_cast<uint32_t>(SizedBoard<N>::MAX_EXPONENT));
+        out[write - merge] = exponent + merge;  // An empty cell writes 0 over a cell that is still 0
+        scoreDelta += merge ? (2 << exponent) : 0;
+        write += tile & !merge;
+        last = merge ? 0 : (tile ? exponent : last);
+    }
+}
+
+} // namespace sized
+
+// Conversion from and to a FlatGrid of the same size. A grid can be packed
+// when every exponent is below MAX_EXPONENT.
+template <int N>
+bool canPackSizedBoard(const FlatGrid& grid) {
+    if (grid.size != N) return false;
+    for (int i = 0; i < N * N; ++i) {
+        if (grid.cells[i] >= SizedBoard<N>::MAX_EXPONENT) return false;
+    }
+    return true;
+}
+
+template <int N>
+SizedBoard<N> packSizedBoard(const FlatGrid& grid) {
+    SizedBoard<N> board = SizedBoard<N>();
+    for (int i = 0; i < N; ++i) {
+        uint64_t row = 0;
+        for (int j = 0; j < N; ++j) row |= static_cast<uint64_t>(grid.cells[i * N + j]) << (SizedBoard<N>::CELL_BITS * j);
+        board.setRow(i, row);
+    }
+    return board;
+}
+
+// Write the N * N exponents to cells (row-major), e.g. for computeEvalTerms
+template <int N>
+void unpackSizedBoard(const SizedBoard<N>& board, uint8_t* cells) {
+    SIZED_UNROLL for (int i = 0; i < N; ++i) {
+        uint64_t row = board.row(i);
+        SIZED_UNROLL for (int j = 0; j < N; ++j) {
+            cells[i * N + j] = static_cast<uint8_t>((row >> (SizedBoard<N>::CELL_BITS * j)) & SizedBoard<N>::MAX_EXPONENT);
+        }
+    }
+}
+
+template <int N>
+void unpackSizedBoard(const SizedBoard<N>& board, FlatGrid& grid) {
+    grid.size = N;
+    unpackSizedBoard(board, grid.cells);
+}
+
+namespace sized {
+
+// One move with the direction known at compile time, so every cell index and
+// shift below is a constant. Lines the move cannot change (no tile next to an
+// empty cell in the direction of the move, no equal neighbours) are found for
+// all cells of a row at once and copied as they are; most lines of the crowded
+// boards of a long game are like that, and so are all lines of a no-op move.
+template <int N, int MOVE>
+SizedBoard<N> move(const SizedBoard<N>& board, int& scoreDelta) {
+    const int bits = SizedBoard<N>::CELL_BITS;
+    const uint64_t cellMask = SizedBoard<N>::MAX_EXPONENT;
+    const uint64_t allButLast = SizedBoard<N>::cellLowBits() >> bits;
+    const bool reversed = (MOVE == 1 || MOVE == 3);
+    uint64_t rows[N];
+    SIZED_UNROLL for (int i = 0; i < N; ++i) rows[i] = board.row(i);
+    uint32_t in[N];
+    uint32_t out[N];
+    SizedBoard<N> result = board;
+
+    if (MOVE >= 2) {
+        SIZED_UNROLL for (int k = 0; k < N; ++k) {
+            uint64_t zero = zeroCells<N>(rows[k]);
+            uint64_t nextZero = zero >> bits;  // At each cell: the cell on its right is empty
+            uint64_t slides = reversed ? (nextZero & ~zero) : (zero & ~nextZero);
+            uint64_t merges = zeroCells<N>(rows[k] ^ (rows[k] >> bits)) & ~zero;
+            if (((slides | merges) & allButLast) == 0) continue;
+
+            // Row k, from its left cell for Left and from its right cell for Right
+            SIZED_UNROLL for (int m = 0; m < N; ++m) {
+                in[m] = static_cast<uint32_t>((rows[k] >> (bits * (reversed ? N - 1 - m : m))) & cellMask);
+            }
+            slideLine<N>(in, out, scoreDelta);
+            uint64_t row = 0;
+            SIZED_UNROLL for (int m = 0; m < N; ++m) {
+                row |= static_cast<uint64_t>(out[m]) << (bits * (reversed ? N - 1 - m : m));
+            }
+            result.setRow(k, row);
+        }
+        return result;
+    }
+
+    // Columns that change: one lane per column, comparing each row with the next
+    uint64_t changed = 0;
+    SIZED_UNROLL for (int i = 0; i + 1 < N; ++i) {
+        uint64_t zero = zeroCells<N>(rows[i]);
+        uint64_t nextZero = zeroCells<N>(rows[i + 1]);
+        changed |= reversed ? (nextZero & ~zero) : (zero & ~nextZero);
+        changed |= zeroCells<N>(rows[i] ^ rows[i + 1]) & ~zero;
+    }
+    if (changed == 0) return result;
+
+    uint64_t results[N];
+    SIZED_UNROLL for (int i = 0; i < N; ++i) results[i] = rows[i] & ~(changed * cellMask);
+    SIZED_UNROLL for (int k = 0; k < N; ++k) {
+        if (((changed >> (bits * k)) & 1) == 0) continue;
+        // Column k, from its top cell for Up and from its bottom cell for Down
+        SIZED_UNROLL for (int m = 0; m < N; ++m) {
+            in[m] = static_cast<uint32_t>((rows[reversed ? N - 1 - m : m] >> (bits * k)) & cellMask);
+        }
+        slideLine<N>(in, out, scoreDelta);
+        SIZED_UNROLL for (int m = 0; m < N; ++m) {
+            results[reversed ? N - 1 - m : m] |= static_cast<uint64_t>(out[m]) << (bits * k);
+        }
+    }
+    SIZED_UNROLL for (int i = 0; i < N; ++i) result.setRow(i, results[i]);
+    return result;
+}
+
+} // namespace sized
+
+// Move kernels, from the slowest to the fastest. Both give exactly the same
+// boards and scores; the AVX2 kernel exists for 5x5 and 6x6.
+enum SizedMoveKernel {
+    SIZED_MOVE_SCALAR,  // sized::move, one line after the other
+    SIZED_MOVE_AVX2
+};
+
+bool sizedMoveKernelSupported(SizedMoveKernel kernel);
+const char* sizedMoveKernelName(SizedMoveKernel kernel);
+SizedMoveKernel activeSizedMoveKernel();  // The best supported kernel, picked at startup
+void setSizedMoveKernel(SizedMoveKernel kernel);  // Ignored when the CPU does not support the kernel
+
+namespace sized {
+
+// The AVX2 kernel (sizedboard.cpp). Returns false, leaving result alone, when
+// the CPU does not support AVX2 or there is no kernel for the size.
+bool avx2Move(const SizedBoard<5>& board, int move, int& scoreDelta, SizedBoard<5>& result);
+bool avx2Move(const SizedBoard<6>& board, int move, int& scoreDelta, SizedBoard<6>& result);
+template <int N>
+bool avx2Move(const SizedBoard<N>&, int, int&, SizedBoard<N>&) { return false; }
+
+} // namespace sized
+
+// One of the four moves (0 = Up, 1 = Down, 2 = Left, 3 = Right). Returns the
+// board after the move (unchanged when the move is not possible) and adds the
+// merged tile values to scoreDelta.
+template <int N>
+SizedBoard<N> sizedBoardMove(const SizedBoard<N>& board, int move, int& scoreDelta, SizedMoveKernel kernel) {
+    SizedBoard<N> result;
+    if (kernel == SIZED_MOVE_AVX2 && sized::avx2Move(board, move, scoreDelta, result)) return result;
+    switch (move) {
+        case 0: return sized::move<N, 0>(board, scoreDelta);
+        case 1: return sized::move<N, 1>(board, scoreDelta);
+        case 2: return sized::move<N, 2>(board, scoreDelta);
+        default: return sized::move<N, 3>(board, scoreDelta);
+    }
+}
+
+template <int N>
+SizedBoard<N> sizedBoardMove(const SizedBoard<N>& board, int move, int& scoreDelta) {
+    return sizedBoardMove(board, move, scoreDelta, activeSizedMoveKernel());
+}
+
+// Bit k is set when cell k (row-major) is empty
+template <int N>
+uint64_t sizedEmptyCellMask(const SizedBoard<N>& board) {
+    uint64_t mask = 0;
+    for (int i = 0; i < N; ++i) {
+        for (uint64_t zeros = sized::zeroCells<N>(board.row(i)); zeros != 0; zeros &= zeros - 1) {
+            mask |= 1ULL << (i * N + __builtin_ctzll(zeros) / SizedBoard<N>::CELL_BITS);
+        }
+    }
+    return mask;
+}
+
+// No empty cell and no equal neighbours (a zero cell in the XOR of a row with
+// itself shifted by one cell, or with the next row)
+template <int N>
+bool sizedBoardIsGameOver(const SizedBoard<N>& board) {
+    const uint64_t allButLast = SizedBoard<N>::cellLowBits() >> SizedBoard<N>::CELL_BITS;
+    for (int i = 0; i < N; ++i) {
+        uint64_t row = board.row(i);
+        if (sized::zeroCells<N>(row) != 0) return false;
+        if (sized::zeroCells<N>(row ^ (row >> SizedBoard<N>::CELL_BITS)) & allButLast) return false;
+        if (i + 1 < N && sized::zeroCells<N>(row ^ board.row(i + 1)) != 0) return false;
+    }
+    return true;
+}
+
+// Same spawn as addRandomTile (same random draws, same cell and tile).
+// Returns the cell index or -1 when the board is full.
+template <int N>
+int spawnSizedBoardTile(SizedBoard<N>& board, GameRng& rng) {
+    uint64_t empty = sizedEmptyCellMask(board);
+    if (empty == 0) return -1;
+    int target = static_cast<int>(rng.below(__builtin_popcountll(empty)));
+    int exponent = (rng.below(10) < 9) ? 1 : 2;
+    int cell = selectNthSetBit(empty, target);
+    board.setCell(cell, exponent);
+    return cell;
+}
+
+#endif // SIZEDBOARD_HPP
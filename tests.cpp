@@ -1,7 +1,28 @@
 #include <iostream>
 #include <vector>
 #include "modele.hpp" // Include your original game logic header
-#include "menu.hpp"   // For saveBestScore/loadBestScore
+#include "menu.hpp"   // Menu declarations
+#include "bitboard.hpp" // Packed 4x4 board
+#include "ai.hpp"     // evaluateGrid/evaluateBoard
+#include "transposition.hpp" // Search cache
+#include "simdeval.hpp"  // Evaluation kernels
+#include "gamelog.hpp"  // Binary game records
+#include "ntuple.hpp"   // Learned evaluation
+#include "batchmove.hpp" // Moves on many boards at once
+#include "sizedboard.hpp" // Packed boards of every menu size
+#include "ponder.hpp"     // Background hint search
+#include "history.hpp"    // Undo/redo
+#include "checkpoint.hpp" // Saved games
+#include "resultstore.hpp" // Shared game results
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <atomic>
 
 // Function to display a grid.
 // Parameter: 
@@ -54,6 +75,7 @@ void testDisplayGrid() {
 
 // Tests adding a random tile to an empty grid.
 // Success criterion: The grid contains exactly one non-zero cell after the addition.
+// A 10x10 grid, too large for the empty-cell bit mask, fills one cell per addition.
 void testAddRandomTile() {
     std::cout << "Running testAddRandomTile...\n";
     std::vector<std::vector<int>> grid(4, std::vector<int>(4, 0));
@@ -66,7 +88,16 @@ void testAddRandomTile() {
         }
     }
 
-    if (nonZeroCount == 1) {
+    bool largeOk = true;
+    GameRng rng(5);
+    std::vector<std::vector<int>> large(10, std::vector<int>(10, 0));
+    for (int spawn = 0; spawn < 100; ++spawn) {
+        int cell = addRandomTile(large, rng);
+        largeOk = largeOk && cell >= 0 && cell < 100 && large[cell / 10][cell % 10] != 0;
+    }
+    largeOk = largeOk && addRandomTile(large, rng) == -1;  // Full once every cell was filled
+
+    if (nonZeroCount == 1 && largeOk) {
         std::cout << "testAddRandomTile passed\n";
     } else {
         std::cout << "testAddRandomTile failed\n";
@@ -255,6 +286,1198 @@ void testMoveDown() {
     }
 }
 
+// Builds a random 4x4 grid with tiles between 2 and 2048 (about a third of the cells empty).
+std::vector<std::vector<int>> randomGrid() {
+    std::vector<std::vector<int>> grid(4, std::vector<int>(4, 0));
+    for (auto& row : grid) {
+        for (int& cell : row) {
+            if (std::rand() % 3 != 0) cell = 1 << (1 + std::rand() % 11);
+        }
+    }
+    return grid;
+}
+
+// Tests that the packed board moves give the same grid and score as slideAndMerge on each line.
+// Success criterion: all four directions agree on 1000 random grids.
+void testBoardMovesMatchSlideAndMerge() {
+    std::cout << "Running testBoardMovesMatchSlideAndMerge...\n";
+    std::srand(42);
+    bool ok = true;
+    for (int t = 0; t < 1000 && ok; ++t) {
+        std::vector<std::vector<int>> grid = randomGrid();
+        for (int move = 0; move < 4 && ok; ++move) {
+            // Reference: slide each row or column with slideAndMerge
+            std::vector<std::vector<int>> expected = grid;
+            int expectedScore = 0;
+            for (int k = 0; k < 4; ++k) {
+                std::vector<int> line(4);
+                for (int m = 0; m < 4; ++m) {
+                    int idx = (move == 1 || move == 3) ? 3 - m : m; // Down and Right start from the far end
+                    line[m] = (move < 2) ? grid[idx][k] : grid[k][idx];
+                }
+                bool lineMoved = false;
+                slideAndMerge(line, lineMoved, expectedScore);
+                for (int m = 0; m < 4; ++m) {
+                    int idx = (move == 1 || move == 3) ? 3 - m : m;
+                    if (move < 2) expected[idx][k] = line[m]; else expected[k][idx] = line[m];
+                }
+            }
+
+            std::vector<std::vector<int>> actual = grid;
+            int score = 0;
+            bool moved = false;
+            switch (move) {
+                case 0: moveUp(actual, moved, score); break;
+                case 1: moveDown(actual, moved, score); break;
+                case 2: moveLeft(actual, moved, score); break;
+                case 3: moveRight(actual, moved, score); break;
+            }
+            ok = (actual == expected && score == expectedScore && moved == (expected != grid));
+        }
+    }
+    std::cout << (ok ? "testBoardMovesMatchSlideAndMerge passed\n" : "testBoardMovesMatchSlideAndMerge failed\n");
+}
+
+// Tests packing, transposition, game-over detection and evaluation on the packed board.
+void testBoardHelpers() {
+    std::cout << "Running testBoardHelpers...\n";
+    std::srand(7);
+    bool ok = true;
+    for (int t = 0; t < 1000 && ok; ++t) {
+        std::vector<std::vector<int>> grid = randomGrid();
+        Board board = packGrid(grid);
+        std::vector<std::vector<int>> unpacked(4, std::vector<int>(4, 0));
+        unpackBoard(board, unpacked);
+        ok = (unpacked == grid) && (evaluateBoard(board) == evaluateGrid(grid));
+        for (int i = 0; i < 4 && ok; ++i) {
+            for (int j = 0; j < 4 && ok; ++j) {
+                ok = (getBoardCell(transposeBoard(board), i, j) == getBoardCell(board, j, i));
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> over = {
+        {2, 4, 8, 16},
+        {32, 64, 128, 256},
+        {512, 1024, 2048, 4096},
+        {2, 4, 8, 16}
+    };
+    ok = ok && boardIsGameOver(packGrid(over));
+    over[3][3] = 8; // Creates a horizontal merge with the 8 on its left
+    ok = ok && !boardIsGameOver(packGrid(over));
+    std::cout << (ok ? "testBoardHelpers passed\n" : "testBoardHelpers failed\n");
+}
+
+// Tests the expectimax mode of getBestMove.
+// Success cases:
+// - Returns "None" when the game is over.
+// - Returns a move that changes the grid on random 4x4 and 5x5 grids.
+void testExpectimaxMove() {
+    std::cout << "Running testExpectimaxMove...\n";
+    SearchOptions options;
+    options.mode = SEARCH_EXPECTIMAX;
+    options.depth = 2;
+
+    std::vector<std::vector<int>> over = {
+        {2, 4, 8, 16},
+        {32, 64, 128, 256},
+        {512, 1024, 2048, 4096},
+        {2, 4, 8, 16}
+    };
+    bool ok = (getBestMove(over, 0, options) == "None");
+
+    std::srand(11);
+    for (int size = 4; size <= 5 && ok; ++size) {
+        for (int t = 0; t < 20 && ok; ++t) {
+            std::vector<std::vector<int>> grid(size, std::vector<int>(size, 0));
+            for (auto& row : grid) {
+                for (int& cell : row) {
+                    if (std::rand() % 3 != 0) cell = 1 << (1 + std::rand() % 8);
+                }
+            }
+            std::string move = getBestMove(grid, 0, options);
+            bool moved = false;
+            int score = 0;
+            if (move == "Up") moveUp(grid, moved, score);
+            else if (move == "Down") moveDown(grid, moved, score);
+            else if (move == "Left") moveLeft(grid, moved, score);
+            else if (move == "Right") moveRight(grid, moved, score);
+            ok = moved;
+        }
+    }
+    std::cout << (ok ? "testExpectimaxMove passed\n" : "testExpectimaxMove failed\n");
+}
+
+// Tests storing and probing the transposition table.
+// Success cases:
+// - A stored result is found again with the same key, depth and bucket.
+// - Another depth or bucket is a miss, and the statistics count probes and hits.
+void testTranspositionTable() {
+    std::cout << "Running testTranspositionTable...\n";
+    TranspositionTable table(1);
+    table.store(0x1234, 3, 2, 1500.5f, 2);
+
+    float value = 0.0f;
+    int bestMove = -1;
+    bool ok = table.probe(0x1234, 3, 2, value, bestMove) && value == 1500.5f && bestMove == 2;
+    ok = ok && !table.probe(0x1234, 2, 2, value, bestMove);
+    ok = ok && !table.probe(0x1234, 3, 1, value, bestMove);
+    ok = ok && !table.probe(0x4321, 3, 2, value, bestMove);
+    ok = ok && table.probeCount() == 4 && table.hitCount() == 1;
+    ok = ok && table.memoryBytes() == 1024 * 1024;
+
+    int bucket = 0;
+    ok = ok && quantizeProbability(1.0, bucket) == 1.0 && bucket == 0;
+    ok = ok && quantizeProbability(0.3, bucket) == 0.25 && bucket == 2;
+    std::cout << (ok ? "testTranspositionTable passed\n" : "testTranspositionTable failed\n");
+}
+
+// Tests the file-backed transposition table.
+// Success criterion: a value stored by one table is found by another table
+// mapping the same file with the same version, but not with another version,
+// and reopening with the old version after that finds an empty table. A
+// search with another cutoff misses every value stored in the file.
+void testPersistentTranspositionTable() {
+    std::cout << "Running testPersistentTranspositionTable...\n";
+    const std::string path = "test_ttcache.bin";
+    std::remove(path.c_str());
+    float value = 0.0f;
+    int bestMove = -1;
+
+    TranspositionTable writer;
+    bool ok = writer.mapFile(path, 1, 11) && writer.fileBacked() && writer.warmEntries() == 0;
+    writer.store(0x1234, 3, 2, 1500.5f, 2);
+
+    TranspositionTable sameVersion;
+    ok = ok && sameVersion.mapFile(path, 4, 11) && sameVersion.memoryBytes() == 1024 * 1024;  // Keeps the file size
+    ok = ok && sameVersion.warmEntries() == 1;
+    ok = ok && sameVersion.probe(0x1234, 3, 2, value, bestMove) && value == 1500.5f && bestMove == 2;
+
+    writer.setVersion(12);  // Other weights: entries of version 11 are no longer accepted
+    ok = ok && !writer.probe(0x1234, 3, 2, value, bestMove);
+    writer.store(0x1234, 3, 2, 700.0f, 1);
+    ok = ok && !sameVersion.probe(0x1234, 3, 2, value, bestMove);  // Written with version 12
+    ok = ok && writer.probe(0x1234, 3, 2, value, bestMove) && value == 700.0f;
+
+    TranspositionTable oldVersion;
+    ok = ok && oldVersion.mapFile(path, 1, 11) && oldVersion.warmEntries() == 0;  // Reset for version 11
+    ok = ok && !writer.probe(0x1234, 3, 2, value, bestMove);
+
+    // Searches with another cutoff miss the values stored in the same file:
+    // they only hit their own transpositions, as on an empty file
+    std::srand(14);
+    std::vector<std::vector<int>> grid = randomGrid();
+    SearchOptions fine;
+    fine.mode = SEARCH_EXPECTIMAX;
+    fine.depth = 3;
+    fine.probCutoff = 0.0001;
+    SearchOptions coarse = fine;
+    coarse.probCutoff = 0.01;
+    std::remove(path.c_str());
+    ok = ok && openEvaluationCache(path, 4);
+    getBestMove(grid, 0, coarse);
+    uint64_t coldHits = lastSearchStats().cacheHits;
+    std::remove(path.c_str());
+    ok = ok && openEvaluationCache(path, 4);
+    getBestMove(grid, 0, fine);
+    uint64_t fineNodes = lastSearchStats().totalNodes();
+    ok = ok && openEvaluationCache(path, 4) && sharedTranspositionTable().warmEntries() > 0;
+    getBestMove(grid, 0, fine);  // The same cutoff reuses the stored values
+    ok = ok && lastSearchStats().totalNodes() < fineNodes / 2;
+    getBestMove(grid, 0, coarse);
+    ok = ok && lastSearchStats().cacheHits == coldHits;
+    configureTranspositionTable(0);
+    std::remove(path.c_str());
+    std::cout << (ok ? "testPersistentTranspositionTable passed\n" : "testPersistentTranspositionTable failed\n");
+}
+
+// Tests that the parallel expectimax search picks the same move as the single-threaded one.
+// Success criterion: same move on 20 random 4x4 grids with 1 and 4 threads, and
+// on each grid again while two threads search at once with 2 and 3 threads
+// (two pools of different sizes used at the same time, each built once).
+void testParallelSearchDeterministic() {
+    std::cout << "Running testParallelSearchDeterministic...\n";
+    SearchOptions serial;
+    serial.mode = SEARCH_EXPECTIMAX;
+    serial.depth = 3;
+    SearchOptions parallel = serial;
+    parallel.threads = 4;
+
+    std::srand(5);
+    bool ok = true;
+    std::vector<std::vector<std::vector<int>>> grids;
+    std::vector<std::string> moves;
+    for (int t = 0; t < 20 && ok; ++t) {
+        grids.push_back(randomGrid());
+        moves.push_back(getBestMove(grids.back(), 0, serial));
+        ok = (moves.back() == getBestMove(grids.back(), 0, parallel));
+    }
+
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> searchers;
+    for (int threads = 2; threads <= 3; ++threads) {
+        searchers.emplace_back([&, threads]() {
+            SearchOptions options = serial;
+            options.threads = threads;
+            for (size_t t = 0; t < grids.size(); ++t) {
+                if (getBestMove(grids[t], 0, options) != moves[t]) ++mismatches;
+            }
+        });
+    }
+    for (auto& searcher : searchers) {
+        searcher.join();
+    }
+    ok = ok && mismatches == 0;
+    std::cout << (ok ? "testParallelSearchDeterministic passed\n" : "testParallelSearchDeterministic failed\n");
+}
+
+// Tests the search statistics and the latency histogram.
+// Success criteria: the lookahead counts one root, one evaluation per third-ply
+// position and four moves tried per expanded position; an expectimax search without cache
+// counts the same nodes with 1 and 4 threads, also when two callers search at
+// once on the same pool (and run each other's tasks while they wait);
+// histogram percentiles are within one bucket (9%) of the exact values.
+void testSearchStats() {
+    std::cout << "Running testSearchStats...\n";
+    std::srand(11);
+    bool ok = true;
+    for (int t = 0; t < 10 && ok; ++t) {
+        std::vector<std::vector<int>> grid = randomGrid();
+        getBestMove(grid, 0);
+        SearchStats lookahead = lastSearchStats();
+        // Every move tried from the root and from plies 1 and 2 is either a no-op or a node
+        ok = lookahead.depth == 3 && lookahead.nodes[0] == 1 && lookahead.evaluations == lookahead.nodes[3] &&
+             lookahead.noopMoves + lookahead.nodes[1] + lookahead.nodes[2] + lookahead.nodes[3] ==
+                 4 * (1 + lookahead.nodes[1] + lookahead.nodes[2]);
+        ok = ok && lookahead.milliseconds >= 0.0;
+
+        SearchOptions options;
+        options.mode = SEARCH_EXPECTIMAX;
+        options.depth = 2;
+        options.useTranspositionTable = false;
+        getBestMove(grid, 0, options);
+        SearchStats serial = lastSearchStats();
+        options.threads = 4;
+        getBestMove(grid, 0, options);
+        SearchStats parallel = lastSearchStats();
+        ok = ok && serial.depth == 2 && serial.nodes[0] == 1 && serial.nodes[1] > 0 && serial.cacheProbes == 0;
+        ok = ok && serial.totalNodes() == parallel.totalNodes() && serial.evaluations == parallel.evaluations &&
+             serial.noopMoves == parallel.noopMoves && serial.cutoffs == parallel.cutoffs;
+    }
+
+    std::vector<std::vector<int>> grid = randomGrid();
+    SearchOptions options;
+    options.mode = SEARCH_EXPECTIMAX;
+    options.depth = 3;
+    options.useTranspositionTable = false;
+    getBestMove(grid, 0, options);
+    const SearchStats serial = lastSearchStats();
+    options.threads = 4;
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> callers;
+    for (int c = 0; c < 2; ++c) {
+        callers.emplace_back([&]() {
+            for (int run = 0; run < 20; ++run) {
+                getBestMove(grid, 0, options);
+                const SearchStats& parallel = lastSearchStats();  // Stats of this thread's own search
+                if (parallel.totalNodes() != serial.totalNodes() || parallel.evaluations != serial.evaluations ||
+                    parallel.noopMoves != serial.noopMoves || parallel.cutoffs != serial.cutoffs) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    ok = ok && mismatches == 0;
+
+    LatencyHistogram histogram;
+    for (int ms = 1; ms <= 100; ++ms) histogram.record(ms);
+    ok = ok && histogram.count() == 100 && histogram.max() == 100.0 && histogram.mean() == 50.5;
+    ok = ok && histogram.percentile(0.50) >= 50.0 && histogram.percentile(0.50) <= 50.0 * 1.091;
+    ok = ok && histogram.percentile(0.99) >= 99.0 && histogram.percentile(0.99) <= 100.0;
+    std::cout << (ok ? "testSearchStats passed\n" : "testSearchStats failed\n");
+}
+
+// Tests the time-limited getBestMove.
+// Success cases:
+// - With a generous budget it finishes every iteration and agrees with the fixed-depth search.
+// - With a 20 ms budget and a very deep limit it still returns a move within 100 ms.
+void testTimedSearch() {
+    std::cout << "Running testTimedSearch...\n";
+    SearchOptions options;
+    options.mode = SEARCH_EXPECTIMAX;
+    options.depth = 2;
+
+    std::srand(9);
+    bool ok = true;
+    for (int t = 0; t < 10 && ok; ++t) {
+        std::vector<std::vector<int>> grid = randomGrid();
+        ok = (getBestMove(grid, 0, options, 10000) == getBestMove(grid, 0, options));
+    }
+
+    options.depth = 20;
+    std::vector<std::vector<int>> grid(6, std::vector<int>(6, 0));
+    grid[0][0] = 2;
+    grid[5][5] = 4;
+    auto start = std::chrono::steady_clock::now();
+    std::string move = getBestMove(grid, 0, options, 20);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    ok = ok && move != "None" && elapsed.count() < 100;
+    std::cout << (ok ? "testTimedSearch passed\n" : "testTimedSearch failed\n");
+}
+
+// Checks the Monte Carlo rollout search.
+// Success criterion: it picks the only legal move, gives the same move with 1
+// and 4 threads, runs exactly the requested rollouts per legal move, and a
+// time-limited search on long 6x6 games returns in time.
+void testRolloutSearch() {
+    std::cout << "Running testRolloutSearch...\n";
+    SearchOptions options;
+    options.mode = SEARCH_ROLLOUT;
+    options.rollouts = 100;
+
+    // The first column is empty and no tiles can merge: only Left moves anything
+    std::vector<std::vector<int>> grid = {{0, 2, 4, 8}, {0, 4, 8, 16}, {0, 8, 16, 32}, {0, 16, 32, 64}};
+    bool ok = getBestMove(grid, 0, options) == "Left" && lastSearchStats().evaluations == 100;
+
+    std::srand(19);
+    for (int t = 0; t < 8 && ok; ++t) {
+        std::vector<std::vector<int>> board = randomGrid();
+        options.threads = 1;
+        std::string single = getBestMove(board, 0, options);
+        options.threads = 4;
+        ok = single != "None" && getBestMove(board, 0, options) == single;
+    }
+
+    options.threads = 2;
+    std::vector<std::vector<int>> empty(6, std::vector<int>(6, 0));
+    empty[0][0] = 2;
+    empty[5][5] = 4;
+    auto start = std::chrono::steady_clock::now();
+    std::string move = getBestMove(empty, 0, options, 30);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    ok = ok && move != "None" && elapsed.count() < 200 && lastSearchStats().evaluations >= 4;
+    std::cout << (ok ? "testRolloutSearch passed\n" : "testRolloutSearch failed\n");
+}
+
+// Waits until the ponderer has searched its board to the full depth
+bool waitForPonderer(HintPonderer& ponderer, int timeoutMs) {
+    auto start = std::chrono::steady_clock::now();
+    while (!ponderer.finished()) {
+        if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(timeoutMs)) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// Checks the background hint search.
+// Success criterion: a board searched to the full depth gives the move of
+// getBestMove, a deep search has a move ready after a few milliseconds and is
+// cancelled quickly by the next board, and a game-over board gives "None".
+void testHintPonderer() {
+    std::cout << "Running testHintPonderer...\n";
+    SearchOptions options;
+    options.mode = SEARCH_EXPECTIMAX;
+    options.depth = 2;
+    options.threads = 2;
+
+    std::srand(21);
+    bool ok = true;
+    {
+        HintPonderer ponderer(options);
+        for (int t = 0; t < 5 && ok; ++t) {
+            std::vector<std::vector<int>> grid = randomGrid();
+            ponderer.ponder(grid);
+            int depth = 0;
+            ok = waitForPonderer(ponderer, 10000) && ponderer.bestMove(0, depth) == getBestMove(grid, 0, options) &&
+                 depth == 2;
+        }
+    }
+
+    options.depth = 20;
+    HintPonderer ponderer(options);
+    std::vector<std::vector<int>> grid(6, std::vector<int>(6, 0));
+    grid[0][0] = 2;
+    grid[5][5] = 4;
+    ponderer.ponder(grid);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    int depth = 0;
+    ok = ok && ponderer.bestMove(1000, depth) != "None" && depth >= 1 && !ponderer.finished();
+
+    std::vector<std::vector<int>> stuck = {{2, 4, 2, 4}, {4, 2, 4, 2}, {2, 4, 2, 4}, {4, 2, 4, 2}};
+    auto start = std::chrono::steady_clock::now();
+    ponderer.ponder(stuck);
+    ok = ok && waitForPonderer(ponderer, 1000);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    ok = ok && elapsed.count() < 200 && ponderer.bestMove(0, depth) == "None" && depth == 0;
+    std::cout << (ok ? "testHintPonderer passed\n" : "testHintPonderer failed\n");
+}
+
+// Checks the wait of an 'H' hint.
+// Success criterion: the full wait outside of timed mode and with plenty of
+// time left, a tenth of the remaining time near the end of a timed game, and
+// never less than 10 ms, even once the time is up.
+void testHintWaitBudget() {
+    std::cout << "Running testHintWaitBudget...\n";
+    bool ok = hintWaitBudget(250, false, 0) == 250 && hintWaitBudget(250, true, 120000) == 250 &&
+              hintWaitBudget(250, true, 2500) == 250 && hintWaitBudget(250, true, 1000) == 100 &&
+              hintWaitBudget(250, true, 50) == 10 && hintWaitBudget(250, true, -300) == 10;
+    std::cout << (ok ? "testHintWaitBudget passed\n" : "testHintWaitBudget failed\n");
+}
+
+// Checks the FlatGrid moves and evaluation against the 2D grid code on 5x5 and 6x6 grids.
+// Success criterion: every move gives the same tiles, score and moved flag as slideAndMerge
+// on the 2D grid, and evaluateGrid gives the same value on both grid types.
+void testFlatGridMatchesGrid() {
+    std::cout << "Running testFlatGridMatchesGrid...\n";
+    std::srand(7);
+    bool ok = true;
+    for (int t = 0; t < 500 && ok; ++t) {
+        int size = 5 + t % 2;
+        std::vector<std::vector<int>> grid(size, std::vector<int>(size, 0));
+        for (auto& row : grid) {
+            for (int& cell : row) {
+                cell = (std::rand() % 3 == 0) ? 0 : (1 << (1 + std::rand() % 11));
+            }
+        }
+        FlatGrid flat = flattenGrid(grid);
+        ok = (evaluateGrid(flat) == evaluateGrid(grid));
+
+        for (int move = 0; move < 4 && ok; ++move) {
+            // Reference: slide each row or column of the 2D grid with slideAndMerge
+            std::vector<std::vector<int>> expected = grid;
+            int expectedScore = 0;
+            for (int k = 0; k < size; ++k) {
+                std::vector<int> line(size);
+                for (int m = 0; m < size; ++m) {
+                    int idx = (move == 1 || move == 3) ? size - 1 - m : m; // Down and Right start from the far end
+                    line[m] = (move < 2) ? grid[idx][k] : grid[k][idx];
+                }
+                bool lineMoved = false;
+                slideAndMerge(line, lineMoved, expectedScore);
+                for (int m = 0; m < size; ++m) {
+                    int idx = (move == 1 || move == 3) ? size - 1 - m : m;
+                    if (move < 2) expected[idx][k] = line[m]; else expected[k][idx] = line[m];
+                }
+            }
+
+            FlatGrid actual = flat;
+            int score = 0;
+            bool moved = false;
+            switch (move) {
+                case 0: moveUp(actual, moved, score); break;
+                case 1: moveDown(actual, moved, score); break;
+                case 2: moveLeft(actual, moved, score); break;
+                case 3: moveRight(actual, moved, score); break;
+            }
+            std::vector<std::vector<int>> result(size, std::vector<int>(size, 0));
+            unflattenGrid(actual, result);
+            ok = (result == expected && score == expectedScore && moved == (expected != grid));
+        }
+    }
+    std::cout << (ok ? "testFlatGridMatchesGrid passed\n" : "testFlatGridMatchesGrid failed\n");
+}
+
+// Checks that every evaluation kernel the CPU supports gives the scalar result.
+// Success criterion: identical terms on random 4x4, 5x5 and 6x6 grids, including
+// full grids with large tiles.
+void testEvalKernelsMatchScalar() {
+    std::cout << "Running testEvalKernelsMatchScalar...\n";
+    std::srand(11);
+    bool ok = true;
+    for (int t = 0; t < 3000 && ok; ++t) {
+        int size = 4 + t % 3;
+        uint8_t cells[EVAL_PADDED_CELLS] = {0};
+        for (int i = 0; i < size * size; ++i) {
+            cells[i] = (t % 5 != 0 && std::rand() % 3 == 0) ? 0 : static_cast<uint8_t>(1 + std::rand() % 20);
+        }
+        EvalTerms expected = computeEvalTerms(cells, size, EVAL_KERNEL_SCALAR);
+        for (int kernel = EVAL_KERNEL_SSE41; kernel <= EVAL_KERNEL_AVX2 && ok; ++kernel) {
+            if (!evalKernelSupported(static_cast<EvalKernel>(kernel))) continue;
+            EvalTerms actual = computeEvalTerms(cells, size, static_cast<EvalKernel>(kernel));
+            ok = (actual.sum == expected.sum && actual.empty == expected.empty &&
+                  actual.monotonicity == expected.monotonicity &&
+                  actual.mergePotential == expected.mergePotential);
+        }
+    }
+    // The board and flat grid evaluations match the original 2D version
+    for (int t = 0; t < 500 && ok; ++t) {
+        std::vector<std::vector<int>> grid = randomGrid();
+        ok = (evaluateBoard(packGrid(grid)) == evaluateGrid(grid) &&
+              evaluateGrid(flattenGrid(grid)) == evaluateGrid(grid));
+    }
+    std::cout << (ok ? "testEvalKernelsMatchScalar passed\n" : "testEvalKernelsMatchScalar failed\n");
+}
+
+// Checks the table-driven board evaluation against the SIMD backend and the 2D grid,
+// with the default weights and with other weights.
+// Success criterion: all three give the same value on random 4x4 grids.
+void testEvalTable() {
+    std::cout << "Running testEvalTable...\n";
+    std::srand(13);
+    bool ok = true;
+    EvalWeights weights;
+    for (int pass = 0; pass < 2 && ok; ++pass) {
+        if (pass == 1) {
+            weights.tileSum = 2;
+            weights.empty = 170;
+            weights.monotonicity = 35;
+            weights.mergePotential = 120;
+            setEvalWeights(weights);
+        }
+        for (int t = 0; t < 1000 && ok; ++t) {
+            std::vector<std::vector<int>> grid = randomGrid();
+            Board board = packGrid(grid);
+            setEvalBackend(EVAL_BACKEND_TABLE);
+            int64_t table = evaluateBoard(board);
+            setEvalBackend(EVAL_BACKEND_SIMD);
+            int64_t simd = evaluateBoard(board);
+            ok = (table == simd && table == evaluateGrid(grid));
+        }
+    }
+    setEvalWeights(EvalWeights());
+    setEvalBackend(EVAL_BACKEND_TABLE);
+    std::cout << (ok ? "testEvalTable passed\n" : "testEvalTable failed\n");
+}
+
+// Checks the per-game tile generator: the same seed gives the same spawns on
+// 2D and flat grids, and every empty cell can be chosen.
+// Success criterion: identical grids for identical seeds, different grids for
+// different seeds, and all 36 cells of an empty 6x6 grid hit over many spawns.
+void testGameRng() {
+    std::cout << "Running testGameRng...\n";
+    bool ok = true;
+    for (int size = 4; size <= 6 && ok; ++size) {
+        GameRng first(gameSeed(99, size)), second(gameSeed(99, size)), other(gameSeed(100, size));
+        std::vector<std::vector<int>> grid(size, std::vector<int>(size, 0));
+        std::vector<std::vector<int>> otherGrid = grid;
+        FlatGrid flat = makeFlatGrid(size);
+        for (int spawn = 0; spawn < size * size; ++spawn) {
+            addRandomTile(grid, first);
+            addRandomTile(flat, second);
+            addRandomTile(otherGrid, other);
+            std::vector<std::vector<int>> flatAsGrid(size, std::vector<int>(size, 0));
+            unflattenGrid(flat, flatAsGrid);
+            ok = ok && (flatAsGrid == grid);
+            if (spawn == 3) ok = ok && (otherGrid != grid);  // Other seeds give other games
+        }
+        addRandomTile(grid, first);  // A full grid is left unchanged
+        ok = ok && (emptyCellMask(flattenGrid(grid)) == 0);
+    }
+
+    // Uniform choice among the empty cells
+    GameRng rng(7);
+    bool hit[36] = {false};
+    for (int t = 0; t < 5000; ++t) {
+        FlatGrid flat = makeFlatGrid(6);
+        addRandomTile(flat, rng);
+        hit[selectNthSetBit(~emptyCellMask(flat) & ((1ULL << 36) - 1), 0)] = true;
+    }
+    for (int i = 0; i < 36; ++i) ok = ok && hit[i];
+    std::cout << (ok ? "testGameRng passed\n" : "testGameRng failed\n");
+}
+
+// Checks the weights files read at startup and written by the tuner.
+// Success criteria: written weights read back unchanged, names left out keep
+// their value, and unknown names, negative values or a missing file are refused
+// without touching the weights. With the largest accepted weights, full 4x4 and
+// 6x6 boards of large tiles evaluate to the exact 64-bit value on every path.
+void testEvalWeightsFile() {
+    std::cout << "Running testEvalWeightsFile...\n";
+    const std::string path = "test_weights.txt";
+    EvalWeights written;
+    written.tileSum = 3;
+    written.empty = 4100;
+    written.monotonicity = 7;
+    written.mergePotential = 950;
+    EvalWeights read;
+    bool ok = writeEvalWeights(path, written) && readEvalWeights(path, read);
+    ok = ok && read.tileSum == 3 && read.empty == 4100 && read.monotonicity == 7 && read.mergePotential == 950;
+
+    std::ofstream(path.c_str()) << "# partial\nempty 300  # comment\n\n";
+    EvalWeights partial;
+    ok = ok && readEvalWeights(path, partial) && partial.empty == 300 && partial.tileSum == 1 &&
+         partial.monotonicity == 50 && partial.mergePotential == 100;
+
+    const char* invalid[] = {"speed 5\n", "empty -1\n", "empty 5 6\n", "empty\n", "empty abc\n"};
+    for (const char* text : invalid) {
+        std::ofstream(path.c_str()) << text;
+        EvalWeights untouched;
+        ok = ok && !readEvalWeights(path, untouched) && untouched.empty == 200;
+    }
+
+    std::ofstream(path.c_str()) << "tileSum 1000000\nempty 1000000\nmonotonicity 1000000\nmergePotential 1000000\n";
+    EvalWeights largest;
+    ok = ok && readEvalWeights(path, largest) && largest.tileSum == 1000000;
+    setEvalWeights(largest);
+    // Every cell holds the same tile: no empty cell, every neighbour pair ordered and equal
+    std::vector<std::vector<int>> four(4, std::vector<int>(4, 32768));
+    const int64_t fourValue = (16LL * 32768 + 24 + 24) * 1000000;
+    ok = ok && evaluateGrid(four) == fourValue && evaluateGrid(flattenGrid(four)) == fourValue &&
+         evaluateBoard(packGrid(four)) == fourValue;
+    setEvalBackend(EVAL_BACKEND_SIMD);
+    ok = ok && evaluateBoard(packGrid(four)) == fourValue;
+    setEvalBackend(EVAL_BACKEND_TABLE);
+    std::vector<std::vector<int>> six(6, std::vector<int>(6, 131072));
+    const int64_t sixValue = (36LL * 131072 + 60 + 60) * 1000000;
+    ok = ok && evaluateGrid(six) == sixValue && evaluateGrid(flattenGrid(six)) == sixValue;
+    setEvalWeights(EvalWeights());
+
+    std::remove(path.c_str());
+    ok = ok && !readEvalWeights(path, read);
+    std::cout << (ok ? "testEvalWeightsFile passed\n" : "testEvalWeightsFile failed\n");
+}
+
+// Checks the binary game log: records of random games of every size are
+// written, read back, and replayed to any move.
+// Success criterion: boardAt and moveAt give the boards, scores and moves of
+// the live games at every move, the index is rebuilt when it is deleted, and a
+// record whose header no longer matches its size is dropped.
+void testGameLog() {
+    std::cout << "Running testGameLog...\n";
+    const std::string path = "test_gamelog.bin";
+    std::remove(path.c_str());
+    std::remove((path + ".idx").c_str());
+
+    struct Played {
+        std::vector<FlatGrid> boards;  // Board before every move, then the final board
+        std::vector<int> scores;
+        std::vector<int> moves;
+    };
+    std::vector<Played> games;
+    GameLogWriter writer(1024);  // Small buffer: several flushes
+    bool ok = writer.open(path);
+    for (int game = 0; game < 6 && ok; ++game) {
+        int size = 4 + game % 3;
+        GameRng rng(gameSeed(5, game));
+        FlatGrid grid = makeFlatGrid(size);
+        GameRecord record(gameSeed(5, game), size);
+        for (int t = 0; t < 2; ++t) {
+            int cell = addRandomTile(grid, rng);
+            record.addSpawn(cell, grid.cells[cell]);
+        }
+        Played played;
+        int score = 0;
+        while (!isGameOver(grid)) {
+            int move = static_cast<int>(rng.below(4));
+            FlatGrid before = grid;
+            int scoreBefore = score;
+            bool moved = false;
+            if (move == 0) moveUp(grid, moved, score);
+            else if (move == 1) moveDown(grid, moved, score);
+            else if (move == 2) moveLeft(grid, moved, score);
+            else moveRight(grid, moved, score);
+            if (!moved) continue;
+            played.boards.push_back(before);
+            played.scores.push_back(scoreBefore);
+            played.moves.push_back(move);
+            record.addMove(move);
+            int cell = addRandomTile(grid, rng);
+            record.addSpawn(cell, cell < 0 ? 0 : grid.cells[cell]);
+        }
+        played.boards.push_back(grid);
+        played.scores.push_back(score);
+        ok = ok && (record.score() == score);
+        writer.write(record);
+        games.push_back(played);
+    }
+    writer.close();
+
+    for (int pass = 0; pass < 2 && ok; ++pass) {
+        if (pass == 1) std::remove((path + ".idx").c_str());  // The reader rebuilds it
+        GameLogReader reader;
+        ok = reader.open(path) && reader.gameCount() == games.size();
+        for (size_t game = 0; game < games.size() && ok; ++game) {
+            const Played& played = games[game];
+            GameRecordInfo info;
+            ok = reader.gameInfo(game, info) && info.moveCount == static_cast<int>(played.moves.size())
+                 && info.finalScore == played.scores.back() && info.seed == gameSeed(5, game);
+            for (size_t move = 0; move < played.boards.size() && ok; ++move) {
+                FlatGrid grid;
+                int score = -1;
+                ok = reader.boardAt(game, static_cast<int>(move), grid, score) && score == played.scores[move]
+                     && grid.size == played.boards[move].size
+                     && std::equal(grid.cells, grid.cells + grid.size * grid.size, played.boards[move].cells);
+                if (move < played.moves.size()) ok = ok && reader.moveAt(game, static_cast<int>(move)) == played.moves[move];
+            }
+        }
+    }
+
+    // A damaged move count in the last header (magic intact): the record no
+    // longer has the size of its moves, so it is dropped, with or without the index
+    std::vector<char> bytes;
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    size_t last = 8;  // After the log magic
+    for (size_t game = 0; game + 1 < games.size(); ++game) {
+        GameRecordHeader header;
+        std::memcpy(&header, &bytes[last], sizeof(header));
+        last += header.recordBytes;
+    }
+    GameRecordHeader damaged;
+    std::memcpy(&damaged, &bytes[last], sizeof(damaged));
+    damaged.moveCount += 1000;
+    std::memcpy(&bytes[last], &damaged, sizeof(damaged));
+    std::ofstream(path.c_str(), std::ios::binary).write(&bytes[0], bytes.size());
+    for (int pass = 0; pass < 2 && ok; ++pass) {
+        if (pass == 1) std::remove((path + ".idx").c_str());
+        GameLogReader reader;
+        FlatGrid grid;
+        int score = 0;
+        ok = reader.open(path) && reader.gameCount() == games.size() - 1 &&
+             !reader.boardAt(games.size() - 1, 0, grid, score) && reader.moveAt(games.size() - 1, 0) == -1;
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".idx").c_str());
+    std::cout << (ok ? "testGameLog passed\n" : "testGameLog failed\n");
+}
+
+// Checks the n-tuple network and its use as the evaluation of the search.
+// Success criterion: the 8 symmetries are the rotations and reflections of the
+// grid and share one value, an update moves the value of its board, a saved
+// network loads back identical (garbage and truncated files are rejected and
+// leave the network unchanged), and the n-tuple backend evaluates 4x4 boards
+// with the loaded network, which a failed reload keeps.
+void testNTupleNetwork() {
+    std::cout << "Running testNTupleNetwork...\n";
+    GameRng rng(gameSeed(17, 0));
+    FlatGrid grid = makeFlatGrid(4);
+    for (int i = 0; i < 16; ++i) grid.cells[i] = static_cast<uint8_t>(rng.below(12));
+    Board board = packGrid(grid);
+    Board symmetries[8];
+    boardSymmetries(board, symmetries);
+
+    // Rotating the grid a quarter turn four times, mirrored or not, gives the same 8 boards
+    bool ok = symmetries[0] == board;
+    FlatGrid turned = grid;
+    for (int mirror = 0; mirror < 2 && ok; ++mirror) {
+        for (int turn = 0; turn < 4 && ok; ++turn) {
+            FlatGrid next = makeFlatGrid(4);
+            for (int row = 0; row < 4; ++row) {
+                for (int col = 0; col < 4; ++col) next.cells[4 * col + (3 - row)] = turned.cells[4 * row + col];
+            }
+            turned = next;
+            ok = std::find(symmetries, symmetries + 8, packGrid(turned)) != symmetries + 8;
+        }
+        for (int row = 0; row < 4; ++row) std::reverse(turned.cells + 4 * row, turned.cells + 4 * row + 4);
+    }
+
+    NTupleNetwork network;
+    network.reset(NTUPLE_LAYOUT_4);
+    ok = ok && network.weightCount() == 5 * 65536 && network.value(board) == 0.0f;
+    for (int i = 0; i < 200; ++i) {
+        for (int c = 0; c < 16; ++c) grid.cells[c] = static_cast<uint8_t>(rng.below(8));
+        network.update(packGrid(grid), static_cast<float>(rng.below(100)) - 30.0f);
+    }
+    float before = network.value(board);
+    network.update(board, 8.0f);
+    ok = ok && network.value(board) >= before + 7.99f;  // More when a feature appears twice
+    for (int s = 1; s < 8 && ok; ++s) ok = std::fabs(network.value(symmetries[s]) - network.value(board)) < 1e-3f;
+
+    const std::string path = "test_ntuple.bin";
+    NTupleNetwork loaded;
+    ok = ok && network.save(path) && loaded.load(path) && loaded.checksum() == network.checksum() &&
+         loaded.value(board) == network.value(board);
+
+    // The n-tuple backend evaluates with the loaded network, clamped at 0
+    ok = ok && loadNTupleEvaluator(path) && evalBackend() == EVAL_BACKEND_NTUPLE;
+    float value = sharedNTupleNetwork().value(board);
+    ok = ok && evaluateBoard(board) == (value > 0.0f ? static_cast<int>(value + 0.5f) : 0);
+    SearchOptions options;
+    options.mode = SEARCH_GREEDY;
+    unpackBoard(board, grid);
+    std::string move = getBestMove(grid, 0, options);
+    ok = ok && move != "None" && lastSearchStats().depth == 1;
+    const uint64_t version = evalWeightsVersion();
+    std::ofstream("test_ntuple_bad.bin", std::ios::binary) << "2048NTN1 not a network";
+    ok = ok && !loadNTupleEvaluator("test_ntuple_bad.bin") && evalBackend() == EVAL_BACKEND_NTUPLE &&
+         sharedNTupleNetwork().checksum() == network.checksum() && evalWeightsVersion() == version &&
+         evaluateBoard(board) == (value > 0.0f ? static_cast<int>(value + 0.5f) : 0);
+    std::remove("test_ntuple_bad.bin");
+    setEvalBackend(EVAL_BACKEND_TABLE);
+    ok = ok && evaluateBoard(board) == tableEvaluateBoard(board);
+
+    std::ofstream(path.c_str(), std::ios::binary) << "2048NTN1 not a network";
+    ok = ok && !loaded.load(path) && loaded.checksum() == network.checksum();
+    ok = ok && network.save(path);
+    std::ifstream full(path.c_str(), std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(full)), std::istreambuf_iterator<char>());
+    full.close();
+    std::ofstream(path.c_str(), std::ios::binary) << bytes.substr(0, bytes.size() - 4);
+    ok = ok && !loaded.load(path) && !loadNTupleEvaluator(path) && evalBackend() == EVAL_BACKEND_TABLE;
+    std::remove(path.c_str());
+    std::cout << (ok ? "testNTupleNetwork passed\n" : "testNTupleNetwork failed\n");
+}
+
+// Checks the batch move kernels against the scalar moves.
+// Success criterion: on random boards (full rows, merges of 32768 tiles, empty
+// boards) every supported kernel gives the boards, score deltas and moved flags
+// of boardMove*, with one direction per board or the same for all, for batch
+// sizes that are not a multiple of the vector width.
+void testBatchMove() {
+    std::cout << "Running testBatchMove...\n";
+    GameRng rng(gameSeed(18, 0));
+    const int count = 1027;
+    std::vector<Board> boards(count);
+    std::vector<uint8_t> moves(count);
+    for (int i = 0; i < count; ++i) {
+        Board board = 0;
+        int maxExponent = 1 + static_cast<int>(rng.below(15));
+        for (int cell = 0; cell < 16; ++cell) {
+            if (rng.below(3) != 0) board |= static_cast<Board>(rng.below(maxExponent + 1)) << (4 * cell);
+        }
+        boards[i] = (i % 97 == 0) ? 0 : board;
+        moves[i] = static_cast<uint8_t>(rng.below(4));
+    }
+
+    bool ok = true;
+    for (int kernel = BATCH_MOVE_SCALAR; kernel <= BATCH_MOVE_AVX2; ++kernel) {
+        if (!batchMoveKernelSupported(static_cast<BatchMoveKernel>(kernel))) continue;
+        for (int uniform = -1; uniform < 4; ++uniform) {  // -1: the per-board moves
+            for (int size : {count, 3, 4, 0}) {
+                std::vector<Board> work(boards.begin(), boards.begin() + size);
+                std::vector<int> scores(size + 1, -1);
+                std::vector<uint8_t> moved(size + 1, 2);
+                if (uniform < 0) {
+                    batchMove(work.data(), moves.data(), size, scores.data(), moved.data(),
+                              static_cast<BatchMoveKernel>(kernel));
+                } else {
+                    batchMoveAll(work.data(), uniform, size, scores.data(), moved.data(),
+                                 static_cast<BatchMoveKernel>(kernel));
+                }
+                for (int i = 0; i < size && ok; ++i) {
+                    int move = (uniform < 0) ? moves[i] : uniform;
+                    int expectedScore = 0;
+                    Board expected = boards[i];
+                    switch (move) {
+                        case 0: expected = boardMoveUp(boards[i], expectedScore); break;
+                        case 1: expected = boardMoveDown(boards[i], expectedScore); break;
+                        case 2: expected = boardMoveLeft(boards[i], expectedScore); break;
+                        case 3: expected = boardMoveRight(boards[i], expectedScore); break;
+                    }
+                    ok = work[i] == expected && scores[i] == expectedScore &&
+                         moved[i] == (expected != boards[i] ? 1 : 0);
+                }
+                ok = ok && scores[size] == -1 && moved[size] == 2;  // Nothing written past the batch
+            }
+        }
+        if (!ok) std::cout << "Mismatch with the " << batchMoveKernelName(static_cast<BatchMoveKernel>(kernel))
+                           << " kernel\n";
+    }
+    std::cout << (ok ? "testBatchMove passed\n" : "testBatchMove failed\n");
+}
+
+// Random N x N grids (some full, some with large tiles) through the packed board:
+// round trip, moves with every supported kernel, scores, game over and spawns
+// must match the FlatGrid code.
+template <int N>
+bool sizedBoardMatchesFlatGrid(GameRng& rng) {
+    for (int t = 0; t < 400; ++t) {
+        FlatGrid grid = makeFlatGrid(N);
+        int maxExponent = 1 + static_cast<int>(rng.below(SizedBoard<N>::MAX_EXPONENT - 1));
+        bool full = (t % 5 == 0);
+        for (int i = 0; i < N * N; ++i) {
+            if (full || rng.below(3) != 0) grid.cells[i] = static_cast<uint8_t>(1 + rng.below(maxExponent));
+        }
+        if (!canPackSizedBoard<N>(grid)) return false;
+        SizedBoard<N> board = packSizedBoard<N>(grid);
+        FlatGrid unpacked;
+        unpackSizedBoard(board, unpacked);
+        if (unpacked.size != N || !std::equal(grid.cells, grid.cells + N * N, unpacked.cells)) return false;
+        if (sizedBoardIsGameOver(board) != isGameOver(grid)) return false;
+        if (sizedEmptyCellMask(board) != emptyCellMask(grid)) return false;
+
+        for (int move = 0; move < 4; ++move) {
+            FlatGrid expected = grid;
+            int expectedScore = 0;
+            bool moved = false;
+            switch (move) {
+                case 0: moveUp(expected, moved, expectedScore); break;
+                case 1: moveDown(expected, moved, expectedScore); break;
+                case 2: moveLeft(expected, moved, expectedScore); break;
+                case 3: moveRight(expected, moved, expectedScore); break;
+            }
+            for (int kernel = SIZED_MOVE_SCALAR; kernel <= SIZED_MOVE_AVX2; ++kernel) {
+                if (!sizedMoveKernelSupported(static_cast<SizedMoveKernel>(kernel))) continue;
+                int score = 0;
+                SizedBoard<N> result = sizedBoardMove(board, move, score, static_cast<SizedMoveKernel>(kernel));
+                if (score != expectedScore || (result != board) != moved) return false;
+                if (result != packSizedBoard<N>(expected)) return false;
+            }
+        }
+
+        GameRng spawnRng(gameSeed(20, t));
+        GameRng expectedRng(gameSeed(20, t));
+        int cell = spawnSizedBoardTile(board, spawnRng);
+        int expectedCell = addRandomTile(grid, expectedRng);
+        if (cell != expectedCell || board != packSizedBoard<N>(grid)) return false;
+    }
+    FlatGrid large = makeFlatGrid(N);
+    large.cells[0] = SizedBoard<N>::MAX_EXPONENT;  // Left to the flat grid search
+    return !canPackSizedBoard<N>(large) && !canPackSizedBoard<N>(makeFlatGrid(N == 4 ? 5 : 4));
+}
+
+// Checks the compile-time sized boards against the flat grid code for every
+// menu size, and that SizedBoard<4> has the layout of the packed Board.
+void testSizedBoard() {
+    std::cout << "Running testSizedBoard...\n";
+    GameRng rng(gameSeed(20, 1000));
+    bool ok = sizedBoardMatchesFlatGrid<4>(rng) && sizedBoardMatchesFlatGrid<5>(rng) &&
+              sizedBoardMatchesFlatGrid<6>(rng);
+    for (int t = 0; t < 200 && ok; ++t) {
+        FlatGrid grid = makeFlatGrid(4);
+        for (int i = 0; i < 16; ++i) grid.cells[i] = static_cast<uint8_t>(rng.below(12));
+        ok = packSizedBoard<4>(grid).words[0] == packGrid(grid);
+    }
+    std::cout << (ok ? "testSizedBoard passed\n" : "testSizedBoard failed\n");
+}
+
+// Checks the undo/redo history on every menu size.
+// Success criterion: undoing restores every kept position and score in turn
+// (the oldest ones are dropped once the buffer is full), redoing replays them,
+// a new move drops the positions that could be redone, and the largest tile
+// of an int grid survives the packing.
+void testGameHistory() {
+    std::cout << "Running testGameHistory...\n";
+    bool ok = true;
+    GameRng rng(gameSeed(23, 0));
+    for (int size = 4; size <= 6 && ok; ++size) {
+        const int capacity = 300;
+        GameHistory history(capacity);
+        std::vector<std::vector<std::vector<int>>> grids;
+        std::vector<int> scores;
+        std::vector<std::vector<int>> grid(size, std::vector<int>(size, 0));
+        int score = 0;
+        initializeGrid(grid, rng);
+        history.reset(grid, score);
+        grids.push_back(grid);
+        scores.push_back(score);
+        while (grids.size() < 500) {
+            if (isGameOver(grid)) grid.assign(size, std::vector<int>(size, 0)), initializeGrid(grid, rng);
+            bool moved = false;
+            switch (rng.below(4)) {
+                case 0: moveUp(grid, moved, score); break;
+                case 1: moveDown(grid, moved, score); break;
+                case 2: moveLeft(grid, moved, score); break;
+                default: moveRight(grid, moved, score); break;
+            }
+            if (!moved) continue;
+            addRandomTile(grid, rng);
+            history.push(grid, score);
+            grids.push_back(grid);
+            scores.push_back(score);
+        }
+        ok = history.undoLevels() == capacity - 1 && history.redoLevels() == 0;
+        int index = static_cast<int>(grids.size()) - 1;
+        while (ok && history.undo(grid, score)) {
+            --index;
+            ok = grid == grids[index] && score == scores[index];
+        }
+        ok = ok && index == static_cast<int>(grids.size()) - capacity && history.redoLevels() == capacity - 1;
+        for (int k = 0; k < 10 && ok; ++k) {
+            ok = history.redo(grid, score) && grid == grids[++index] && score == scores[index];
+        }
+        history.push(grids.back(), scores.back());
+        ok = ok && history.redoLevels() == 0 && !history.redo(grid, score) && history.undo(grid, score) &&
+             grid == grids[index] && score == scores[index];
+    }
+
+    GameHistory history(4);
+    std::vector<std::vector<int>> grid(6, std::vector<int>(6, 0));
+    grid[5][5] = 1 << 30;
+    grid[0][0] = 2;
+    std::vector<std::vector<int>> large = grid;
+    history.reset(grid, 100);
+    grid[0][0] = 4;
+    history.push(grid, 104);
+    int score = 0;
+    ok = ok && history.undo(grid, score) && grid == large && score == 100 && !history.undo(grid, score);
+    std::cout << (ok ? "testGameHistory passed\n" : "testGameHistory failed\n");
+}
+
+// Checks the game checkpoints.
+// Success criterion: a saved game loads back with the same board, score,
+// settings and generator (the spawns go on identically), a second save
+// replaces the first without leaving the temporary file, and truncated,
+// corrupted or missing files are rejected.
+void testCheckpoint() {
+    std::cout << "Running testCheckpoint...\n";
+    const std::string path = "test_checkpoint.bin";
+    std::remove(path.c_str());
+
+    GameRng rng(gameSeed(24, 0));
+    std::vector<std::vector<int>> grid(5, std::vector<int>(5, 0));
+    initializeGrid(grid, rng);
+    grid[4][4] = 1 << 30;
+    GameCheckpoint saved;
+    saved.grid = flattenGrid(grid);
+    saved.score = 123456;
+    saved.moveCount = 789;
+    saved.seed = 42;
+    rng.saveState(saved.rngState);
+    saved.search.mode = SEARCH_ROLLOUT;
+    saved.search.depth = 6;
+    saved.search.probCutoff = 0.002;
+    saved.search.useTranspositionTable = false;
+    saved.search.rollouts = 321;
+    saved.moveTimeMs = 50;
+    saved.timedMode = true;
+    saved.timeLimit = 300;
+    saved.elapsedSeconds = 17;
+
+    GameCheckpoint loaded;
+    bool ok = !loadCheckpoint(path, loaded) && saveCheckpoint(path, saved) && loadCheckpoint(path, loaded);
+    std::vector<std::vector<int>> restored(5, std::vector<int>(5, 0));
+    unflattenGrid(loaded.grid, restored);
+    GameRng resumed(1);
+    ok = ok && loaded.grid.size == 5 && restored == grid && loaded.score == 123456 && loaded.moveCount == 789 &&
+         loaded.seed == 42 && loaded.search.mode == SEARCH_ROLLOUT && loaded.search.depth == 6 &&
+         loaded.search.probCutoff == 0.002 && !loaded.search.useTranspositionTable &&
+         loaded.search.rollouts == 321 && loaded.moveTimeMs == 50 && loaded.timedMode && loaded.timeLimit == 300 &&
+         loaded.elapsedSeconds == 17 && resumed.restoreState(loaded.rngState);
+    for (int i = 0; i < 100 && ok; ++i) ok = resumed() == rng();
+
+    saved.score = 7;
+    ok = ok && saveCheckpoint(path, saved) && loadCheckpoint(path, loaded) && loaded.score == 7 &&
+         !std::ifstream((path + ".tmp").c_str()).good();
+
+    // Every flipped byte and every truncation must be caught
+    std::vector<char> bytes;
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    for (size_t i = 0; i < bytes.size() && ok; i += 7) {
+        std::vector<char> damaged = bytes;
+        damaged[i] ^= 0x10;
+        std::ofstream(path.c_str(), std::ios::binary).write(&damaged[0], damaged.size());
+        GameCheckpoint rejected;
+        ok = !loadCheckpoint(path, rejected) && rejected.score == 0;
+        std::ofstream(path.c_str(), std::ios::binary).write(&bytes[0], i);
+        ok = ok && !loadCheckpoint(path, rejected);
+    }
+
+    // The writer ends with the newest checkpoint in the file, and discard deletes it
+    {
+        CheckpointWriter writer(path);
+        for (int i = 1; i <= 200; ++i) {
+            saved.moveCount = i;
+            writer.save(saved);
+        }
+        ok = ok && writer.flush() && loadCheckpoint(path, loaded) && loaded.moveCount == 200;
+        saved.moveCount = 201;
+        writer.save(saved);
+    }
+    ok = ok && loadCheckpoint(path, loaded) && loaded.moveCount == 201;  // Written before the thread stopped
+    {
+        CheckpointWriter writer(path);
+        writer.save(saved);
+        writer.discard();
+        writer.flush();
+    }
+    ok = ok && !std::ifstream(path.c_str()).good();
+    std::remove(path.c_str());
+    std::cout << (ok ? "testCheckpoint passed\n" : "testCheckpoint failed\n");
+}
+
+// Checks the shared results store.
+// Success criterion: stores of several threads appending to the same file
+// (each with its own descriptor, as separate processes would) lose no game,
+// the totals and distributions match the games played, compaction keeps the
+// file small, and results still waiting are part of the answers.
+void testResultStore() {
+    std::cout << "Running testResultStore...\n";
+    const std::string path = "test_results.bin";
+    std::remove(path.c_str());
+    const int threads = 4;
+    const int gamesPerThread = 250;
+
+    bool ok = true;
+    {
+        ResultStore empty(path);
+        ResultSummary none;
+        ok = empty.summary(4, RESULT_CLASSIC, false, none) && none.games == 0 &&
+             empty.bestScore(4, RESULT_CLASSIC, false) == 0;
+    }
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&path, t]() {
+            ResultStore store(path, 7, 50);
+            for (int g = 0; g < gamesPerThread; ++g) {
+                StoredResult result;
+                result.gridSize = 4 + g % 2;
+                result.mode = (g % 3 == 0) ? RESULT_TIMED : RESULT_CLASSIC;
+                result.ai = (t % 2 == 1);
+                result.score = t * 1000 + g;
+                result.maxTile = 1 << (1 + g % 12);
+                result.moves = g;
+                store.add(result);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // Expected totals, from the same rule
+    ResultStore store(path, 1000, 50);
+    uint64_t games = 0;
+    for (int size = 4; size <= 5; ++size) {
+        for (int mode = RESULT_CLASSIC; mode <= RESULT_TIMED; ++mode) {
+            for (int ai = 0; ai <= 1; ++ai) {
+                ResultSummary expected;
+                for (int t = ai; t < threads; t += 2) {
+                    for (int g = 0; g < gamesPerThread; ++g) {
+                        if (4 + g % 2 != size || ((g % 3 == 0) ? RESULT_TIMED : RESULT_CLASSIC) != mode) continue;
+                        StoredResult result;
+                        result.score = t * 1000 + g;
+                        result.maxTile = 1 << (1 + g % 12);
+                        result.moves = g;
+                        expected.add(result);
+                    }
+                }
+                ResultSummary stored;
+                ok = ok && store.summary(size, static_cast<ResultMode>(mode), ai == 1, stored) &&
+                     stored.games == expected.games && stored.scoreSum == expected.scoreSum &&
+                     stored.moveSum == expected.moveSum && stored.bestScore == expected.bestScore &&
+                     stored.bestTile == expected.bestTile &&
+                     store.bestScore(size, static_cast<ResultMode>(mode), ai == 1) ==
+                         static_cast<int>(expected.bestScore);
+                for (int b = 0; b < RESULT_BUCKETS && ok; ++b) {
+                    ok = stored.scoreBuckets[b] == expected.scoreBuckets[b] &&
+                         stored.tileCounts[b] == expected.tileCounts[b];
+                }
+                games += stored.games;
+            }
+        }
+    }
+    ok = ok && games == static_cast<uint64_t>(threads * gamesPerThread);
+
+    // Compacted: a header and fewer than 50 + 7 * threads records, not 1000
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    ok = ok && file.good() && file.tellg() < 14000 + 24 * (50 + 7 * threads);
+    file.close();
+
+    // A waiting result counts, and is kept by compact()
+    StoredResult best;
+    best.gridSize = 6;
+    best.score = 999999;
+    best.maxTile = 65536;
+    store.add(best);
+    ResultSummary six;
+    ok = ok && store.bestScore(6, RESULT_CLASSIC, false) == 999999 && store.compact() &&
+         store.summary(6, RESULT_CLASSIC, false, six) && six.games == 1 && six.reachedTile(2048) == 1.0 &&
+         six.scorePercentile(0.5) == 999999 && six.meanScore() == 999999.0;
+    ResultStore other(path);
+    ok = ok && other.bestScore(6, RESULT_CLASSIC, false) == 999999 && other.bestScore(6, RESULT_TIMED, false) == 0;
+    std::remove(path.c_str());
+    std::cout << (ok ? "testResultStore passed\n" : "testResultStore failed\n");
+}
 
 // Main function to run all tests.
 int main() {
@@ -268,6 +1491,29 @@ int main() {
     testMoveRight();
     testMoveUp();
     testMoveDown();
+    testBoardMovesMatchSlideAndMerge();
+    testBoardHelpers();
+    testExpectimaxMove();
+    testTranspositionTable();
+    testPersistentTranspositionTable();
+    testParallelSearchDeterministic();
+    testTimedSearch();
+    testRolloutSearch();
+    testHintPonderer();
+    testHintWaitBudget();
+    testSearchStats();
+    testFlatGridMatchesGrid();
+    testEvalKernelsMatchScalar();
+    testEvalTable();
+    testGameRng();
+    testEvalWeightsFile();
+    testGameLog();
+    testNTupleNetwork();
+    testBatchMove();
+    testSizedBoard();
+    testGameHistory();
+    testCheckpoint();
+    testResultStore();
     std::cout << "All tests completed.\n";
     return 0;
 }
@@ -0,0 +1,123 @@
+#include "threadpool.hpp"
+#include <chrono>
+
+namespace {
+
+// Index of the pool worker running on this thread (-1 outside of any pool)
+thread_local int currentWorker = -1;
+thread_local const ThreadPool* currentPool = nullptr;
+
+} // namespace
+
+ThreadPool::ThreadPool(int threads) : queuedTasks(0), stopping(false) {
+    if (threads < 1) threads = 1;
+    for (int i = 0; i <= threads; ++i) {
+        queues.push_back(new TaskQueue());
+    }
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (auto* queue : queues) {
+        delete queue;
+    }
+}
+
+int ThreadPool::workerIndex() const {
+    return (currentPool == this) ? currentWorker : static_cast<int>(workers.size());
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // Workers push to their own queue, other threads to the shared one
+    int index = (currentPool == this) ? currentWorker : static_cast<int>(workers.size());
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    queuedTasks.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);  // Pairs with the predicate check in workerLoop
+    }
+    wakeUp.notify_one();
+}
+
+// Take the newest task of our own queue, else the oldest task of another queue
+bool ThreadPool::popTask(int index, std::function<void()>& task) {
+    int queueCount = static_cast<int>(queues.size());
+    if (index >= 0) {
+        TaskQueue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+    int start = (index < 0) ? 0 : index + 1;
+    for (int offset = 0; offset < queueCount; ++offset) {
+        int victim = (start + offset) % queueCount;
+        if (victim == index) continue;
+        TaskQueue& other = *queues[victim];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask() {
+    if (queuedTasks.load() == 0) return false;
+    std::function<void()> task;
+    int index = (currentPool == this) ? currentWorker : -1;
+    if (!popTask(index, task)) return false;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(int index) {
+    currentWorker = index;
+    currentPool = this;
+    while (true) {
+        std::function<void()> task;
+        if (popTask(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stopping) return;
+        wakeUp.wait_for(lock, std::chrono::milliseconds(10), [this] {
+            return stopping.load() || queuedTasks.load() > 0;
+        });
+    }
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    pending.fetch_add(1);
+    pool.submit([this, task]() {
+        task();
+        pending.fetch_sub(1);
+    });
+}
+
+void TaskGroup::wait() {
+    while (pending.load() > 0) {
+        if (!pool.runPendingTask()) {
+            std::this_thread::yield();
+        }
+    }
+}
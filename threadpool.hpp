@@ -0,0 +1,61 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Reusable pool of worker threads with one task queue per worker.
+// A worker runs the newest task of its own queue first and steals the oldest
+// task of another queue when its own is empty. Tasks submitted from outside
+// the pool go to a shared queue that every worker steals from.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    int threadCount() const { return static_cast<int>(workers.size()); }
+    int workerIndex() const;  // Worker running the calling thread, threadCount() outside of the pool
+    void submit(std::function<void()> task);
+    bool runPendingTask();  // Run one queued task on the calling thread, if any
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    ThreadPool(const ThreadPool&);             // Not copyable
+    ThreadPool& operator=(const ThreadPool&);
+
+    void workerLoop(int index);
+    bool popTask(int index, std::function<void()>& task);
+
+    std::vector<std::thread> workers;
+    std::vector<TaskQueue*> queues;  // One per worker, plus the shared queue at the end
+    std::atomic<int> queuedTasks;
+    std::atomic<bool> stopping;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+};
+
+// A set of tasks that can be waited for. The waiting thread runs queued tasks
+// while it waits, so tasks may themselves start and wait for groups.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool), pending(0) {}
+    ~TaskGroup() { wait(); }
+
+    void run(std::function<void()> task);
+    void wait();
+
+private:
+    ThreadPool& pool;
+    std::atomic<int> pending;
+};
+
+#endif // THREADPOOL_HPP
@@ -0,0 +1,189 @@
+#include "ntuple.hpp"    // The network being trained
+#include "bitboard.hpp"  // Packed 4x4 boards and their moves
+#include "rng.hpp"       // Per-game random generators
+#include <algorithm>     // For std::max
+#include <atomic>        // For the shared game counter
+#include <chrono>        // For progress reports
+#include <cstdlib>       // For std::atoi
+#include <iomanip>       // For formatted output
+#include <iostream>      // For the report
+#include <mutex>         // For the report totals
+#include <string>        // For command-line options
+#include <thread>        // For the training threads
+#include <vector>        // For the workers
+
+// Temporal-difference trainer of the n-tuple network (TD(0) on afterstates).
+// The player picks the move maximizing reward + V(afterstate); after the next
+// move, V(previous afterstate) moves towards reward + V(next afterstate), and
+// towards 0 when the game ends. Every thread plays its own games on the same
+// network without locks (Hogwild), each game from its own seed.
+
+// Settings read from the command line
+struct TrainOptions {
+    uint64_t seed;
+    int threads;
+    long long games;
+    int reportEvery;     // Games between progress reports (and saves)
+    float alpha;         // Learning rate
+    NTupleLayout layout;
+    std::string loadPath;
+    std::string outPath;
+
+    TrainOptions()
+        : seed(1), threads(std::max(1u, std::thread::hardware_concurrency())), games(100000), reportEvery(1000),
+          alpha(0.1f), layout(NTUPLE_LAYOUT_4), outPath("data/ntuple.bin") {}
+};
+
+// Totals of the games finished since the last report
+struct TrainReport {
+    std::mutex mutex;
+    long long finished;
+    long long games;
+    double scoreSum;
+    int maxScore;
+    int reached2048;
+
+    TrainReport() : finished(0), games(0), scoreSum(0.0), maxScore(0), reached2048(0) {}
+};
+
+int maxExponent(Board board) {
+    int best = 0;
+    for (; board != 0; board >>= 4) best = std::max(best, static_cast<int>(board & 0xF));
+    return best;
+}
+
+// Play one game, learning after every move. Returns the score.
+int trainGame(NTupleNetwork& network, uint64_t seed, float alpha, int& topExponent) {
+    GameRng rng(seed);
+    Board board = 0;
+    spawnBoardTile(board, rng);
+    spawnBoardTile(board, rng);
+    Board previous = 0;      // Afterstate of the last move
+    bool hasPrevious = false;
+    int score = 0;
+
+    while (true) {
+        Board bestAfter = 0;
+        int bestReward = 0;
+        float bestValue = 0.0f;
+        bool found = false;
+        for (int move = 0; move < 4; ++move) {
+            int reward = 0;
+            Board after = board;
+            switch (move) {
+                case 0: after = boardMoveUp(board, reward); break;
+                case 1: after = boardMoveDown(board, reward); break;
+                case 2: after = boardMoveLeft(board, reward); break;
+                case 3: after = boardMoveRight(board, reward); break;
+            }
+            if (after == board) continue;
+            float value = reward + network.value(after);
+            if (!found || value > bestValue) {
+                found = true;
+                bestValue = value;
+                bestAfter = after;
+                bestReward = reward;
+            }
+        }
+
+        if (hasPrevious) {
+            float target = found ? bestValue : 0.0f;  // Nothing more to score after the last move
+            network.update(previous, alpha * (target - network.value(previous)));
+        }
+        if (!found) break;
+        score += bestReward;
+        previous = bestAfter;
+        hasPrevious = true;
+        board = bestAfter;
+        spawnBoardTile(board, rng);
+    }
+    topExponent = maxExponent(board);
+    return score;
+}
+
+// Print usage information
+void printUsage() {
+    std::cout << "Usage: train [--games N] [--threads T] [--alpha A] [--tuples 4|6] [--report R]\n"
+              << "             [--seed S] [--load FILE] [--out FILE]\n"
+              << "Trains the n-tuple evaluation of 4x4 boards by self-play (TD learning) and saves\n"
+              << "it to FILE (data/ntuple.bin by default) every R games. --load continues the\n"
+              << "training of a saved network. Use it with \"simulate --ntuple FILE --greedy\".\n";
+}
+
+// Main function of the n-tuple trainer
+int main(int argc, char* argv[]) {
+    TrainOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--games" && hasValue) options.games = std::max(1LL, std::atoll(argv[++i]));
+        else if (arg == "--threads" && hasValue) options.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--alpha" && hasValue) options.alpha = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--tuples" && hasValue) {
+            options.layout = (std::atoi(argv[++i]) == 6) ? NTUPLE_LAYOUT_6 : NTUPLE_LAYOUT_4;
+        }
+        else if (arg == "--report" && hasValue) options.reportEvery = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--load" && hasValue) options.loadPath = argv[++i];
+        else if (arg == "--out" && hasValue) options.outPath = argv[++i];
+        else {
+            printUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+
+    NTupleNetwork network;
+    if (!options.loadPath.empty()) {
+        if (!network.load(options.loadPath)) {
+            std::cout << "Could not read network " << options.loadPath << "\n";
+            return 1;
+        }
+    } else {
+        network.reset(options.layout);
+    }
+    std::cout << "Training " << network.weightCount() << " weights for " << options.games << " games on "
+              << options.threads << " threads, alpha " << options.alpha << "\n" << std::fixed
+              << std::setprecision(1);
+
+    TrainReport report;
+    std::atomic<long long> nextGame(0);
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&]() {
+            for (long long game = nextGame++; game < options.games; game = nextGame++) {
+                int topExponent = 0;
+                int score = trainGame(network, gameSeed(options.seed, static_cast<uint64_t>(game)), options.alpha,
+                                      topExponent);
+
+                std::lock_guard<std::mutex> lock(report.mutex);
+                ++report.finished;
+                ++report.games;
+                report.scoreSum += score;
+                report.maxScore = std::max(report.maxScore, score);
+                if (topExponent >= 11) ++report.reached2048;
+                if (report.finished % options.reportEvery == 0 || report.finished == options.games) {
+                    double seconds =
+                        std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+                    std::cout << "Games " << report.finished << ": mean " << report.scoreSum / report.games
+                              << ", max " << report.maxScore << ", 2048 in "
+                              << 100.0 * report.reached2048 / report.games << "% (" << seconds << " s)\n"
+                              << std::flush;
+                    report.games = 0;
+                    report.scoreSum = 0.0;
+                    report.maxScore = 0;
+                    report.reached2048 = 0;
+                    // The other threads keep learning while the file is written; a torn weight is harmless
+                    if (!network.save(options.outPath)) {
+                        std::cout << "Could not write " << options.outPath << "\n";
+                    }
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::cout << "Saved the network to " << options.outPath << "\n";
+    return 0;
+}
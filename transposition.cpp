@@ -0,0 +1,277 @@
+#include "transposition.hpp"
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>   // flock
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Layout of the data word
+const int VALUE_SHIFT = 0;        // 32 bits: float value
+const int DEPTH_SHIFT = 32;       // 8 bits: remaining depth
+const int BUCKET_SHIFT = 40;      // 8 bits: probability bucket
+const int MOVE_SHIFT = 48;        // 8 bits: best move + 1 (0 = none)
+const int GENERATION_SHIFT = 56;  // 8 bits: search generation
+
+uint64_t packData(int depth, int bucket, float value, int bestMove, uint8_t generation) {
+    uint32_t valueBits;
+    std::memcpy(&valueBits, &value, sizeof(valueBits));
+    return (static_cast<uint64_t>(valueBits) << VALUE_SHIFT) |
+           (static_cast<uint64_t>(depth & 0xFF) << DEPTH_SHIFT) |
+           (static_cast<uint64_t>(bucket & 0xFF) << BUCKET_SHIFT) |
+           (static_cast<uint64_t>((bestMove + 1) & 0xFF) << MOVE_SHIFT) |
+           (static_cast<uint64_t>(generation) << GENERATION_SHIFT);
+}
+
+int dataField(uint64_t data, int shift) {
+    return static_cast<int>((data >> shift) & 0xFF);
+}
+
+// Spread the key bits over the index (Fibonacci hashing)
+uint64_t hashKey(uint64_t key) {
+    key ^= key >> 29;
+    return key * 0x9E3779B97F4A7C15ULL;
+}
+
+// Largest power of two number of entries that fits in the budget
+size_t entriesForBudget(size_t megabytes, size_t entryBytes) {
+    size_t budget = megabytes * 1024 * 1024 / entryBytes;
+    if (budget == 0) return 0;
+    size_t count = 1;
+    while (count * 2 <= budget) count *= 2;
+    return count;
+}
+
+// First bytes of a cache file; the entries follow, 16-byte aligned
+struct CacheFileHeader {
+    char magic[8];         // "2048TTC1"
+    uint64_t version;      // Heuristic of the stored values
+    uint64_t entryCount;   // Power of two
+    uint64_t reserved[5];
+};
+
+const char CACHE_MAGIC[8] = {'2', '0', '4', '8', 'T', 'T', 'C', '1'};
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+    : entries(nullptr), entryCount(0), indexMask(0), version(0), mapping(nullptr), mappedBytes(0),
+      fileDescriptor(-1), warmCount(0), generation(0), probes(0), hits(0), stores(0) {
+    resize(megabytes);
+}
+
+TranspositionTable::~TranspositionTable() {
+    release();
+}
+
+void TranspositionTable::release() {
+#ifndef _WIN32
+    if (mappedBytes > 0) {
+        munmap(mapping, mappedBytes);
+        ::close(fileDescriptor);
+    } else
+#endif
+    {
+        delete[] entries;
+    }
+    entries = nullptr;
+    entryCount = 0;
+    indexMask = 0;
+    mapping = nullptr;
+    mappedBytes = 0;
+    fileDescriptor = -1;
+    warmCount = 0;
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    release();
+    size_t count = entriesForBudget(megabytes, sizeof(Entry));
+    if (count == 0) return;
+
+    entries = new Entry[count];
+    entryCount = count;
+    indexMask = count - 1;
+    clear();
+}
+
+bool TranspositionTable::mapFile(const std::string& path, size_t megabytes, uint64_t newVersion) {
+    release();
+    version = newVersion;
+#ifdef _WIN32
+    (void)path;
+    (void)megabytes;
+    return false;  // Shared file mappings are only implemented with POSIX mmap
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+    flock(fd, LOCK_EX);  // One process at a time creates, resizes or resets the file
+
+    // Reuse a well-formed file whatever its size, otherwise start a new one
+    CacheFileHeader header;
+    struct stat info;
+    bool valid = fstat(fd, &info) == 0 && pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+                 std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && header.entryCount > 0 &&
+                 (header.entryCount & (header.entryCount - 1)) == 0 &&
+                 static_cast<uint64_t>(info.st_size) == sizeof(header) + header.entryCount * sizeof(Entry);
+    size_t count = valid ? static_cast<size_t>(header.entryCount) : entriesForBudget(megabytes, sizeof(Entry));
+    size_t bytes = sizeof(header) + count * sizeof(Entry);
+    if (!valid) {
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = newVersion;
+        header.entryCount = count;
+        // Truncating first zero-fills every entry
+        if (count == 0 || ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(bytes)) != 0 ||
+            pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+            flock(fd, LOCK_UN);
+            ::close(fd);
+            return false;
+        }
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;  // Map every page now rather than on the first probes
+#endif
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (memory == MAP_FAILED) {
+        flock(fd, LOCK_UN);
+        ::close(fd);
+        return false;
+    }
+    mapping = memory;
+    mappedBytes = bytes;
+    fileDescriptor = fd;
+    entries = reinterpret_cast<Entry*>(static_cast<char*>(memory) + sizeof(CacheFileHeader));
+    entryCount = count;
+    indexMask = count - 1;
+
+    CacheFileHeader* mappedHeader = static_cast<CacheFileHeader*>(mapping);
+    if (mappedHeader->version != newVersion) {  // Values of another heuristic are useless
+        clearEntries();
+        mappedHeader->version = newVersion;
+    }
+    for (size_t i = 0; i < entryCount; ++i) {
+        if (entries[i].data.load(std::memory_order_relaxed) != 0) warmCount++;
+    }
+    flock(fd, LOCK_UN);
+
+    generation.store(0);
+    probes.store(0);
+    hits.store(0);
+    stores.store(0);
+    return true;
+#endif
+}
+
+void TranspositionTable::setVersion(uint64_t newVersion) {
+    version = newVersion;
+    if (!fileBacked()) {
+        clear();
+        return;
+    }
+#ifndef _WIN32
+    flock(fileDescriptor, LOCK_EX);
+    CacheFileHeader* header = static_cast<CacheFileHeader*>(mapping);
+    if (header->version != newVersion) {
+        clearEntries();
+        header->version = newVersion;
+    }
+    flock(fileDescriptor, LOCK_UN);
+#endif
+    warmCount = 0;
+}
+
+void TranspositionTable::clearEntries() {
+    for (size_t i = 0; i < entryCount; ++i) {
+        entries[i].check.store(0, std::memory_order_relaxed);
+        entries[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+void TranspositionTable::clear() {
+    clearEntries();
+    warmCount = 0;
+    generation.store(0);
+    probes.store(0);
+    hits.store(0);
+    stores.store(0);
+}
+
+void TranspositionTable::newSearch() {
+    generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool TranspositionTable::probe(uint64_t key, int depth, int probBucket, float& value, int& bestMove) {
+    if (entryCount == 0) return false;
+    probes.fetch_add(1, std::memory_order_relaxed);
+
+    Entry& entry = entries[(hashKey(key) >> 16) & indexMask];
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+    uint64_t check = entry.check.load(std::memory_order_relaxed);
+    if ((check ^ data ^ version) != key) return false;  // Other position or heuristic, or a write in progress
+    if (dataField(data, DEPTH_SHIFT) != depth || dataField(data, BUCKET_SHIFT) != probBucket) return false;
+
+    uint32_t valueBits = static_cast<uint32_t>(data >> VALUE_SHIFT);
+    std::memcpy(&value, &valueBits, sizeof(value));
+    bestMove = dataField(data, MOVE_SHIFT) - 1;
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int probBucket, float value, int bestMove) {
+    if (entryCount == 0) return;
+
+    Entry& entry = entries[(hashKey(key) >> 16) & indexMask];
+    uint64_t oldData = entry.data.load(std::memory_order_relaxed);
+    uint8_t currentGeneration = static_cast<uint8_t>(generation.load(std::memory_order_relaxed));
+
+    // Keep a deeper result of the current search; anything else is replaced
+    if (oldData != 0 && dataField(oldData, GENERATION_SHIFT) == currentGeneration &&
+        dataField(oldData, DEPTH_SHIFT) > depth) {
+        return;
+    }
+
+    uint64_t data = packData(depth, probBucket, value, bestMove, currentGeneration);
+    entry.data.store(data, std::memory_order_relaxed);
+    entry.check.store(key ^ data ^ version, std::memory_order_relaxed);
+    stores.fetch_add(1, std::memory_order_relaxed);
+}
+
+double TranspositionTable::hitRate() const {
+    uint64_t probeTotal = probeCount();
+    return (probeTotal == 0) ? 0.0 : static_cast<double>(hitCount()) / probeTotal;
+}
+
+std::string TranspositionTable::statsLine() const {
+    char line[160];
+    if (fileBacked()) {
+        std::snprintf(line, sizeof(line), "TT %.1f MB (file, %llu warm entries), %llu probes, hit rate %.1f%%",
+                      memoryBytes() / (1024.0 * 1024.0), static_cast<unsigned long long>(warmEntries()),
+                      static_cast<unsigned long long>(probeCount()), hitRate() * 100.0);
+    } else {
+        std::snprintf(line, sizeof(line), "TT %.1f MB, %llu probes, hit rate %.1f%%",
+                      memoryBytes() / (1024.0 * 1024.0),
+                      static_cast<unsigned long long>(probeCount()), hitRate() * 100.0);
+    }
+    return line;
+}
+
+TranspositionTable& sharedTranspositionTable() {
+    static TranspositionTable table;
+    return table;
+}
+
+double quantizeProbability(double prob, int& bucket) {
+    int exponent = 0;
+    std::frexp(prob, &exponent);  // prob = m * 2^exponent with m in [0.5, 1)
+    bucket = 1 - exponent;
+    if (bucket > 255) bucket = 255;
+    return std::ldexp(1.0, -bucket);
+}
@@ -0,0 +1,88 @@
+#ifndef TRANSPOSITION_HPP
+#define TRANSPOSITION_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Fixed-size cache of search results shared by every search thread.
+// Each entry is two 64-bit words: the packed result and the key XOR the result.
+// A reader only accepts an entry whose two words agree, so a torn write from
+// another thread is seen as a miss instead of a wrong value, and no lock is needed.
+//
+// The entries can also live in a file mapped by several processes (mapFile), so
+// results are kept from one run to the next. The check word then also mixes in
+// a version of the heuristic: a process never accepts an entry written with
+// other evaluation weights, even while another process still writes them.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t megabytes = 0);
+    ~TranspositionTable();
+
+    // Reallocate with a new memory budget (rounded down to a power of two entries).
+    // Not thread-safe: call it before starting searches.
+    void resize(size_t megabytes);
+    void clear();
+    void newSearch();  // Ages the entries of previous searches so they are replaced first
+
+    bool enabled() const { return entryCount > 0; }
+
+    // Use the entries of a cache file, created with `megabytes` if it does not
+    // exist (an existing file keeps its size). Its entries are reset when the
+    // file was last opened with another version. Returns false (and keeps an
+    // empty table) if the file cannot be mapped.
+    bool mapFile(const std::string& path, size_t megabytes, uint64_t version);
+    // Version of the values stored from now on; a file-backed table is reset if
+    // the file holds another version, an in-memory table is cleared
+    void setVersion(uint64_t version);
+    bool fileBacked() const { return mappedBytes > 0; }
+    size_t warmEntries() const { return warmCount; }  // Entries already filled when the file was mapped
+
+    // Look up a result stored for the same key, depth and probability bucket.
+    // bestMove is -1 when no move was stored.
+    bool probe(uint64_t key, int depth, int probBucket, float& value, int& bestMove);
+    void store(uint64_t key, int depth, int probBucket, float value, int bestMove);
+
+    // Statistics
+    size_t memoryBytes() const { return entryCount * sizeof(Entry); }
+    uint64_t probeCount() const { return probes.load(std::memory_order_relaxed); }
+    uint64_t hitCount() const { return hits.load(std::memory_order_relaxed); }
+    uint64_t storeCount() const { return stores.load(std::memory_order_relaxed); }
+    double hitRate() const;
+    std::string statsLine() const;  // e.g. "TT 64.0 MB, 1200000 probes, hit rate 35.1%"
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check;  // key ^ data ^ version
+        std::atomic<uint64_t> data;   // value, depth, bucket, move and generation
+    };
+
+    TranspositionTable(const TranspositionTable&);             // Not copyable
+    TranspositionTable& operator=(const TranspositionTable&);
+
+    void release();  // Free or unmap the entries
+    void clearEntries();
+
+    Entry* entries;
+    size_t entryCount;
+    uint64_t indexMask;
+    uint64_t version;
+    void* mapping;                     // Start of the mapped file (header, then entries)
+    size_t mappedBytes;                // 0 for an in-memory table
+    int fileDescriptor;
+    size_t warmCount;
+    std::atomic<unsigned> generation;  // Only the low 8 bits are stored in entries
+    std::atomic<uint64_t> probes;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> stores;
+};
+
+// Table shared by all getBestMove calls of the process (empty until resized)
+TranspositionTable& sharedTranspositionTable();
+
+// Round a branch probability down to a power of two and return its bucket (-log2).
+// Quantized probabilities make a cached value depend only on the board, depth and bucket.
+double quantizeProbability(double prob, int& bucket);
+
+#endif // TRANSPOSITION_HPP
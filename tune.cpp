@@ -0,0 +1,332 @@
+#include "modele.hpp"   // Game logic functions
+#include "ai.hpp"       // AI decision-making and evaluation weights
+#include <algorithm>    // For sorting the candidates
+#include <atomic>       // For the shared game counter
+#include <chrono>       // For progress reports
+#include <cmath>        // For the CMA-ES updates
+#include <cstdlib>      // For std::atoi and std::strtoull
+#include <iomanip>      // For formatted output
+#include <iostream>     // For the report
+#include <random>       // For the normal samples
+#include <string>       // For command-line options
+#include <thread>       // For the game threads
+#include <vector>       // For the candidates
+
+// Self-play tuner for the evaluation weights. Candidates are drawn by CMA-ES
+// (covariance matrix adaptation) and scored by the mean score of a batch of
+// headless games. Every candidate of a generation plays the same seeds, so
+// the ranking compares weights rather than luck (common random numbers).
+
+const int WEIGHT_COUNT = 4;        // tileSum, empty, monotonicity, mergePotential
+const double WEIGHT_TOTAL = 10000.0;  // Sum of the weights of every candidate
+
+typedef std::vector<double> Vector;
+typedef std::vector<Vector> Matrix;
+
+// Settings read from the command line
+struct TuneOptions {
+    uint64_t seed;
+    int gridSize;
+    int threads;
+    int games;            // Games per candidate
+    int generations;
+    int population;       // Candidates per generation (0: CMA-ES default)
+    double sigma;         // Initial step, relative to the starting weights
+    int validationGames;  // Games of the final comparison with the starting weights
+    int moveTimeMs;       // Time limit per move (0: fixed-depth search)
+    SearchOptions search;
+    std::string startPath;
+    std::string outPath;
+
+    TuneOptions()
+        : seed(1), gridSize(4), threads(std::max(1u, std::thread::hardware_concurrency())), games(64),
+          generations(30), population(0), sigma(0.3), validationGames(256), moveTimeMs(0),
+          outPath(DEFAULT_WEIGHTS_FILE) {}
+};
+
+// Weights as a vector and back. The heuristic only ranks positions, so
+// multiplying every weight by the same factor changes nothing: candidates are
+// scaled to a fixed total, which keeps the search away from that direction.
+Vector weightVector(const EvalWeights& weights) {
+    Vector x(WEIGHT_COUNT);
+    x[0] = weights.tileSum;
+    x[1] = weights.empty;
+    x[2] = weights.monotonicity;
+    x[3] = weights.mergePotential;
+    return x;
+}
+
+EvalWeights candidateWeights(const Vector& x, const Vector& start) {
+    double values[WEIGHT_COUNT];
+    double total = 0.0;
+    for (int i = 0; i < WEIGHT_COUNT; ++i) {
+        values[i] = std::max(0.0, x[i] * std::max(1.0, start[i]));  // x is relative to the starting weights
+        total += values[i];
+    }
+    if (total <= 0.0) total = 1.0;
+    EvalWeights weights;
+    weights.tileSum = static_cast<int>(std::lround(values[0] * WEIGHT_TOTAL / total));
+    weights.empty = static_cast<int>(std::lround(values[1] * WEIGHT_TOTAL / total));
+    weights.monotonicity = static_cast<int>(std::lround(values[2] * WEIGHT_TOTAL / total));
+    weights.mergePotential = static_cast<int>(std::lround(values[3] * WEIGHT_TOTAL / total));
+    return weights;
+}
+
+std::string weightsText(const EvalWeights& weights) {
+    return "tileSum " + std::to_string(weights.tileSum) + ", empty " + std::to_string(weights.empty) +
+           ", monotonicity " + std::to_string(weights.monotonicity) + ", mergePotential " +
+           std::to_string(weights.mergePotential);
+}
+
+// Score of one headless game
+int playGame(int gridSize, uint64_t seed, const SearchOptions& search, int moveTimeMs) {
+    GameRng rng(seed);
+    FlatGrid grid = makeFlatGrid(gridSize);
+    addRandomTile(grid, rng);
+    addRandomTile(grid, rng);
+    int score = 0;
+    bool moved = false;
+    while (!isGameOver(grid)) {
+        std::string bestMove = (moveTimeMs > 0) ? getBestMove(grid, score, search, moveTimeMs)
+                                                : getBestMove(grid, score, search);
+        if (bestMove == "Up") moveUp(grid, moved, score);
+        else if (bestMove == "Down") moveDown(grid, moved, score);
+        else if (bestMove == "Left") moveLeft(grid, moved, score);
+        else if (bestMove == "Right") moveRight(grid, moved, score);
+        else break;
+        if (!moved) break;
+        addRandomTile(grid, rng);
+    }
+    return score;
+}
+
+// Mean score of the weights over the given seeds, the games spread over every
+// thread. The weights are global, so candidates are scored one after another.
+double meanScore(const EvalWeights& weights, const std::vector<uint64_t>& seeds, const TuneOptions& options) {
+    setEvalWeights(weights);
+    std::vector<int> scores(seeds.size(), 0);
+    std::atomic<size_t> nextGame(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&]() {
+            // Games have very different lengths: threads take the next one when they are done
+            for (size_t game = nextGame++; game < seeds.size(); game = nextGame++) {
+                scores[game] = playGame(options.gridSize, seeds[game], options.search, options.moveTimeMs);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double total = 0.0;
+    for (int score : scores) total += score;
+    return total / seeds.size();
+}
+
+std::vector<uint64_t> batchSeeds(uint64_t batchSeed, int games) {
+    std::vector<uint64_t> seeds(games);
+    for (int game = 0; game < games; ++game) seeds[game] = gameSeed(batchSeed, game);
+    return seeds;
+}
+
+// Lower-triangular A with A * A^T = C (C is symmetric positive definite)
+Matrix cholesky(const Matrix& c) {
+    int n = static_cast<int>(c.size());
+    Matrix a(n, Vector(n, 0.0));
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            double sum = c[i][j];
+            for (int k = 0; k < j; ++k) sum -= a[i][k] * a[j][k];
+            if (i == j) a[i][i] = std::sqrt(std::max(sum, 1e-20));
+            else a[i][j] = sum / a[j][j];
+        }
+    }
+    return a;
+}
+
+// Solve A * x = y for a lower-triangular A
+Vector solveLower(const Matrix& a, const Vector& y) {
+    int n = static_cast<int>(y.size());
+    Vector x(n, 0.0);
+    for (int i = 0; i < n; ++i) {
+        double sum = y[i];
+        for (int k = 0; k < i; ++k) sum -= a[i][k] * x[k];
+        x[i] = sum / a[i][i];
+    }
+    return x;
+}
+
+double norm(const Vector& v) {
+    double sum = 0.0;
+    for (double value : v) sum += value * value;
+    return std::sqrt(sum);
+}
+
+// Print usage information
+void printUsage() {
+    std::cout << "Usage: tune [--seed S] [--size 4|5|6] [--threads T] [--games G] [--generations N]\n"
+              << "            [--population P] [--sigma X] [--validate V] [--expectimax] [--depth D]\n"
+              << "            [--cutoff P] [--time MS] [--start FILE] [--out FILE]\n"
+              << "Tunes the evaluation weights with CMA-ES: each generation, P candidates play the\n"
+              << "same G seeded games on T threads and are ranked by mean score. The final weights\n"
+              << "are compared with the starting ones on V other games, and the better weights are\n"
+              << "written to FILE (" << DEFAULT_WEIGHTS_FILE << " by default).\n";
+}
+
+// Main function of the weight tuner
+int main(int argc, char* argv[]) {
+    TuneOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--seed" && hasValue) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--size" && hasValue) options.gridSize = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) options.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--games" && hasValue) options.games = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--generations" && hasValue) options.generations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--population" && hasValue) options.population = std::max(4, std::atoi(argv[++i]));
+        else if (arg == "--sigma" && hasValue) options.sigma = std::max(1e-3, std::atof(argv[++i]));
+        else if (arg == "--validate" && hasValue) options.validationGames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--expectimax") options.search.mode = SEARCH_EXPECTIMAX;
+        else if (arg == "--depth" && hasValue) options.search.depth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--cutoff" && hasValue) options.search.probCutoff = std::atof(argv[++i]);
+        else if (arg == "--time" && hasValue) options.moveTimeMs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--start" && hasValue) options.startPath = argv[++i];
+        else if (arg == "--out" && hasValue) options.outPath = argv[++i];
+        else {
+            printUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+    if (options.gridSize < 4 || options.gridSize > 6) {
+        std::cout << "Invalid grid size! Use 4, 5 or 6.\n";
+        return 1;
+    }
+
+    EvalWeights startWeights;
+    if (!options.startPath.empty() && !readEvalWeights(options.startPath, startWeights)) {
+        std::cout << "Could not read weights file " << options.startPath << "\n";
+        return 1;
+    }
+    configureTranspositionTable(64);  // Games run one candidate at a time: one shared table
+
+    // CMA-ES settings for n = 4 (Hansen's defaults)
+    const int n = WEIGHT_COUNT;
+    const int lambda = options.population > 0 ? options.population : 4 + static_cast<int>(3 * std::log(n));
+    const int mu = lambda / 2;
+    Vector recombination(mu);
+    double weightSum = 0.0;
+    for (int i = 0; i < mu; ++i) {
+        recombination[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+        weightSum += recombination[i];
+    }
+    double squareSum = 0.0;
+    for (int i = 0; i < mu; ++i) {
+        recombination[i] /= weightSum;
+        squareSum += recombination[i] * recombination[i];
+    }
+    const double mueff = 1.0 / squareSum;
+    const double cc = (4.0 + mueff / n) / (n + 4.0 + 2.0 * mueff / n);
+    const double cs = (mueff + 2.0) / (n + mueff + 5.0);
+    const double c1 = 2.0 / ((n + 1.3) * (n + 1.3) + mueff);
+    const double cmu = std::min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((n + 2.0) * (n + 2.0) + mueff));
+    const double damps = 1.0 + 2.0 * std::max(0.0, std::sqrt((mueff - 1.0) / (n + 1.0)) - 1.0) + cs;
+    const double chiN = std::sqrt(static_cast<double>(n)) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+
+    // Search space: each weight relative to its starting value
+    Vector start = weightVector(startWeights);
+    Vector mean(n, 1.0);
+    for (int i = 0; i < n; ++i) {
+        if (start[i] <= 0.0) mean[i] = 0.0;
+    }
+    double sigma = options.sigma;
+    Matrix covariance(n, Vector(n, 0.0));
+    for (int i = 0; i < n; ++i) covariance[i][i] = 1.0;
+    Vector pathSigma(n, 0.0), pathC(n, 0.0);
+
+    GameRng rng(gameSeed(options.seed, 0xC0FFEE));
+    std::normal_distribution<double> normal(0.0, 1.0);
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::cout << "Tuning from " << weightsText(startWeights) << "\n"
+              << lambda << " candidates x " << options.games << " games per generation, "
+              << options.threads << " threads\n" << std::fixed << std::setprecision(1);
+
+    for (int generation = 0; generation < options.generations; ++generation) {
+        Matrix a = cholesky(covariance);
+        std::vector<uint64_t> seeds = batchSeeds(gameSeed(options.seed, generation), options.games);
+
+        // Sample and score the candidates
+        Matrix steps(lambda, Vector(n));
+        std::vector<std::pair<double, int> > ranking(lambda);
+        for (int k = 0; k < lambda; ++k) {
+            Vector z(n);
+            for (int i = 0; i < n; ++i) z[i] = normal(rng);
+            Vector x(n);
+            for (int i = 0; i < n; ++i) {
+                double step = 0.0;
+                for (int j = 0; j <= i; ++j) step += a[i][j] * z[j];
+                steps[k][i] = step;
+                x[i] = mean[i] + sigma * step;
+            }
+            ranking[k] = std::make_pair(meanScore(candidateWeights(x, start), seeds, options), k);
+        }
+        std::sort(ranking.begin(), ranking.end(), [](const std::pair<double, int>& left,
+                                                     const std::pair<double, int>& right) {
+            return left.first > right.first;
+        });
+
+        // Move the mean towards the best candidates
+        Vector meanStep(n, 0.0);
+        for (int r = 0; r < mu; ++r) {
+            for (int i = 0; i < n; ++i) meanStep[i] += recombination[r] * steps[ranking[r].second][i];
+        }
+        for (int i = 0; i < n; ++i) mean[i] += sigma * meanStep[i];
+
+        // Evolution paths, covariance and step size
+        Vector whitened = solveLower(a, meanStep);
+        for (int i = 0; i < n; ++i) {
+            pathSigma[i] = (1.0 - cs) * pathSigma[i] + std::sqrt(cs * (2.0 - cs) * mueff) * whitened[i];
+        }
+        double pathNorm = norm(pathSigma) / std::sqrt(1.0 - std::pow(1.0 - cs, 2.0 * (generation + 1)));
+        bool stalled = pathNorm / chiN >= 1.4 + 2.0 / (n + 1.0);
+        for (int i = 0; i < n; ++i) {
+            pathC[i] = (1.0 - cc) * pathC[i] + (stalled ? 0.0 : std::sqrt(cc * (2.0 - cc) * mueff)) * meanStep[i];
+        }
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                double rankMu = 0.0;
+                for (int r = 0; r < mu; ++r) {
+                    const Vector& step = steps[ranking[r].second];
+                    rankMu += recombination[r] * step[i] * step[j];
+                }
+                covariance[i][j] = (1.0 - c1 - cmu) * covariance[i][j] +
+                                   c1 * (pathC[i] * pathC[j] + (stalled ? cc * (2.0 - cc) * covariance[i][j] : 0.0)) +
+                                   cmu * rankMu;
+            }
+        }
+        sigma *= std::exp((cs / damps) * (norm(pathSigma) / chiN - 1.0));
+
+        double minutes = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() / 60.0;
+        std::cout << "Generation " << generation + 1 << "/" << options.generations << ": best " << ranking.front().first
+                  << ", median " << ranking[lambda / 2].first << ", sigma " << std::setprecision(3) << sigma
+                  << std::setprecision(1) << ", mean " << weightsText(candidateWeights(mean, start)) << " ("
+                  << minutes << " min)\n" << std::flush;
+    }
+
+    // Compare the result with the starting weights on games no candidate has seen
+    EvalWeights tuned = candidateWeights(mean, start);
+    std::vector<uint64_t> validation = batchSeeds(gameSeed(options.seed, ~0ULL), options.validationGames);
+    double tunedScore = meanScore(tuned, validation, options);
+    double startScore = meanScore(startWeights, validation, options);
+    std::cout << "Validation over " << options.validationGames << " games: tuned " << tunedScore << ", start "
+              << startScore << "\n";
+
+    const EvalWeights& best = (tunedScore > startScore) ? tuned : startWeights;
+    if (!writeEvalWeights(options.outPath, best)) {
+        std::cout << "Could not write " << options.outPath << "\n";
+        return 1;
+    }
+    std::cout << "Wrote " << weightsText(best) << " to " << options.outPath << "\n";
+    return 0;
+}